@@ -1,67 +1,366 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <vector>
 
+#include <arena_stats.h>
+#include <cache_line.h>
+#include <page_alloc.h>
 #include <unique_buffer.h>
 
-class ArenaAllocator
+// growth settings for a chained arena. a fixed arena (the size-only constructor) never grows
+// and returns nullptr once full.
+struct ArenaGrowth {
+    size_t growth_factor = 2;       // each new chain block is this many times the previous one
+    size_t max_retained_blocks = 1; // largest blocks kept across reset() so steady frames never malloc
+};
+
+// a point in an arena's history to roll back to - see ArenaAllocator::mark()/rewind()
+struct ArenaMarker {
+    uint64_t state = 0;        // packed bump pointer at the time of the mark
+    size_t large_blocks = 0;   // dedicated blocks that existed at the time of the mark
+    uint64_t generation = 0;   // markers don't survive a reset()
+};
+
+// Stats is a policy from arena_stats.h - NoArenaStats (the ArenaAllocator alias below) costs
+// nothing, ArenaStats counts usage, padding, failures, contention and a size histogram.
+template <typename Stats = NoArenaStats>
+class BasicArenaAllocator
 {
 public:
-    ArenaAllocator(size_t total_size)
-        : m_buffer(total_size),
-          m_offset(0),
-          m_current(m_buffer.data()),
-          m_start(reinterpret_cast<uintptr_t>(m_buffer.data())),
-          m_end(reinterpret_cast<uintptr_t>(m_buffer.data() + total_size)) {}
+    // fixed arena - one block of total_size, allocate() fails once it is used up.
+    // `pages` picks the backing for every block the arena takes (see page_alloc.h); blocks are
+    // never zeroed, so even a 1 GiB arena only costs the pages that actually get touched.
+    BasicArenaAllocator(size_t total_size, PageOptions pages = {})
+        : m_chained(false),
+          m_pages(pages),
+          m_generation(0),
+          m_state(0) {
+        m_blocks[0] = Block(total_size, PageAlloc(m_pages));
+        m_block_count = 1;
+    }
 
-    void* allocate(size_t object_size, size_t object_alignment) {
-        std::scoped_lock lock(m_mutex);
-        uintptr_t current_addr = reinterpret_cast<uintptr_t>(m_current);
-        // power of 2 alignment - sourced from Gemini Pro
-        uintptr_t aligned_addr = (current_addr + object_alignment - 1) & ~(object_alignment - 1);
+    // chained arena - starts with one block of initial_block_size and links in geometrically
+    // larger blocks whenever the current one runs out
+    BasicArenaAllocator(size_t initial_block_size, ArenaGrowth growth, PageOptions pages = {})
+        : m_chained(true),
+          m_growth(growth),
+          m_pages(pages),
+          m_generation(0),
+          m_state(0) {
+        m_growth.growth_factor = std::max<size_t>(m_growth.growth_factor, 1);
+        m_growth.max_retained_blocks = std::clamp<size_t>(m_growth.max_retained_blocks, 1, max_blocks);
+        m_blocks[0] = Block(std::max(initial_block_size, min_block_size), PageAlloc(m_pages));
+        m_block_count = 1;
+    }
 
-        // bounds check - ensure the requested address won't allocate beyond our unique buffer
-        if (aligned_addr + object_size > m_end) {
+    BasicArenaAllocator(const BasicArenaAllocator&) = delete;
+    BasicArenaAllocator& operator=(const BasicArenaAllocator&) = delete;
+
+    // lock-free bump: every thread races a single CAS on m_state, which packs the current block
+    // index together with the offset into it. the aligned address is recomputed from whatever we
+    // observed, so padding is always relative to the real current position, and because the
+    // block index is part of the word a CAS can never land on a block that has been retired.
+    void* allocate(size_t object_size, size_t object_alignment) {
+        // the mask trick below only works for power of 2 alignments
+        if (object_alignment == 0 || (object_alignment & (object_alignment - 1)) != 0) {
+            m_stats.on_failure(object_size);
             return nullptr;
         }
 
-        // move the arena pointer forward for next alloc & return requested addr
-        m_current = reinterpret_cast<std::byte*>(aligned_addr + object_size);
-        return reinterpret_cast<std::byte*>(aligned_addr);;
-    }
+        // acquire pairs with the release in advance() so a freshly linked block is visible
+        uint64_t state = m_state.load(std::memory_order_acquire);
+        while (true) {
+            size_t const index = block_index(state);
+            uintptr_t const start = reinterpret_cast<uintptr_t>(m_blocks[index].data());
+            uintptr_t const end = start + m_blocks[index].size();
 
-    // void *allocate(size_t object_size, size_t object_alignment) {
-    //     uintptr_t current_offset = m_offset.load(std::memory_order_relaxed);
-    //     uintptr_t current_addr = m_start + current_offset;
-    //     uintptr_t aligned_addr;
+            // power of 2 alignment - sourced from Gemini Pro
+            uintptr_t aligned_addr = (start + block_offset(state) + object_alignment - 1) & ~(object_alignment - 1);
 
-    //     do {
-    //         aligned_addr = (current_addr + object_alignment - 1) & ~(object_alignment - 1);
+            // bounds check - ensure the requested address won't allocate beyond the current block
+            // (written as a subtraction so a huge object_size can't wrap around)
+            if (aligned_addr <= end && object_size <= end - aligned_addr) {
+                uint64_t const next = pack(index, aligned_addr + object_size - start);
+                if (m_state.compare_exchange_weak(state, next,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_acquire)) {
+                    m_stats.on_allocate(object_size, aligned_addr - start - block_offset(state));
+                    return reinterpret_cast<std::byte*>(aligned_addr);
+                }
+                m_stats.on_cas_retry();
+                continue; // lost the race, state now holds the fresher value
+            }
 
-    //         // bounds check - ensure the requested address won't allocate beyond our unique buffer
-    //         if (aligned_addr + object_size > m_end) {
-    //             return nullptr;
-    //         }
-    //     } while (!m_offset.compare_exchange_weak(current_offset, current_offset + 1));
+            if (!m_chained) {
+                m_stats.on_failure(object_size);
+                return nullptr;
+            }
 
-    //     // move the arena pointer forward for next alloc & return requested addr
-    //     m_current = reinterpret_cast<std::byte*>(aligned_addr + object_size);
-    //     return reinterpret_cast<std::byte*>(aligned_addr);;
-    // }
+            // current block is exhausted - take the slow path under the grow mutex
+            void* dedicated = nullptr;
+            if (!advance(state, object_size, object_alignment, dedicated)) {
+                m_stats.on_failure(object_size);
+                return nullptr;
+            }
+            if (dedicated != nullptr) {
+                return dedicated;
+            }
+            state = m_state.load(std::memory_order_acquire);
+        }
+    }
 
+    // rewinds the arena to empty. not safe to call while other threads are still allocating -
+    // the caller is expected to reset between frames once every allocation is dead.
+    // dedicated large blocks are released, and a chained arena keeps its largest
+    // max_retained_blocks chain blocks (largest first) so the next frame reuses them.
+    // bumping the generation tells front ends (ThreadArenaCache) that any block they carved
+    // out of us before the reset is gone.
     void reset() {
-        // todo: fix
-        m_offset.store(0);
-        m_current = reinterpret_cast<std::byte *>(m_start);
+        if (m_chained) {
+            std::scoped_lock lock(m_grow_mutex);
+            m_large_blocks.clear();
+            m_large_block_count.store(0, std::memory_order_relaxed);
+
+            std::sort(m_blocks, m_blocks + m_block_count,
+                      [](const Block& a, const Block& b) {
+                          return a.size() > b.size();
+                      });
+            size_t const keep = std::min(m_block_count, m_growth.max_retained_blocks);
+            for (size_t i = keep; i < m_block_count; ++i) {
+                m_blocks[i] = Block();
+            }
+            m_block_count = keep;
+        }
+
+        m_state.store(0, std::memory_order_release);
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_stats.on_reset();
+    }
+
+    // stack-style lifetimes: remember where the bump pointer is, allocate temporaries, then
+    // rewind() to drop everything allocated since in O(1). chain blocks linked after the mark
+    // stay around and get reused as the arena fills up again; dedicated large blocks allocated
+    // after the mark are released.
+    // like reset(), rewinding while another thread allocates from the same arena (or holds a
+    // ThreadArenaCache block carved after the mark) is not allowed - scopes are for arenas a
+    // single thread owns, nested inside that thread's frame.
+    ArenaMarker mark() const noexcept {
+        return ArenaMarker{ m_state.load(std::memory_order_relaxed),
+                            m_large_block_count.load(std::memory_order_relaxed),
+                            m_generation.load(std::memory_order_relaxed) };
+    }
+
+    void rewind(const ArenaMarker& marker) {
+        assert(marker.generation == m_generation.load(std::memory_order_relaxed) && "marker is from before a reset()");
+
+        if (m_large_block_count.load(std::memory_order_relaxed) != marker.large_blocks) {
+            std::scoped_lock lock(m_grow_mutex);
+            m_large_blocks.resize(marker.large_blocks);
+            m_large_block_count.store(marker.large_blocks, std::memory_order_relaxed);
+        }
+        m_state.store(marker.state, std::memory_order_release);
+
+        if constexpr (Stats::enabled) {
+            m_stats.on_rewind(used() + large_block_bytes());
+        }
+    }
+
+    // bytes handed out since the start of the current block chain - 0 right after reset()
+    size_t used() const {
+        uint64_t const state = m_state.load(std::memory_order_relaxed);
+        std::scoped_lock lock(m_grow_mutex);
+        size_t total = block_offset(state);
+        for (size_t i = 0; i < block_index(state); ++i) total += m_blocks[i].size();
+        return total;
+    }
+
+    // number of resets so far; read on every cached allocation so it lives away from m_state
+    uint64_t generation() const noexcept { return m_generation.load(std::memory_order_acquire); }
+
+    // bytes of chain storage currently held (excludes dedicated large blocks)
+    size_t capacity() const {
+        std::scoped_lock lock(m_grow_mutex);
+        size_t total = 0;
+        for (size_t i = 0; i < m_block_count; ++i) total += m_blocks[i].size();
+        return total;
+    }
+
+    size_t block_count() const {
+        std::scoped_lock lock(m_grow_mutex);
+        return m_block_count;
+    }
+
+    bool chained() const noexcept { return m_chained; }
+    const PageOptions& page_options() const noexcept { return m_pages; }
+
+    const Stats& stats() const noexcept { return m_stats; }
+
+private:
+    using Block = UniqueBuffer<std::byte, PageAlloc>;
+
+    // state word layout: [ block index : 16 | offset into block : 48 ]
+    static constexpr unsigned offset_bits = 48;
+    static constexpr uint64_t offset_mask = (uint64_t(1) << offset_bits) - 1;
+    static constexpr size_t max_blocks = 64;  // 64 doublings is far beyond any address space
+    static constexpr size_t min_block_size = 64;
+
+    static size_t block_index(uint64_t state) noexcept { return static_cast<size_t>(state >> offset_bits); }
+    static size_t block_offset(uint64_t state) noexcept { return static_cast<size_t>(state & offset_mask); }
+    static uint64_t pack(size_t index, size_t offset) noexcept {
+        return (static_cast<uint64_t>(index) << offset_bits) | offset;
+    }
+
+    // slow path once the block in `observed` is full. either hands back a dedicated block for a
+    // large request (stays on the current block so its tail isn't wasted) or moves m_state on to
+    // the next chain block, reusing one retained from an earlier frame when it is big enough.
+    // returns false only when the arena can't grow any further.
+    bool advance(uint64_t observed, size_t object_size, size_t object_alignment, void*& dedicated) {
+        std::unique_lock lock = lock_grow();
+
+        size_t const index = block_index(observed);
+        size_t const next_size = m_blocks[index].size() * m_growth.growth_factor;
+        size_t const needed = object_size + object_alignment - 1;
+        if (needed < object_size) {
+            return false; // overflowed, nothing could ever satisfy this
+        }
+
+        // anything over a quarter of the next block would mostly waste the last block's tail
+        // and then bloat the chain - it gets a block of its own instead
+        if (needed > next_size / 4) {
+            Block block(needed, PageAlloc(m_pages));
+            uintptr_t addr = reinterpret_cast<uintptr_t>(block.data());
+            dedicated = reinterpret_cast<std::byte*>((addr + object_alignment - 1) & ~(object_alignment - 1));
+            // everything in the block beyond the object is waste, alignment slack included
+            m_stats.on_allocate(object_size, block.size() - object_size);
+            m_large_blocks.push_back(std::move(block));
+            m_large_block_count.store(m_large_blocks.size(), std::memory_order_relaxed);
+            return true;
+        }
+
+        // someone else already moved us on while we waited for the lock - just retry
+        if (block_index(m_state.load(std::memory_order_acquire)) != index) {
+            return true;
+        }
+
+        size_t const next = index + 1;
+        if (next >= max_blocks) {
+            return false;
+        }
+
+        // blocks past the current index aren't visible to any allocator, so they can be swapped
+        // out freely. a retained block that is too small for this request gets replaced.
+        if (next >= m_block_count || m_blocks[next].size() < needed) {
+            m_blocks[next] = Block(std::max(next_size, needed), PageAlloc(m_pages));
+            m_block_count = std::max(m_block_count, next + 1);
+        }
+
+        // a plain store is fine: concurrent CASes expect the old index and will fail and reload.
+        // a CAS that squeezed one last allocation into the old block just before us is
+        // overwritten, which only forgets that block's tail - the allocation itself stays valid.
+        m_state.store(pack(next, 0), std::memory_order_release);
+        return true;
+    }
+
+    // only contended acquisitions are timed, so an uncontended slow path never reads the clock
+    std::unique_lock<std::mutex> lock_grow() {
+        if constexpr (Stats::enabled) {
+            std::unique_lock lock(m_grow_mutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                auto const start = std::chrono::steady_clock::now();
+                lock.lock();
+                auto const waited = std::chrono::steady_clock::now() - start;
+                m_stats.on_lock_wait(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count()));
+            }
+            return lock;
+        } else {
+            return std::unique_lock(m_grow_mutex);
+        }
+    }
+
+    // live bytes in dedicated blocks, for the stats after a rewind
+    size_t large_block_bytes() const {
+        std::scoped_lock lock(m_grow_mutex);
+        size_t total = 0;
+        for (const Block& block : m_large_blocks) total += block.size();
+        return total;
+    }
+
+    bool const m_chained;
+    ArenaGrowth m_growth{};
+    PageOptions const m_pages;
+
+    // chain blocks, indexed by the block index in m_state. entries are only written under
+    // m_grow_mutex before being published through m_state, so allocate() reads them lock-free.
+    Block m_blocks[max_blocks];
+    size_t m_block_count = 0;
+    std::vector<Block> m_large_blocks;          // dedicated blocks, released on reset()
+    std::atomic<size_t> m_large_block_count{0}; // mirror of the size so mark() needn't lock
+    mutable std::mutex m_grow_mutex;
+
+    std::atomic<uint64_t> m_generation; // only written by reset(), so this line stays shared-clean
+    // the one contended word gets its own cache line so allocators don't bounce the block table around
+    alignas(cache_line_size) std::atomic<uint64_t> m_state; // [block index | offset] of the bump pointer
+
+    [[no_unique_address]] Stats m_stats;
+};
+
+using ArenaAllocator = BasicArenaAllocator<>;
+
+// allocation policy (see unique_buffer.h) taking UniqueBuffer / SmallVector storage from an
+// arena. nothing is handed back one block at a time - deallocate is a no-op and the memory comes
+// back with the arena's reset() or rewind() - so a container that keeps growing leaves each
+// outgrown block behind, less than its final size in total with doubling growth. meant for
+// per-frame or per-request scratch that dies with the arena, not for long-lived containers.
+struct ArenaAlloc {
+    static constexpr bool value_initialize = true;
+
+    explicit ArenaAlloc(ArenaAllocator& arena) noexcept : m_arena(&arena) {}
+
+    void* allocate(size_t bytes, size_t alignment) {
+        void* p = m_arena->allocate(bytes, alignment);
+        if (p == nullptr) throw std::bad_alloc();
+        return p;
     }
 
+    void deallocate(void*, size_t, size_t) noexcept {}
+
+    ArenaAllocator& arena() const noexcept { return *m_arena; }
+
+private:
+    ArenaAllocator* m_arena;
+};
+
+// RAII rollback - everything allocated from the arena while the scope is alive is released
+// (the bump pointer rewinds) when it ends. nest them freely; inner scopes must end first.
+//
+//     {
+//         ArenaScope scratch(arena);
+//         auto* tmp = arena.allocate(...);   // parse temporaries
+//     }                                      // tmp's bytes are reusable again
+template <typename Stats = NoArenaStats>
+class ArenaScope
+{
+public:
+    explicit ArenaScope(BasicArenaAllocator<Stats>& arena)
+        : m_arena(arena), m_marker(arena.mark()) {}
+
+    ~ArenaScope() { m_arena.rewind(m_marker); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    const ArenaMarker& marker() const noexcept { return m_marker; }
+
 private:
-    UniqueBuffer<std::byte> m_buffer;
-    std::atomic<uintptr_t> m_offset;
-    std::byte *m_current;
-    uintptr_t const m_start; // Pointer to the beginning of the buffer
-    uintptr_t const m_end;   // Pointer to one-past-the-end of the buffer
-    std::mutex m_mutex;
-};
\ No newline at end of file
+    BasicArenaAllocator<Stats>& m_arena;
+    ArenaMarker const m_marker;
+};
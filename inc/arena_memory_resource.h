@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <new>
+
+#include <arena_allocator.h>
+
+/*
+Standard library adapters for ArenaAllocator.
+
+ArenaResource is a std::pmr::memory_resource with monotonic semantics: allocations bump the arena,
+deallocations are no-ops, and memory comes back all at once through the arena's reset() / rewind().
+Point any std::pmr container at it and the global heap drops out of that container's life.
+
+ArenaStlAllocator<T> is the same thing for code that takes an Allocator template parameter
+instead of a memory_resource (std::vector<T, ArenaStlAllocator<T>> etc). It is a single pointer,
+so containers stay as small as with std::allocator.
+
+Both throw std::bad_alloc when the arena can't satisfy a request, as the standard requires -
+use a chained arena (ArenaGrowth) if containers should never run out.
+*/
+
+class ArenaResource : public std::pmr::memory_resource
+{
+public:
+    explicit ArenaResource(ArenaAllocator& arena) noexcept : m_arena(arena) {}
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    ArenaAllocator& arena() const noexcept { return m_arena; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* p = m_arena.allocate(bytes, alignment);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    // monotonic - the arena reclaims everything on reset()/rewind()
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        auto* rhs = dynamic_cast<const ArenaResource*>(&other);
+        return rhs != nullptr && &rhs->m_arena == &m_arena;
+    }
+
+    ArenaAllocator& m_arena;
+};
+
+template <typename T>
+class ArenaStlAllocator
+{
+public:
+    using value_type = T;
+
+    // containers copy their allocator on copy/move/swap so the arena follows the data around
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit ArenaStlAllocator(ArenaAllocator& arena) noexcept : m_arena(&arena) {}
+
+    template <typename U>
+    ArenaStlAllocator(const ArenaStlAllocator<U>& other) noexcept : m_arena(other.arena()) {}
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        void* p = m_arena->allocate(n * sizeof(T), alignof(T));
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    // monotonic, same as ArenaResource
+    void deallocate(T*, size_t) noexcept {}
+
+    ArenaAllocator* arena() const noexcept { return m_arena; }
+
+    template <typename U>
+    bool operator==(const ArenaStlAllocator<U>& other) const noexcept { return m_arena == other.arena(); }
+
+private:
+    ArenaAllocator* m_arena;
+};
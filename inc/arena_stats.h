@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include <cache_line.h>
+
+/*
+Stats policies for BasicArenaAllocator.
+
+The arena calls these hooks from allocate() and its slow paths. NoArenaStats is empty with empty
+inline hooks, so the default ArenaAllocator compiles to exactly what it was; anything that costs
+more than a hook call (the clock reads around a contended lock, recomputing used() after a rewind)
+is additionally guarded by `if constexpr (Stats::enabled)` on the arena side.
+
+    BasicArenaAllocator<ArenaStats> arena(64 * 1024 * 1024);
+    ...
+    ArenaStats::Snapshot s = arena.stats().snapshot();
+    // s.peak_bytes is what the arena should have been sized to
+
+Counters are relaxed atomics - they are for sizing and dashboards, not for synchronizing anything.
+*/
+
+struct NoArenaStats {
+    static constexpr bool enabled = false;
+
+    void on_allocate(size_t, size_t) noexcept {}
+    void on_failure(size_t) noexcept {}
+    void on_cas_retry() noexcept {}
+    void on_lock_wait(uint64_t) noexcept {}
+    void on_rewind(size_t) noexcept {}
+    void on_reset() noexcept {}
+};
+
+class ArenaStats
+{
+public:
+    static constexpr bool enabled = true;
+
+    // bucket i holds requests of [2^(i-1), 2^i) bytes, bucket 0 is zero-byte requests and the
+    // last bucket takes everything larger
+    static constexpr size_t histogram_buckets = 32;
+
+    struct Snapshot {
+        uint64_t allocations = 0;
+        uint64_t failures = 0;
+        uint64_t bytes_requested = 0;  // sum of object sizes since construction
+        uint64_t padding_bytes = 0;    // alignment padding wasted on top of those
+        uint64_t used_bytes = 0;       // requested + padding currently live (since the last reset/rewind)
+        uint64_t peak_bytes = 0;       // high-water mark of used_bytes
+        uint64_t cas_retries = 0;      // lost races on the bump pointer
+        uint64_t lock_waits = 0;       // slow paths that found the grow mutex held
+        uint64_t lock_wait_ns = 0;     // total time spent waiting for it
+        uint64_t histogram[histogram_buckets] = {};
+    };
+
+    static constexpr size_t bucket_of(size_t size) noexcept {
+        size_t const width = static_cast<size_t>(std::bit_width(size));
+        return width < histogram_buckets ? width : histogram_buckets - 1;
+    }
+
+    void on_allocate(size_t size, size_t padding) noexcept {
+        m_allocations.fetch_add(1, std::memory_order_relaxed);
+        m_bytes_requested.fetch_add(size, std::memory_order_relaxed);
+        m_padding_bytes.fetch_add(padding, std::memory_order_relaxed);
+        m_histogram[bucket_of(size)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t const used = m_used_bytes.fetch_add(size + padding, std::memory_order_relaxed) + size + padding;
+        uint64_t peak = m_peak_bytes.load(std::memory_order_relaxed);
+        while (used > peak && !m_peak_bytes.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+        }
+    }
+
+    void on_failure(size_t) noexcept { m_failures.fetch_add(1, std::memory_order_relaxed); }
+    void on_cas_retry() noexcept { m_cas_retries.fetch_add(1, std::memory_order_relaxed); }
+
+    void on_lock_wait(uint64_t ns) noexcept {
+        m_lock_waits.fetch_add(1, std::memory_order_relaxed);
+        m_lock_wait_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    // the arena reports what is still live after rolling back
+    void on_rewind(size_t used) noexcept { m_used_bytes.store(used, std::memory_order_relaxed); }
+    void on_reset() noexcept { m_used_bytes.store(0, std::memory_order_relaxed); }
+
+    Snapshot snapshot() const noexcept {
+        Snapshot s;
+        s.allocations = m_allocations.load(std::memory_order_relaxed);
+        s.failures = m_failures.load(std::memory_order_relaxed);
+        s.bytes_requested = m_bytes_requested.load(std::memory_order_relaxed);
+        s.padding_bytes = m_padding_bytes.load(std::memory_order_relaxed);
+        s.used_bytes = m_used_bytes.load(std::memory_order_relaxed);
+        s.peak_bytes = m_peak_bytes.load(std::memory_order_relaxed);
+        s.cas_retries = m_cas_retries.load(std::memory_order_relaxed);
+        s.lock_waits = m_lock_waits.load(std::memory_order_relaxed);
+        s.lock_wait_ns = m_lock_wait_ns.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < histogram_buckets; ++i) {
+            s.histogram[i] = m_histogram[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+private:
+    // every allocating thread writes these, so keep them off the arena's own lines
+    alignas(cache_line_size) std::atomic<uint64_t> m_allocations{0};
+    std::atomic<uint64_t> m_failures{0};
+    std::atomic<uint64_t> m_bytes_requested{0};
+    std::atomic<uint64_t> m_padding_bytes{0};
+    std::atomic<uint64_t> m_used_bytes{0};
+    std::atomic<uint64_t> m_peak_bytes{0};
+    std::atomic<uint64_t> m_cas_retries{0};
+    std::atomic<uint64_t> m_lock_waits{0};
+    std::atomic<uint64_t> m_lock_wait_ns{0};
+    std::atomic<uint64_t> m_histogram[histogram_buckets] = {};
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+// std::hardware_destructive_interference_size changes with -mtune, and gcc warns (-Werror here)
+// whenever it shows up in a header, so every padded structure in the project shares this one
+inline constexpr size_t cache_line_size = 64;
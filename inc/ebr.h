@@ -0,0 +1,358 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <cache_line.h>
+#include <thread_slot.h>
+#include <unique_buffer.h>
+
+/*
+EpochDomain - epoch-based reclamation (EBR) for lock-free structures, with hazard pointers for
+readers that hold on to one node for a long time.
+
+A node unlinked from a lock-free structure can't be freed on the spot: another thread may have
+loaded the pointer just before the unlink and still be reading it. Readers enter the domain for
+the span of an operation instead, and writers retire() what they unlink:
+
+    EpochDomain domain;
+
+    {
+        EpochDomain::Guard guard(domain);   // enter, exit at scope end
+        Node* n = head.load();
+        ...                                 // n stays valid until the guard goes
+    }
+
+    if (head.compare_exchange_strong(n, n->next)) domain.retire(n);          // delete later
+    if (head.compare_exchange_strong(n, n->next)) domain.retire(n, pool);    // back to a PoolAllocator
+
+The domain has a global epoch. Entering pins the thread to the current epoch; the epoch only
+steps from e to e+1 once every pinned thread is at e. Something retired during epoch r was
+unlinked before anyone pinned at r+1 entered, and by r+2 everyone pinned at r has left, so it is
+reclaimed once the epoch reaches r+2. Guards nest and are cheap - one store on the way in (plus a
+re-check) and one on the way out, into this thread's own cache line.
+
+Retire lists are per thread slot (thread_slot.h) and are only ever touched by their own thread.
+A list is flushed - advance the epoch if possible, reclaim whatever is two epochs old - once it
+holds batch_size entries, so the scan over every slot's pin is paid once per batch, not per
+retire. collect() flushes the calling thread's list now. Threads past max_thread_slots share one
+mutex-guarded list and pin through a pair of counters instead. Whatever is still pending when
+the domain is destroyed is reclaimed then, so the domain must outlive every guard into it.
+
+Reclaiming goes through the allocator the node came from rather than a bare delete:
+retire(p, pool) runs ~T() and hands the block back to a PoolAllocator<T> or FixedPool, which may
+themselves be carved from an ArenaAllocator. An arena can't take single blocks back, so nodes that
+came straight from one are retired with retire(p, destroy_only) - the memory returns with the
+arena's next reset or rewind.
+
+A reader that stays pinned holds the epoch back for everyone, and nothing retired meanwhile can
+be reclaimed. Long-lived readers (a cursor parked on one node, a reader that blocks) should take a
+HazardPointer instead: protect() publishes the one node it is reading, and reclamation skips any
+retired node that a hazard pointer still names - without pinning the epoch. A hazard pointer only
+covers that node, not whatever it points to.
+*/
+
+class EpochDomain
+{
+    struct Retired {
+        void* pointer;
+        void (*reclaim)(void* pointer, void* context) noexcept;
+        void* context;
+        uint64_t epoch;
+    };
+
+    // owned by whichever thread holds the slot - nothing here is read by other threads except pin
+    struct alignas(cache_line_size) Participant {
+        std::atomic<uint64_t> pin{idle};   // (epoch << 1) | 1 while inside a guard
+        size_t depth = 0;                  // guard nesting
+        size_t flush_at = 0;               // flush the retire list when it reaches this size
+        std::vector<Retired> retired;
+    };
+
+    struct alignas(cache_line_size) Hazard {
+        std::atomic<void*> pointer{nullptr};
+        std::atomic<bool> claimed{false};
+    };
+
+    static constexpr uint64_t idle = 0;
+
+public:
+    static constexpr size_t hazard_slots = 16;
+
+    // tag for retire(p, destroy_only): ~T() when safe, the memory belongs to an arena
+    struct DestroyOnly {};
+    static constexpr DestroyOnly destroy_only{};
+
+    explicit EpochDomain(size_t batch_size = 64)
+        : m_batch_size(std::max<size_t>(batch_size, 1)),
+          m_participants(max_thread_slots) {
+        for (size_t i = 0; i < max_thread_slots; ++i) {
+            m_participants[i].flush_at = m_batch_size;
+        }
+        m_overflow.flush_at = m_batch_size;
+    }
+
+    // every guard and hazard pointer must be gone by now
+    ~EpochDomain() {
+        for (size_t i = 0; i < max_thread_slots; ++i) {
+            drain(m_participants[i]);
+        }
+        drain(m_overflow);
+    }
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // pins the calling thread for its lifetime. not movable - it belongs to one thread's stack.
+    class Guard
+    {
+    public:
+        explicit Guard(EpochDomain& domain) noexcept : m_domain(domain), m_slot(this_thread_slot()) {
+            if (m_slot != no_thread_slot) {
+                Participant& me = domain.m_participants[m_slot];
+                if (me.depth++ == 0) {
+                    domain.pin(me);
+                }
+                return;
+            }
+            // no slot of our own: count into the current epoch's parity counter. the epoch moved
+            // between the load and the increment - we may have counted into a slot the advancing
+            // thread already checked, so go again.
+            while (true) {
+                m_epoch = domain.m_epoch.load(std::memory_order_seq_cst);
+                domain.m_overflow_active[m_epoch & 1].fetch_add(1, std::memory_order_seq_cst);
+                if (domain.m_epoch.load(std::memory_order_seq_cst) == m_epoch) return;
+                domain.m_overflow_active[m_epoch & 1].fetch_sub(1, std::memory_order_seq_cst);
+            }
+        }
+
+        ~Guard() {
+            if (m_slot != no_thread_slot) {
+                Participant& me = m_domain.m_participants[m_slot];
+                if (--me.depth == 0) {
+                    me.pin.store(idle, std::memory_order_release);
+                }
+                return;
+            }
+            m_domain.m_overflow_active[m_epoch & 1].fetch_sub(1, std::memory_order_seq_cst);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        EpochDomain& m_domain;
+        size_t const m_slot;
+        uint64_t m_epoch = 0;   // overflow threads only
+    };
+
+    // one published pointer that reclamation won't free. claims one of hazard_slots slots for
+    // its lifetime and throws std::runtime_error when they are all taken.
+    class HazardPointer
+    {
+    public:
+        explicit HazardPointer(EpochDomain& domain) : m_domain(domain) {
+            for (Hazard& h : domain.m_hazards) {
+                bool expected = false;
+                if (!h.claimed.load(std::memory_order_relaxed) &&
+                    h.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    m_hazard = &h;
+                    domain.m_hazards_claimed.fetch_add(1, std::memory_order_seq_cst);
+                    return;
+                }
+            }
+            throw std::runtime_error("out of hazard pointers");
+        }
+
+        ~HazardPointer() {
+            m_hazard->pointer.store(nullptr, std::memory_order_release);
+            m_hazard->claimed.store(false, std::memory_order_release);
+            m_domain.m_hazards_claimed.fetch_sub(1, std::memory_order_seq_cst);
+        }
+
+        HazardPointer(const HazardPointer&) = delete;
+        HazardPointer& operator=(const HazardPointer&) = delete;
+
+        // loads src and publishes it; the result can be dereferenced until the next protect()
+        // or reset(), even if it is unlinked and retired in the meantime
+        template <typename T>
+        T* protect(const std::atomic<T*>& src) noexcept {
+            T* p = src.load(std::memory_order_seq_cst);
+            while (true) {
+                m_hazard->pointer.store(p, std::memory_order_seq_cst);
+                // still linked after we published it, so any later retire will see the hazard
+                T* const again = src.load(std::memory_order_seq_cst);
+                if (again == p) return p;
+                p = again;
+            }
+        }
+
+        void reset() noexcept { m_hazard->pointer.store(nullptr, std::memory_order_release); }
+
+    private:
+        EpochDomain& m_domain;
+        Hazard* m_hazard = nullptr;
+    };
+
+    // reclaim(p, context) once no reader can still see p
+    void retire(void* p, void (*reclaim)(void*, void*) noexcept, void* context = nullptr) {
+        size_t const slot = this_thread_slot();
+        if (slot == no_thread_slot) {
+            // reclaim outside the lock - a callback that retires again takes it itself
+            std::vector<Retired> ready;
+            {
+                std::scoped_lock lock(m_overflow_mutex);
+                ready = push(m_overflow, p, reclaim, context);
+            }
+            reclaim_all(ready);
+            return;
+        }
+        reclaim_all(push(m_participants[slot], p, reclaim, context));
+    }
+
+    // delete p
+    template <typename T>
+    void retire(T* p) {
+        retire(p, [](void* q, void*) noexcept { delete static_cast<T*>(q); });
+    }
+
+    // ~T() only - for nodes living in an ArenaAllocator, which takes the memory back wholesale
+    template <typename T>
+    void retire(T* p, DestroyOnly) {
+        retire(p, [](void* q, void*) noexcept { static_cast<T*>(q)->~T(); });
+    }
+
+    // back to the allocator it came from: pool.destroy(p) for a PoolAllocator<T>, or ~T() and
+    // pool.deallocate(p) for a FixedPool. the pool must outlive the domain's pending work.
+    template <typename T, typename Pool>
+        requires requires(Pool& pool, T* p) { pool.destroy(p); } || requires(Pool& pool, void* p) { pool.deallocate(p); }
+    void retire(T* p, Pool& pool) {
+        retire(p, [](void* q, void* context) noexcept {
+            auto& owner = *static_cast<Pool*>(context);
+            if constexpr (requires { owner.destroy(static_cast<T*>(q)); }) {
+                owner.destroy(static_cast<T*>(q));
+            } else {
+                static_cast<T*>(q)->~T();
+                owner.deallocate(q);
+            }
+        }, &pool);
+    }
+
+    // flush the calling thread's retire list now, whatever its size
+    void collect() {
+        size_t const slot = this_thread_slot();
+        if (slot == no_thread_slot) {
+            std::vector<Retired> ready;
+            {
+                std::scoped_lock lock(m_overflow_mutex);
+                ready = flush(m_overflow);
+            }
+            reclaim_all(ready);
+            return;
+        }
+        reclaim_all(flush(m_participants[slot]));
+    }
+
+    uint64_t epoch() const noexcept { return m_epoch.load(std::memory_order_relaxed); }
+
+    // retired, not reclaimed yet - across every thread
+    size_t pending() const noexcept { return m_pending.load(std::memory_order_relaxed); }
+
+    size_t batch_size() const noexcept { return m_batch_size; }
+
+private:
+    // same re-check as the overflow path: a pin stored after the epoch moved on may have been
+    // missed by the advancing thread
+    void pin(Participant& me) noexcept {
+        while (true) {
+            uint64_t const epoch = m_epoch.load(std::memory_order_seq_cst);
+            me.pin.store((epoch << 1) | 1, std::memory_order_seq_cst);
+            if (m_epoch.load(std::memory_order_seq_cst) == epoch) return;
+        }
+    }
+
+    // returns what a flush found ready, for the caller to reclaim
+    [[nodiscard]] std::vector<Retired> push(Participant& list, void* p, void (*reclaim)(void*, void*) noexcept,
+                                            void* context) {
+        list.retired.push_back(Retired{p, reclaim, context, m_epoch.load(std::memory_order_seq_cst)});
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        if (list.retired.size() >= list.flush_at) {
+            return flush(list);
+        }
+        return {};
+    }
+
+    // e -> e+1 once nobody is pinned anywhere but e
+    void try_advance() noexcept {
+        uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+        uint64_t const current = (epoch << 1) | 1;
+        for (size_t i = 0; i < max_thread_slots; ++i) {
+            uint64_t const pin = m_participants[i].pin.load(std::memory_order_seq_cst);
+            if (pin != idle && pin != current) return;
+        }
+        if (m_overflow_active[(epoch + 1) & 1].load(std::memory_order_seq_cst) != 0) return;
+        m_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+    }
+
+    // takes out of `list` whatever can be reclaimed. the caller runs reclaim_all() on it once it
+    // no longer holds the list's lock (if any) - a reclaim may itself retire into this list.
+    [[nodiscard]] std::vector<Retired> flush(Participant& list) {
+        try_advance();
+        uint64_t const epoch = m_epoch.load(std::memory_order_seq_cst);
+
+        // snapshot the published hazards once, sorted, if anyone has one
+        void* hazards[hazard_slots];
+        size_t hazard_count = 0;
+        if (m_hazards_claimed.load(std::memory_order_seq_cst) != 0) {
+            for (Hazard& h : m_hazards) {
+                if (void* p = h.pointer.load(std::memory_order_seq_cst)) hazards[hazard_count++] = p;
+            }
+            std::sort(hazards, hazards + hazard_count);
+        }
+
+        auto keep = std::partition(list.retired.begin(), list.retired.end(), [&](const Retired& r) {
+            return epoch < r.epoch + 2 || std::binary_search(hazards, hazards + hazard_count, r.pointer);
+        });
+        std::vector<Retired> ready(keep, list.retired.end());
+        list.retired.erase(keep, list.retired.end());
+
+        // whatever is still held back waits for another full batch, so a stuck reader doesn't
+        // turn every retire into a scan
+        list.flush_at = list.retired.size() + m_batch_size;
+        return ready;
+    }
+
+    void reclaim_all(const std::vector<Retired>& records) noexcept {
+        m_pending.fetch_sub(records.size(), std::memory_order_relaxed);
+        for (Retired const& r : records) {
+            r.reclaim(r.pointer, r.context);
+        }
+    }
+
+    // everything, hazards and epochs aside - only once nobody can be reading
+    void drain(Participant& list) noexcept {
+        while (!list.retired.empty()) {
+            reclaim_all(std::exchange(list.retired, {}));
+        }
+    }
+
+    size_t const m_batch_size;
+
+    alignas(cache_line_size) std::atomic<uint64_t> m_epoch{0};
+    std::atomic<size_t> m_overflow_active[2] = {};   // pins of threads without a slot, by parity
+    std::atomic<size_t> m_pending{0};
+    std::atomic<size_t> m_hazards_claimed{0};
+
+    UniqueBuffer<Participant> m_participants;        // one per thread slot
+    Participant m_overflow;                          // retire list of threads without a slot
+    std::mutex m_overflow_mutex;
+
+    Hazard m_hazards[hazard_slots];
+};
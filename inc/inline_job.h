@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+InlineJob<Size> - a move-only void() callable that never allocates.
+
+std::function heap-allocates any capture bigger than its small buffer (two pointers in libstdc++)
+and carries a manager plus an invoker. InlineJob stores the callable in Size bytes of its own and
+refuses to compile anything larger, so a job costs exactly sizeof(InlineJob) wherever it lives -
+a ring cell, a pool block - and scheduling one never touches malloc.
+
+Everything type specific goes through one function pointer, which invokes, relocates or destroys
+depending on its first argument. There is no vtable, and an empty job is just a null pointer.
+Relocation (moving the callable into new storage and ending the old one) is all a move needs, and
+for trivially copyable callables it is a memcpy.
+
+The default of 48 bytes makes InlineJob<> exactly one cache line: six pointers or references of
+capture. A lambda that needs more should capture a pointer to its state instead.
+*/
+template <size_t Size = 48>
+class InlineJob
+{
+public:
+    static constexpr size_t capacity = Size;
+
+    template <typename F>
+    static constexpr bool fits = sizeof(F) <= Size && alignof(F) <= alignof(std::max_align_t) &&
+                                 std::is_nothrow_move_constructible_v<F>;
+
+    InlineJob() noexcept = default;
+
+    template <typename F>
+        requires (!std::is_same_v<std::remove_cvref_t<F>, InlineJob> && std::is_invocable_v<std::decay_t<F>&>)
+    InlineJob(F&& f) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Size, "capture too big for InlineJob - capture a pointer to it instead");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "over-aligned capture");
+        static_assert(std::is_nothrow_move_constructible_v<Fn>, "jobs are moved in noexcept contexts");
+
+        new (m_storage) Fn(std::forward<F>(f));
+        m_ops = &ops<Fn>;
+    }
+
+    InlineJob(InlineJob&& other) noexcept { take(other); }
+
+    InlineJob& operator=(InlineJob&& other) noexcept {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    InlineJob(const InlineJob&) = delete;
+    InlineJob& operator=(const InlineJob&) = delete;
+
+    ~InlineJob() { reset(); }
+
+    void operator()() {
+        assert(m_ops != nullptr && "calling an empty InlineJob");
+        m_ops(Op::invoke, m_storage, nullptr);
+    }
+
+    explicit operator bool() const noexcept { return m_ops != nullptr; }
+
+    void reset() noexcept {
+        if (m_ops != nullptr) {
+            m_ops(Op::destroy, m_storage, nullptr);
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    enum class Op { invoke, relocate, destroy };
+    using Ops = void (*)(Op, void* self, void* from);
+
+    template <typename Fn>
+    static void ops(Op op, void* self, void* from) {
+        switch (op) {
+        case Op::invoke:
+            std::invoke(*static_cast<Fn*>(self));
+            break;
+        case Op::relocate:
+            if constexpr (std::is_trivially_copyable_v<Fn>) {
+                std::memcpy(self, from, sizeof(Fn));
+            } else {
+                new (self) Fn(std::move(*static_cast<Fn*>(from)));
+                static_cast<Fn*>(from)->~Fn();
+            }
+            break;
+        case Op::destroy:
+            static_cast<Fn*>(self)->~Fn();
+            break;
+        }
+    }
+
+    void take(InlineJob& other) noexcept {
+        m_ops = other.m_ops;
+        if (m_ops != nullptr) {
+            m_ops(Op::relocate, m_storage, other.m_storage);
+            other.m_ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) std::byte m_storage[Size];
+    Ops m_ops = nullptr;
+};
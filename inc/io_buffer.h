@@ -0,0 +1,430 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include <arena_allocator.h>
+#include <page_alloc.h>
+#include <small_vector.h>
+#include <unique_buffer.h>
+
+/*
+IoSlice / IoChain - reference-counted views of I/O memory, so bytes read from a file or socket
+are parsed where they landed instead of being copied into intermediate buffers.
+
+An IoBlock is one piece of storage with a reference count: a UniqueBuffer it has taken over, a
+chunk of an ArenaAllocator, or a read-only memory-mapped file. An IoSlice is a (block, pointer,
+length) view into one - copying it bumps the count, subslice() narrows it without touching the
+bytes, and the block is released with its last slice. An IoChain is a sequence of slices that
+reads as one byte stream, which is what a socket read or a message split across reads looks like.
+
+    IoChain space;                                   // free space to read into, 64 KiB blocks
+    for (int i = 0; i < 4; ++i) space.append(IoSlice::allocate(64 * 1024));
+    ssize_t n = read_into(fd, space);                // one readv across all four
+    IoChain data = space.split_front(n);             // the filled part, still the same memory
+    IoChain header = data.split_front(16);           // and so on - no memcpy anywhere
+    write_all(out_fd, std::move(data));              // one writev of whatever slices are left
+
+Block kinds:
+  allocate(n)    - a UniqueBuffer<std::byte, PageAlloc>; heap by default, or pages/huge pages
+  adopt(buffer)  - takes over an existing UniqueBuffer<std::byte> without copying it
+  in_arena(a, n) - the control block and the bytes both bump-allocated from the arena. releasing
+                   the last slice frees nothing; the arena takes the memory back on reset(), so
+                   every slice has to be gone by then
+  map_file(path) - a read-only MAP_PRIVATE view (MapViewOfFile on Windows), unmapped with the
+                   last slice
+
+Counts are atomic, so slices of one block can be passed between threads and dropped anywhere.
+Only a slice that is the sole reference to a writable block hands out mutable_bytes() - writing
+through a shared slice would change what the other holders see.
+
+read_into / write_from / write_all wrap readv / writev (POSIX only): a chain turns into an iovec
+array on the stack, at most io_max_iovecs slices per call.
+*/
+
+struct IoBlock {
+    std::atomic<uint32_t> refs{1};
+    bool writable = true;
+    std::byte* data = nullptr;
+    size_t size = 0;
+    void (*release)(IoBlock*) noexcept = nullptr;
+};
+
+namespace io_detail {
+
+template <typename Buffer>
+struct BufferBlock : IoBlock {
+    Buffer buffer;
+
+    explicit BufferBlock(Buffer&& b) : buffer(std::move(b)) {
+        data = buffer.data();
+        size = buffer.size();
+        release = [](IoBlock* self) noexcept { delete static_cast<BufferBlock*>(self); };
+    }
+};
+
+struct MappedBlock : IoBlock {
+    MappedBlock(void* view, size_t bytes) {
+        writable = false;
+        data = static_cast<std::byte*>(view);
+        size = bytes;
+        release = [](IoBlock* self) noexcept {
+            auto* block = static_cast<MappedBlock*>(self);
+#if defined(_WIN32)
+            UnmapViewOfFile(block->data);
+#else
+            munmap(block->data, block->size);
+#endif
+            delete block;
+        };
+    }
+};
+
+} // namespace io_detail
+
+struct MapOptions {
+    bool sequential = false;   // read-ahead hint for a front to back scan
+    bool populate = false;     // fault the whole file in up front (Linux)
+};
+
+class IoSlice
+{
+public:
+    IoSlice() noexcept = default;
+
+    // uninitialized storage - it is about to be read into
+    static IoSlice allocate(size_t size, PageOptions options = {}) {
+        return adopt(UniqueBuffer<std::byte, PageAlloc>(size, PageAlloc(options)));
+    }
+
+    // takes the buffer over as is: the slice covers all of it and data() is the buffer's data()
+    template <typename Alloc, size_t Align>
+    static IoSlice adopt(UniqueBuffer<std::byte, Alloc, Align>&& buffer) {
+        if (buffer.size() == 0) return IoSlice();
+        auto* block = new io_detail::BufferBlock<UniqueBuffer<std::byte, Alloc, Align>>(std::move(buffer));
+        return IoSlice(block, block->data, block->size);
+    }
+
+    // throws std::bad_alloc when the arena can't grow
+    static IoSlice in_arena(ArenaAllocator& arena, size_t size, size_t alignment = alignof(std::max_align_t)) {
+        if (size == 0) return IoSlice();
+        void* header = arena.allocate(sizeof(IoBlock), alignof(IoBlock));
+        void* bytes = header ? arena.allocate(size, alignment) : nullptr;
+        if (bytes == nullptr) throw std::bad_alloc();
+
+        auto* block = ::new (header) IoBlock;
+        block->data = static_cast<std::byte*>(bytes);
+        block->size = size;
+        block->release = [](IoBlock*) noexcept {};
+        return IoSlice(block, block->data, size);
+    }
+
+    IoSlice(const IoSlice& other) noexcept : m_block(other.m_block), m_data(other.m_data), m_size(other.m_size) {
+        if (m_block) m_block->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    IoSlice(IoSlice&& other) noexcept
+        : m_block(std::exchange(other.m_block, nullptr)),
+          m_data(std::exchange(other.m_data, nullptr)),
+          m_size(std::exchange(other.m_size, 0)) {}
+
+    IoSlice& operator=(IoSlice other) noexcept {
+        std::swap(m_block, other.m_block);
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    ~IoSlice() { reset(); }
+
+    void reset() noexcept {
+        if (m_block && m_block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_block->release(m_block);
+        }
+        m_block = nullptr;
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const std::byte* data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+
+    std::span<const std::byte> bytes() const noexcept { return {m_data, m_size}; }
+    std::string_view view() const noexcept { return {reinterpret_cast<const char*>(m_data), m_size}; }
+
+    // slices (of any range) sharing our block, ourselves included
+    uint32_t use_count() const noexcept { return m_block ? m_block->refs.load(std::memory_order_acquire) : 0; }
+    bool writable() const noexcept { return m_block && m_block->writable; }
+
+    // for filling a buffer nobody else can see yet
+    std::span<std::byte> mutable_bytes() noexcept {
+        assert((empty() || (writable() && use_count() == 1)) && "writing through a shared or read-only slice");
+        return {m_data, m_size};
+    }
+
+    // another view of the same bytes - no copy, one more reference
+    IoSlice subslice(size_t offset, size_t length = SIZE_MAX) const noexcept {
+        assert(offset <= m_size && "subslice past the end");
+        IoSlice part(*this);
+        part.m_data += offset;
+        part.m_size = std::min(length, m_size - offset);
+        return part;
+    }
+
+    void remove_prefix(size_t n) noexcept {
+        assert(n <= m_size);
+        m_data += n;
+        m_size -= n;
+    }
+
+    void truncate(size_t n) noexcept { m_size = std::min(n, m_size); }
+
+private:
+    friend class IoChain;
+    friend IoSlice map_file(const std::filesystem::path& path, MapOptions options);
+
+    IoSlice(IoBlock* block, std::byte* data, size_t size) noexcept : m_block(block), m_data(data), m_size(size) {}
+
+    IoBlock* m_block = nullptr;
+    std::byte* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+class IoChain
+{
+public:
+    IoChain() = default;
+    explicit IoChain(IoSlice slice) { append(std::move(slice)); }
+
+    IoChain(IoChain&&) noexcept = default;
+    IoChain& operator=(IoChain&&) noexcept = default;
+    IoChain(const IoChain&) = default;              // copies slices, never bytes
+    IoChain& operator=(const IoChain&) = default;
+
+    void append(IoSlice slice) {
+        if (slice.empty()) return;
+        m_size += slice.size();
+        m_slices.push_back(std::move(slice));
+    }
+
+    void append(IoChain other) {
+        for (IoSlice& slice : other.m_slices) append(std::move(slice));
+    }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    size_t slice_count() const noexcept { return m_slices.size(); }
+    const IoSlice& slice(size_t i) const { return m_slices[i]; }
+
+    const IoSlice* begin() const noexcept { return m_slices.begin(); }
+    const IoSlice* end() const noexcept { return m_slices.end(); }
+
+    // removes the first n bytes and returns them as their own chain; a slice straddling the cut
+    // is split into two views of the same block
+    IoChain split_front(size_t n) {
+        assert(n <= m_size && "split past the end of the chain");
+        IoChain front;
+        size_t taken = 0;   // whole slices moved out
+        for (IoSlice& slice : m_slices) {
+            if (n == 0) break;
+            if (slice.size() <= n) {
+                n -= slice.size();
+                front.append(std::move(slice));
+                ++taken;
+            } else {
+                front.append(slice.subslice(0, n));
+                slice.remove_prefix(n);
+                n = 0;
+            }
+        }
+        m_size -= front.size();
+        erase_front(taken);
+        return front;
+    }
+
+    void drop_front(size_t n) { split_front(n); }
+
+    // copies up to out.size() bytes starting at offset; returns how many
+    size_t copy_to(std::span<std::byte> out, size_t offset = 0) const noexcept {
+        size_t copied = 0;
+        for (const IoSlice& slice : m_slices) {
+            if (copied == out.size()) break;
+            if (offset >= slice.size()) {
+                offset -= slice.size();
+                continue;
+            }
+            size_t const n = std::min(slice.size() - offset, out.size() - copied);
+            std::memcpy(out.data() + copied, slice.data() + offset, n);
+            copied += n;
+            offset = 0;
+        }
+        return copied;
+    }
+
+    // the chain as one contiguous slice: free for a single slice, otherwise the one copy a
+    // parser that can't deal with pieces has to pay
+    IoSlice coalesce() const {
+        if (m_slices.empty()) return IoSlice();
+        if (m_slices.size() == 1) return m_slices[0];
+        IoSlice joined = IoSlice::allocate(m_size);
+        copy_to(joined.mutable_bytes());
+        return joined;
+    }
+
+private:
+    void erase_front(size_t n) {
+        if (n == 0) return;
+        if (n == m_slices.size()) {
+            m_slices.clear();
+            return;
+        }
+        IoSlice* data = m_slices.data();
+        std::move(data + n, data + m_slices.size(), data);
+        m_slices.resize(m_slices.size() - n);
+    }
+
+    SmallVector<IoSlice, 4> m_slices;
+    size_t m_size = 0;
+};
+
+// the whole file as one read-only slice; an empty file maps to an empty slice.
+// throws std::system_error when the file can't be opened or mapped
+inline IoSlice map_file(const std::filesystem::path& path, MapOptions options = {}) {
+#if defined(_WIN32)
+    DWORD const flags = FILE_ATTRIBUTE_NORMAL | (options.sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0);
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "open " + path.string());
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return IoSlice();
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping) CloseHandle(mapping);   // the view keeps the mapping alive
+    if (view == nullptr) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "map " + path.string());
+    }
+    size_t const bytes = static_cast<size_t>(size.QuadPart);
+#else
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::system_category(), "open " + path.string());
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return IoSlice();
+    }
+    size_t const bytes = static_cast<size_t>(info.st_size);
+    int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    if (options.populate) flags |= MAP_POPULATE;
+#endif
+    void* view = mmap(nullptr, bytes, PROT_READ, flags, fd, 0);
+    int const error = errno;
+    ::close(fd);   // the mapping keeps the file alive
+    if (view == MAP_FAILED) throw std::system_error(error, std::system_category(), "mmap " + path.string());
+    if (options.sequential) madvise(view, bytes, MADV_SEQUENTIAL);
+#endif
+    auto* block = new io_detail::MappedBlock(view, bytes);
+    return IoSlice(block, block->data, bytes);
+}
+
+#if !defined(_WIN32)
+
+// slices per readv / writev; the rest of a longer chain waits for the next call
+inline constexpr size_t io_max_iovecs = 64;
+
+namespace io_detail {
+
+// the chain as iovecs, up to io_max_iovecs of them
+inline size_t gather(const IoChain& chain, iovec* out) noexcept {
+    size_t n = 0;
+    for (const IoSlice& slice : chain) {
+        if (n == io_max_iovecs) break;
+        out[n++] = iovec{const_cast<std::byte*>(slice.data()), slice.size()};
+    }
+    return n;
+}
+
+} // namespace io_detail
+
+// one readv into the free space in `space` (slices you own and nobody else is reading). returns
+// what readv does - bytes read, 0 at end of file, -1 with errno set - but retries EINTR.
+// space.split_front(n) then gives the filled part.
+inline ssize_t read_into(int fd, const IoChain& space) noexcept {
+    iovec iov[io_max_iovecs];
+    size_t const count = io_detail::gather(space, iov);
+    for (size_t i = 0; i < count; ++i) {
+        assert(space.slice(i).writable() && "reading into a read-only slice");
+    }
+    ssize_t n;
+    do {
+        n = ::readv(fd, iov, static_cast<int>(count));
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+// reads up to max_bytes in block_size slices, appending what arrived to `into`
+inline ssize_t read_chain(int fd, IoChain& into, size_t max_bytes, size_t block_size = 64 * 1024) {
+    IoChain space;
+    for (size_t left = max_bytes; left > 0 && space.slice_count() < io_max_iovecs; left -= std::min(left, block_size)) {
+        space.append(IoSlice::allocate(std::min(left, block_size)));
+    }
+    ssize_t const n = read_into(fd, space);
+    if (n > 0) into.append(space.split_front(static_cast<size_t>(n)));
+    return n;
+}
+
+// one writev of the front of the chain. returns bytes written or -1 with errno set (EINTR is
+// retried); data.drop_front(n) moves past what went out
+inline ssize_t write_from(int fd, const IoChain& data) noexcept {
+    iovec iov[io_max_iovecs];
+    size_t const count = io_detail::gather(data, iov);
+    ssize_t n;
+    do {
+        n = ::writev(fd, iov, static_cast<int>(count));
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+// writes the whole chain, however many writev calls it takes (blocking descriptors).
+// throws std::system_error on failure
+inline void write_all(int fd, IoChain data) {
+    while (!data.empty()) {
+        ssize_t const n = write_from(fd, data);
+        if (n < 0) throw std::system_error(errno, std::system_category(), "writev");
+        data.drop_front(static_cast<size_t>(n));
+    }
+}
+
+#endif
@@ -0,0 +1,362 @@
+#pragma once
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define IO_URING_LINUX
+#endif
+
+#if defined(IO_URING_LINUX)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <utility>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <inline_job.h>
+#include <io_buffer.h>
+#include <pool_allocator.h>
+#include <small_vector.h>
+#include <thread_pool.h>
+
+/*
+IoUring - asynchronous reads and writes of IoSlices through Linux io_uring, with each completion
+handed to a ThreadPool as a job.
+
+    IoUring ring(pool);
+    ring.read(fd, offset, 1 << 20, [](IoSlice data, int error) {
+        parse(data.view());          // on a worker, straight out of the buffer the kernel filled
+    });
+    ring.wait();                     // submit, block for a completion, hand it to the pool
+
+Operations are queued as submission entries and go to the kernel on submit(), poll() or wait()
+(or when the submission ring fills up). Nothing reaps completions by itself: poll() takes
+whatever has finished without blocking, wait(n) blocks in io_uring_enter until n have. Each
+completion becomes one pool job that runs the callback - so the thread driving the ring only
+moves buffers, and parsing happens on the workers. Callbacks may queue more I/O; drain() loops
+until both the kernel and the pool are done with everything, and the destructor drains.
+
+Submission and completion each take their own mutex, so any thread (a callback on a worker, say)
+can queue operations while another is blocked in wait(). wait() keeps the completion mutex while
+it blocks, which makes a poll() from elsewhere wait its turn instead of taking the completions
+wait() is counting on. The rings are set up with raw syscalls
+against <linux/io_uring.h>, no liburing. Read/write use IORING_OP_READV / WRITEV, which every
+io_uring kernel has.
+
+A callback is stored in an InlineJob next to the request pointer, so its captures get 40 bytes.
+It runs as a pool job, so like any job it must not throw.
+Containers and kernels with io_uring disabled make the constructor throw std::system_error;
+supported() checks first.
+*/
+class IoUring
+{
+public:
+    // for pipes, sockets, or "wherever the file position is"
+    static constexpr uint64_t current_position = UINT64_MAX;
+
+    explicit IoUring(ThreadPool& pool, unsigned entries = 256) : m_pool(pool) {
+        io_uring_params params{};
+        int const fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) throw std::system_error(errno, std::system_category(), "io_uring_setup");
+        m_fd = fd;
+        try {
+            map_rings(params);
+        } catch (...) {
+            unmap_rings();
+            ::close(m_fd);
+            throw;
+        }
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring() {
+        drain();
+        unmap_rings();
+        ::close(m_fd);
+    }
+
+    // whether this kernel (and seccomp profile) lets us set up a ring at all
+    static bool supported() noexcept {
+        static bool const ok = [] {
+            io_uring_params params{};
+            int const fd = static_cast<int>(syscall(__NR_io_uring_setup, 1, &params));
+            if (fd < 0) return false;
+            ::close(fd);
+            return true;
+        }();
+        return ok;
+    }
+
+    // reads up to `bytes` into a fresh slice; done(IoSlice data, int error) with data trimmed to
+    // what was read (empty at end of file) and error an errno value or 0
+    template <typename F>
+    void read(int fd, uint64_t offset, size_t bytes, F&& done) {
+        read_into(fd, offset, IoChain(IoSlice::allocate(bytes)),
+                  [f = std::forward<F>(done)](IoChain filled, int error) mutable {
+                      f(filled.empty() ? IoSlice() : filled.slice(0), error);
+                  });
+    }
+
+    // readv into the caller's free space; done(IoChain filled, int error) gets its filled front
+    template <typename F>
+    void read_into(int fd, uint64_t offset, IoChain space, F&& done) {
+        Request* req = make_request(std::move(space));
+        req->done = [req, f = std::forward<F>(done)]() mutable {
+            size_t const n = req->result > 0 ? static_cast<size_t>(req->result) : 0;
+            f(req->buffers.split_front(std::min(n, req->buffers.size())), req->result < 0 ? -req->result : 0);
+        };
+        queue(IORING_OP_READV, fd, offset, req);
+    }
+
+    // writev of the chain (its first io_max_iovecs slices); done(size_t written, int error).
+    // the chain is kept alive until the kernel is done with it
+    template <typename F>
+    void write(int fd, uint64_t offset, IoChain data, F&& done) {
+        Request* req = make_request(std::move(data));
+        req->done = [req, f = std::forward<F>(done)]() mutable {
+            f(req->result > 0 ? static_cast<size_t>(req->result) : size_t{0}, req->result < 0 ? -req->result : 0);
+        };
+        queue(IORING_OP_WRITEV, fd, offset, req);
+    }
+
+    // hands everything queued to the kernel; returns how many entries it took
+    size_t submit() {
+        std::scoped_lock lock(m_submit_mutex);
+        return flush();
+    }
+
+    // moves every finished operation to the pool without blocking; returns how many
+    size_t poll() {
+        submit();
+        return reap();
+    }
+
+    // submits, then blocks until at least `min` operations (no more than are in flight) finish
+    size_t wait(size_t min = 1) {
+        SmallVector<Request*, 32> done;
+        {
+            // counting, blocking and reaping under one lock: a poll() that took the completions
+            // we are counting on in between would leave us asleep in the kernel for good. anything
+            // counted here was queued before the submit below, so the kernel has it.
+            std::scoped_lock lock(m_reap_mutex);
+            size_t const want = std::min<size_t>(min, m_in_kernel.load(std::memory_order_acquire));
+            submit();
+            if (want > 0) {
+                while (enter(0, static_cast<unsigned>(want), IORING_ENTER_GETEVENTS) < 0) {
+                    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                        throw std::system_error(errno, std::system_category(), "io_uring_enter");
+                    }
+                }
+            }
+            take_completions(done);
+        }
+        return hand_out(done);
+    }
+
+    // until every operation has completed and its callback has run, including operations those
+    // callbacks queued. helps the pool run jobs meanwhile
+    void drain() {
+        while (m_in_kernel.load(std::memory_order_acquire) > 0 || m_outstanding.load(std::memory_order_acquire) > 0) {
+            if (m_in_kernel.load(std::memory_order_acquire) > 0) {
+                wait(1);
+            }
+            m_pool.wait_until([this] {
+                return m_outstanding.load(std::memory_order_acquire) == 0 || m_in_kernel.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+    // queued or with the kernel, not yet reaped
+    size_t in_flight() const noexcept { return m_in_kernel.load(std::memory_order_acquire); }
+
+private:
+    struct Request {
+        IoChain buffers;
+        SmallVector<iovec, 4> iov;
+        int32_t result = 0;
+        InlineJob<> done;
+    };
+
+    Request* make_request(IoChain buffers) {
+        Request* req = m_requests.create();
+        req->buffers = std::move(buffers);
+        size_t const count = std::min(req->buffers.slice_count(), io_max_iovecs);
+        for (size_t i = 0; i < count; ++i) {
+            const IoSlice& slice = req->buffers.slice(i);
+            req->iov.push_back(iovec{const_cast<std::byte*>(slice.data()), slice.size()});
+        }
+        m_outstanding.fetch_add(1, std::memory_order_relaxed);
+        return req;
+    }
+
+    void queue(uint8_t opcode, int fd, uint64_t offset, Request* req) {
+        std::unique_lock lock(m_submit_mutex);
+        while (m_sq_tail_local - std::atomic_ref<uint32_t>(*m_sq_head).load(std::memory_order_acquire) >= m_sq_entries) {
+            // full: push what we have to the kernel, which frees the entries right away - unless
+            // the completion ring is backed up too, then make room there first
+            if (flush() == 0) {
+                lock.unlock();
+                reap();
+                lock.lock();
+            }
+        }
+        uint32_t const tail = m_sq_tail_local;
+        uint32_t const index = tail & m_sq_mask;
+        io_uring_sqe& sqe = m_sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.off = offset;
+        sqe.addr = reinterpret_cast<uint64_t>(req->iov.data());
+        sqe.len = static_cast<uint32_t>(req->iov.size());
+        sqe.user_data = reinterpret_cast<uint64_t>(req);
+        m_sq_array[index] = index;
+
+        m_sq_tail_local = tail + 1;
+        std::atomic_ref<uint32_t>(*m_sq_tail).store(m_sq_tail_local, std::memory_order_release);
+        m_in_kernel.fetch_add(1, std::memory_order_relaxed);
+        ++m_unsubmitted;
+    }
+
+    // caller holds m_submit_mutex. stops early (EBUSY) when the completion ring is full
+    size_t flush() {
+        size_t submitted = 0;
+        while (m_unsubmitted > 0) {
+            int const n = enter(m_unsubmitted, 0, 0);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                if (errno == EBUSY) break;
+                throw std::system_error(errno, std::system_category(), "io_uring_enter");
+            }
+            m_unsubmitted -= static_cast<unsigned>(n);
+            submitted += static_cast<size_t>(n);
+        }
+        return submitted;
+    }
+
+    // completions go to the pool after the lock is dropped - a full pool runs the job right here,
+    // and its callback may well queue or reap more
+    size_t reap() {
+        SmallVector<Request*, 32> done;
+        {
+            std::scoped_lock lock(m_reap_mutex);
+            take_completions(done);
+        }
+        return hand_out(done);
+    }
+
+    // caller holds m_reap_mutex. m_in_kernel drops under it too, so a reaper holding the lock
+    // sees exactly what is still to come
+    void take_completions(SmallVector<Request*, 32>& done) {
+        std::atomic_ref<uint32_t> head_ref(*m_cq_head);
+        uint32_t head = head_ref.load(std::memory_order_relaxed);
+        uint32_t const tail = std::atomic_ref<uint32_t>(*m_cq_tail).load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            io_uring_cqe const& cqe = m_cqes[head & m_cq_mask];
+            auto* req = reinterpret_cast<Request*>(cqe.user_data);
+            req->result = cqe.res;
+            done.push_back(req);
+        }
+        head_ref.store(head, std::memory_order_release);
+        m_in_kernel.fetch_sub(done.size(), std::memory_order_release);
+    }
+
+    size_t hand_out(const SmallVector<Request*, 32>& done) {
+        for (Request* req : done) {
+            m_pool.submit([this, req] {
+                req->done();
+                m_requests.destroy(req);
+                m_outstanding.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        return done.size();
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags) noexcept {
+        return static_cast<int>(syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    void map_rings(const io_uring_params& p) {
+        m_sq_bytes = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        m_cq_bytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool const single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) m_sq_bytes = m_cq_bytes = std::max(m_sq_bytes, m_cq_bytes);
+
+        m_sq_ring = map(m_sq_bytes, IORING_OFF_SQ_RING);
+        m_cq_ring = single ? m_sq_ring : map(m_cq_bytes, IORING_OFF_CQ_RING);
+        m_sqes_bytes = p.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = static_cast<io_uring_sqe*>(map(m_sqes_bytes, IORING_OFF_SQES));
+
+        auto* sq = static_cast<std::byte*>(m_sq_ring);
+        m_sq_head = reinterpret_cast<uint32_t*>(sq + p.sq_off.head);
+        m_sq_tail = reinterpret_cast<uint32_t*>(sq + p.sq_off.tail);
+        m_sq_mask = *reinterpret_cast<uint32_t*>(sq + p.sq_off.ring_mask);
+        m_sq_entries = *reinterpret_cast<uint32_t*>(sq + p.sq_off.ring_entries);
+        m_sq_array = reinterpret_cast<uint32_t*>(sq + p.sq_off.array);
+        m_sq_tail_local = *m_sq_tail;
+
+        auto* cq = static_cast<std::byte*>(m_cq_ring);
+        m_cq_head = reinterpret_cast<uint32_t*>(cq + p.cq_off.head);
+        m_cq_tail = reinterpret_cast<uint32_t*>(cq + p.cq_off.tail);
+        m_cq_mask = *reinterpret_cast<uint32_t*>(cq + p.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    }
+
+    void* map(size_t bytes, uint64_t offset) {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, static_cast<off_t>(offset));
+        if (p == MAP_FAILED) throw std::system_error(errno, std::system_category(), "mmap io_uring");
+        return p;
+    }
+
+    void unmap_rings() noexcept {
+        if (m_sqes) munmap(m_sqes, m_sqes_bytes);
+        if (m_cq_ring && m_cq_ring != m_sq_ring) munmap(m_cq_ring, m_cq_bytes);
+        if (m_sq_ring) munmap(m_sq_ring, m_sq_bytes);
+        m_sqes = nullptr;
+        m_cq_ring = m_sq_ring = nullptr;
+    }
+
+    ThreadPool& m_pool;
+    int m_fd = -1;
+
+    void* m_sq_ring = nullptr;
+    void* m_cq_ring = nullptr;
+    size_t m_sq_bytes = 0;
+    size_t m_cq_bytes = 0;
+    size_t m_sqes_bytes = 0;
+
+    // submission side, under m_submit_mutex
+    std::mutex m_submit_mutex;
+    io_uring_sqe* m_sqes = nullptr;
+    uint32_t* m_sq_head = nullptr;
+    uint32_t* m_sq_tail = nullptr;
+    uint32_t* m_sq_array = nullptr;
+    uint32_t m_sq_mask = 0;
+    uint32_t m_sq_entries = 0;
+    uint32_t m_sq_tail_local = 0;
+    unsigned m_unsubmitted = 0;
+
+    // completion side, under m_reap_mutex
+    std::mutex m_reap_mutex;
+    io_uring_cqe* m_cqes = nullptr;
+    uint32_t* m_cq_head = nullptr;
+    uint32_t* m_cq_tail = nullptr;
+    uint32_t m_cq_mask = 0;
+
+    std::atomic<size_t> m_in_kernel{0};     // queued, not yet reaped
+    std::atomic<size_t> m_outstanding{0};   // created, callback not yet finished
+    PoolAllocator<Request> m_requests{PoolOptions{ 64, true }};
+};
+
+#endif
@@ -20,34 +20,60 @@ Refactor:
 Why: Demonstrates mastery of atomic primitives, memory ordering, and thread coordination—key skills for engine bring-up on new platforms where every cycle and cache line counts.
 */
 
+#include <cache_line.h>
+#include <ebr.h>
 #include <unique_buffer.h>
+#include <algorithm>
 #include <atomic>
+#include <bit>
+#include <cstdint>
 #include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
 
+/*
+JobQueue - bounded MPMC ring (Dmitry Vyukov's design).
+
+Every cell carries a sequence number that says whose turn it is. For the cell at position pos:
+  sequence == pos       free, the producer that claims pos may write it
+  sequence == pos + 1   full, the consumer that claims pos may read it
+A producer only touches a cell after winning the CAS on m_write for exactly that position, and
+publishes it by storing pos + 1; a consumer hands the cell back one lap later by storing
+pos + capacity. So nobody ever writes a slot someone else owns, and a consumer never reads a
+slot before its producer is done - the two bugs the old push-then-CAS version had.
+
+Capacity is rounded up to a power of two so positions map to cells with a mask, and is at least
+two - with a single cell "full for this lap" and "free for the next" are the same sequence. Each cell gets a
+cache line of its own, which keeps neighbouring producers and consumers from false sharing.
+*/
 template <typename T>
 class JobQueue {
   public:
-    JobQueue<T>() : 
-        m_capacity(0), m_entries(0),
-        m_read(0), m_write(0)
-        {}
+    JobQueue() : JobQueue(0) {}
 
-    JobQueue<T>(const size_t capacity) : 
-          m_capacity(capacity), m_entries(capacity),
+    JobQueue(const size_t capacity) :
+          m_capacity(capacity == 0 ? 0 : std::bit_ceil(std::max<size_t>(capacity, 2))),
+          m_entries(m_capacity),
           m_read(0), m_write(0)
         {
+          for (size_t i = 0; i < m_capacity; ++i) {
+            m_entries[i].sequence.store(i, std::memory_order_relaxed);
+          }
         }
-    
-    JobQueue<T>(JobQueue<T>&& src)
-      : m_entries(std::move(src.m_entries)),
-        m_capacity(src.m_capacity),
+
+    // moving is not thread-safe - only move queues nobody is using yet
+    JobQueue(JobQueue&& src)
+      : m_capacity(src.m_capacity),
+        m_entries(std::move(src.m_entries)),
         m_read(src.m_read.load(std::memory_order_relaxed)),
         m_write(src.m_write.load(std::memory_order_relaxed)) {
         // mark the moved from object as empty but valid
         src.m_capacity = 0;
     }
 
-    JobQueue<T>& operator=(JobQueue<T>&& src) {
+    JobQueue& operator=(JobQueue&& src) {
       if (this != &src) {
         m_entries = std::move(src.m_entries);
         m_capacity = src.m_capacity;
@@ -58,77 +84,444 @@ class JobQueue {
       return *this;
     }
 
-    JobQueue<T> operator=(const JobQueue<T>& copy) = delete;
-    JobQueue<T>(const JobQueue<T>& copy) = delete;
-    
+    JobQueue& operator=(const JobQueue& copy) = delete;
+    JobQueue(const JobQueue& copy) = delete;
+
   private:
-    alignas(std::hardware_destructive_interference_size) std::atomic<size_t> m_write;
-    alignas(std::hardware_destructive_interference_size) std::atomic<size_t> m_read;
+    struct alignas(cache_line_size) Cell {
+      std::atomic<size_t> sequence;
+      T item;
+    };
 
-    UniqueBuffer<T> m_entries;
     size_t m_capacity;
+    UniqueBuffer<Cell> m_entries;
+
+    alignas(cache_line_size) std::atomic<size_t> m_read;
+    alignas(cache_line_size) std::atomic<size_t> m_write;
+
+    // set in m_write by close(). positions never get anywhere near it, and every producer CAS
+    // expects a value without it, so once set no new position can be claimed.
+    static constexpr size_t closed_bit = size_t(1) << (sizeof(size_t) * 8 - 1);
+
+    size_t mask() const noexcept { return m_capacity - 1; }
+
+    // bulk operations reserve a range by index alone, so a cell in it can still belong to a
+    // thread that claimed it a moment earlier and is finishing its move - wait that out. the
+    // window is a single move, never another thread's decision to come back later.
+    static void wait_for(Cell& cell, size_t sequence) noexcept {
+      for (int spin = 0; cell.sequence.load(std::memory_order_acquire) != sequence; ++spin) {
+        if (spin > 64) std::this_thread::yield();
+      }
+    }
 
   public:
-    bool push(T item) 
+    bool push(T item) { return try_push(item); }
+
+    // like push, but only moves from `item` when it succeeds - a failed push leaves it intact
+    bool try_push(T& item)
     {
-      size_t tail, head;
+      if (m_capacity == 0) return false;
+
+      size_t pos = m_write.load(std::memory_order_relaxed);
+      Cell* cell;
       while (true)
       {
-          tail = m_write.load(std::memory_order_relaxed);
-          head = m_read.load(std::memory_order_acquire);            // pairs with pop
+          if (pos & closed_bit) return false;
+          cell = &m_entries[pos & mask()];
+          size_t const seq = cell->sequence.load(std::memory_order_acquire);    // pairs with pop's release
+          intptr_t const diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
 
-          if (tail - head >= m_capacity) return false;               // full
+          if (diff == 0) {
+            // the cell is free for this lap - claim the position
+            if (m_write.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+          } else if (diff < 0) {
+            return false;                                              // full: a lap behind
+          } else {
+            pos = m_write.load(std::memory_order_relaxed);            // someone else claimed pos
+          }
+      }
+
+      cell->item = std::move(item);
+      cell->sequence.store(pos + 1, std::memory_order_release);       // publish to consumers
+      return true;
+    }
 
-          m_entries[tail % m_capacity] = item;                // fill
+    bool pop(T& out) {
+      if (m_capacity == 0) return false;
+
+      size_t pos = m_read.load(std::memory_order_relaxed);
+      Cell* cell;
+      while (true)
+      {
+          cell = &m_entries[pos & mask()];
+          size_t const seq = cell->sequence.load(std::memory_order_acquire);    // pairs with push's release
+          intptr_t const diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
 
-          if (m_write.compare_exchange_weak(tail, tail + 1,
-                                            std::memory_order_release,
-                                            std::memory_order_relaxed))
-          {
-            return true;
+          if (diff == 0) {
+            if (m_read.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+          } else if (diff < 0) {
+            return false;                                              // empty
+          } else {
+            pos = m_read.load(std::memory_order_relaxed);
           }
       }
+
+      out = std::move(cell->item);
+      cell->sequence.store(pos + m_capacity, std::memory_order_release); // free for the next lap
+      return true;
     }
 
-    bool pop(T& out) {
-      size_t head, tail;
+    // batched push: claims room for up to items.size() consecutive positions with one CAS on
+    // m_write and fills them in order. returns how many were pushed (fewer when the ring is
+    // nearly full, 0 when full). items are moved from.
+    size_t push_bulk(std::span<T> items)
+    {
+      if (m_capacity == 0 || items.empty()) return 0;
+
+      size_t pos = m_write.load(std::memory_order_relaxed);
+      size_t count;
       while (true)
       {
-          head = m_read.load(std::memory_order_relaxed);
-          tail = m_write.load(std::memory_order_acquire);            // pairs with push
-
-          if (tail == head) return false;                            // empty
-
-          if (m_read.compare_exchange_weak(head, head + 1,
-                                          std::memory_order_release,
-                                          std::memory_order_relaxed))
-          {
-              out = std::move(m_entries[head % m_capacity]);
-              return true;
-              break;                                                 // claimed slot
+          if (pos & closed_bit) return 0;
+          size_t const read = m_read.load(std::memory_order_acquire);
+          // read can be ahead of a stale pos - reload rather than under/overflow the room math
+          if (static_cast<intptr_t>(pos - read) < 0) {
+            pos = m_write.load(std::memory_order_relaxed);
+            continue;
           }
+          size_t const used = pos - read;
+          count = std::min(items.size(), m_capacity - std::min(used, m_capacity));
+          if (count == 0) return 0;
+          if (m_write.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) break;
       }
 
+      for (size_t k = 0; k < count; ++k) {
+        Cell& cell = m_entries[(pos + k) & mask()];
+        wait_for(cell, pos + k);                     // last lap's consumer may still be moving out
+        cell.item = std::move(items[k]);
+        cell.sequence.store(pos + k + 1, std::memory_order_release);
+      }
+      return count;
     }
 
-    bool steal(JobQueue<T>& victim, T& out) {
-      size_t head, tail;
+    // batched pop: claims up to max consecutive items with one CAS on m_read and moves them to
+    // out[0..n), oldest first. returns n.
+    size_t pop_bulk(T* out, size_t max)
+    {
+      if (m_capacity == 0 || max == 0) return 0;
+
+      size_t pos = m_read.load(std::memory_order_relaxed);
+      size_t count;
       while (true)
       {
-          head = victim.m_read.load(std::memory_order_relaxed);
-          tail = victim.m_write.load(std::memory_order_acquire);            // pairs with push
-
-          if (tail == head) return false;                            // empty
-
-          if (victim.m_read.compare_exchange_weak(head, head + 1,
-                                          std::memory_order_release,
-                                          std::memory_order_relaxed))
-          {
-              out = std::move(victim.m_entries[head % victim.m_capacity]);
-              return true;
-              break;                                                 // claimed slot
+          size_t const write = m_write.load(std::memory_order_acquire) & ~closed_bit;
+          if (static_cast<intptr_t>(write - pos) <= 0) {
+            // empty, unless our pos is stale
+            size_t const fresh = m_read.load(std::memory_order_relaxed);
+            if (fresh == pos) return 0;
+            pos = fresh;
+            continue;
           }
+          count = std::min(max, write - pos);
+          if (m_read.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) break;
+      }
+
+      for (size_t k = 0; k < count; ++k) {
+        Cell& cell = m_entries[(pos + k) & mask()];
+        wait_for(cell, pos + k + 1);                 // claimed by a producer, maybe not written yet
+        out[k] = std::move(cell.item);
+        cell.sequence.store(pos + k + m_capacity, std::memory_order_release);
+      }
+      return count;
+    }
+
+    // every consumer of an MPMC ring takes from the same end, so stealing is just popping the
+    // victim. kept for work-stealing callers - per-worker queues want WorkStealingDeque below.
+    bool steal(JobQueue<T>& victim, T& out) {
+      return victim.pop(out);
+    }
+
+    // stop accepting pushes for good - pushes already past their CAS still complete, anything
+    // after this fails. consumers keep draining as usual.
+    void close() noexcept { m_write.fetch_or(closed_bit, std::memory_order_acq_rel); }
+
+    bool closed() const noexcept { return (m_write.load(std::memory_order_acquire) & closed_bit) != 0; }
+
+    // closed and every position ever claimed has been claimed by a consumer too. nothing will
+    // ever come out of the ring again (though the last consumers may still be moving out).
+    bool drained() const noexcept {
+      size_t const write = m_write.load(std::memory_order_acquire);
+      return (write & closed_bit) != 0 && m_read.load(std::memory_order_acquire) == (write & ~closed_bit);
+    }
+
+    size_t capacity() const noexcept { return m_capacity; }
+
+    // a snapshot - only exact when nobody is pushing or popping
+    size_t size() const noexcept {
+      size_t const write = m_write.load(std::memory_order_relaxed) & ~closed_bit;
+      size_t const read = m_read.load(std::memory_order_relaxed);
+      return write > read ? write - read : 0;
+    }
+};
+
+/*
+GrowableJobQueue - a JobQueue that doubles instead of reporting full.
+
+The storage is a chain of JobQueue segments. Producers push into the tail segment; when that is
+full, one of them (under a mutex - growth is rare and already the slow path) closes it, links a
+segment of twice the capacity behind it and moves the tail there. Consumers pop from the head
+segment and move the head on once it is closed and drained. A closed segment takes no new pushes,
+so everything in it was pushed before anything in its successor and FIFO order holds across
+growth.
+
+Nothing is ever copied between rings, but a consumer that loaded the old head can still be
+inside it after another one has moved on. Every operation runs inside an EpochDomain guard
+(ebr.h) and outgrown segments are retired into the queue's domain instead of being freed on the
+spot. Segments are big and retired rarely, so the domain flushes on every retire rather than in
+batches. Whatever is still waiting goes with the queue.
+*/
+template <typename T>
+class GrowableJobQueue {
+  public:
+    explicit GrowableJobQueue(size_t initial_capacity = 64)
+      : m_head(new Segment(std::max<size_t>(initial_capacity, 1))),
+        m_tail(m_head.load(std::memory_order_relaxed)),
+        m_domain(1) {}
+
+    // retired segments go with m_domain
+    ~GrowableJobQueue() {
+      Segment* s = m_head.load(std::memory_order_relaxed);
+      while (s != nullptr) {
+        Segment* const next = s->next.load(std::memory_order_relaxed);
+        delete s;
+        s = next;
+      }
+    }
+
+    GrowableJobQueue(const GrowableJobQueue&) = delete;
+    GrowableJobQueue& operator=(const GrowableJobQueue&) = delete;
+
+    // never fails for lack of room; returns bool so it stays a drop-in for JobQueue
+    bool push(T item) {
+      EpochDomain::Guard guard(m_domain);
+      while (true) {
+        Segment* tail = m_tail.load(std::memory_order_seq_cst);
+        if (tail->ring.try_push(item)) return true;
+        grow(tail);
+      }
+    }
+
+    bool pop(T& out) {
+      EpochDomain::Guard guard(m_domain);
+      while (true) {
+        Segment* head = m_head.load(std::memory_order_seq_cst);
+        if (head->ring.pop(out)) return true;
+        if (!advance(head)) return false;
+      }
+    }
+
+    // all of items is pushed, growing as often as it takes
+    void push_bulk(std::span<T> items) {
+      EpochDomain::Guard guard(m_domain);
+      size_t done = 0;
+      while (done < items.size()) {
+        Segment* tail = m_tail.load(std::memory_order_seq_cst);
+        size_t const pushed = tail->ring.push_bulk(items.subspan(done));
+        done += pushed;
+        if (pushed == 0) grow(tail);
+      }
+    }
+
+    // up to max items from the head segment, oldest first. stops at a segment boundary, so a
+    // short count doesn't mean the queue is empty - an empty queue returns 0.
+    size_t pop_bulk(T* out, size_t max) {
+      if (max == 0) return 0;
+      EpochDomain::Guard guard(m_domain);
+      while (true) {
+        Segment* head = m_head.load(std::memory_order_seq_cst);
+        if (size_t const n = head->ring.pop_bulk(out, max)) return n;
+        if (!advance(head)) return 0;
       }
     }
 
-};
\ No newline at end of file
+    // capacity of the segment currently taking pushes - what an equivalent fixed ring would need
+    size_t capacity() const noexcept {
+      EpochDomain::Guard guard(m_domain);
+      return m_tail.load(std::memory_order_seq_cst)->ring.capacity();
+    }
+
+    // a snapshot - only exact when nobody is pushing or popping
+    size_t size() const noexcept {
+      EpochDomain::Guard guard(m_domain);
+      size_t total = 0;
+      for (Segment* s = m_head.load(std::memory_order_seq_cst); s != nullptr; s = s->next.load(std::memory_order_seq_cst)) {
+        total += s->ring.size();
+      }
+      return total;
+    }
+
+    // how many segments have been retired but not freed yet
+    size_t pending_reclaim() const noexcept { return m_domain.pending(); }
+
+  private:
+    struct Segment {
+      explicit Segment(size_t capacity) : ring(capacity) {}
+
+      JobQueue<T> ring;
+      std::atomic<Segment*> next{nullptr};
+    };
+
+    // the tail is full (or was closed under us): if nobody beat us to it, close it and chain
+    // a segment twice its size
+    void grow(Segment* tail) {
+      std::lock_guard lock(m_mutex);
+      if (m_tail.load(std::memory_order_seq_cst) != tail) return;
+
+      auto* next = new Segment(tail->ring.capacity() * 2);
+      tail->ring.close();
+      tail->next.store(next, std::memory_order_seq_cst);
+      m_tail.store(next, std::memory_order_seq_cst);
+    }
+
+    // head looked empty. true if the head moved on (by us or someone else) and the caller
+    // should look again, false if the queue really is empty right now.
+    bool advance(Segment* head) {
+      Segment* next = head->next.load(std::memory_order_seq_cst);
+      if (next == nullptr) return false;       // still the tail - just empty
+      if (!head->ring.drained()) return true;  // a closing push isn't published yet, retry
+
+      if (m_head.compare_exchange_strong(head, next, std::memory_order_seq_cst)) {
+        m_domain.retire(head);
+      }
+      return true;
+    }
+
+    alignas(cache_line_size) std::atomic<Segment*> m_head;
+    alignas(cache_line_size) std::atomic<Segment*> m_tail;
+
+    mutable EpochDomain m_domain;
+    std::mutex m_mutex;              // growth
+};
+
+/*
+WorkStealingDeque - Chase-Lev deque (the C11 formulation from Le, Pop, Cohen & Zappa Nardelli,
+"Correct and Efficient Work-Stealing for Weak Memory Models").
+
+One owner thread pushes and pops at the bottom, any number of thieves steal from the top. The
+owner works LIFO, so the job it just pushed - whose data is still in cache - is the next one it
+runs, while thieves take the oldest (and for fork-join, biggest) job. push() is plain loads and
+stores plus a release store; pop() adds one fence and only CASes when it races a thief for the
+very last element. Thieves CAS on top and never touch bottom.
+
+Slots are relaxed atomics, because a thief may read a slot the owner is about to reuse before its
+CAS tells it the read was stale - so T must be trivially copyable (job pointers, indices).
+Capacity is fixed and rounded up to a power of two; push() returns false when full.
+*/
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "slots are read speculatively by thieves");
+
+  public:
+    WorkStealingDeque() : WorkStealingDeque(0) {}
+
+    explicit WorkStealingDeque(size_t capacity)
+      : m_mask(capacity == 0 ? 0 : std::bit_ceil(capacity) - 1),
+        m_slots(capacity == 0 ? 0 : m_mask + 1) {}
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // owner only
+    bool push(T item) {
+      int64_t const bottom = m_bottom.load(std::memory_order_relaxed);
+      int64_t const top = m_top.load(std::memory_order_acquire);
+      if (bottom - top > static_cast<int64_t>(m_mask) || m_slots.size() == 0) return false;  // full
+
+      m_slots[static_cast<size_t>(bottom) & m_mask].store(item, std::memory_order_relaxed);
+      m_bottom.store(bottom + 1, std::memory_order_release);   // publishes the slot to thieves
+      return true;
+    }
+
+    // owner only - newest first
+    bool pop(T& out) {
+      int64_t const bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+      m_bottom.store(bottom, std::memory_order_relaxed);
+      // the reservation of `bottom` must be visible before we look at top, or a thief and the
+      // owner could both take the last element
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t top = m_top.load(std::memory_order_relaxed);
+
+      if (top > bottom) {                                       // empty
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return false;
+      }
+
+      T item = m_slots[static_cast<size_t>(bottom) & m_mask].load(std::memory_order_relaxed);
+      if (top == bottom) {
+        // last element - whoever moves top first gets it
+        bool const won = m_top.compare_exchange_strong(top, top + 1,
+                                                       std::memory_order_seq_cst,
+                                                       std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        if (!won) return false;
+      }
+      out = item;
+      return true;
+    }
+
+    // any thread - oldest first. false when empty or when another thread got there first.
+    bool steal(T& out) {
+      int64_t top = m_top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t const bottom = m_bottom.load(std::memory_order_acquire);
+      if (top >= bottom) return false;
+
+      T item = m_slots[static_cast<size_t>(top) & m_mask].load(std::memory_order_relaxed);
+      if (!m_top.compare_exchange_strong(top, top + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+        return false;
+      }
+      out = item;
+      return true;
+    }
+
+    // thief side: takes up to half of our elements (at most max). the oldest goes to `out` for
+    // the thief to run right away, the rest onto the bottom of `into`, which the calling thread
+    // must own. returns how many were taken in total, 0 if none.
+    // one CAS per element: claiming several at once with a single CAS on top would race the
+    // owner's uncontended pops of the same elements, which only synchronize on the very last
+    // one. what the batch saves is the victim search and the wakeups between steals.
+    size_t steal_half(WorkStealingDeque& into, T& out, size_t max = SIZE_MAX) {
+      // only the caller pushes onto `into` and thieves only ever shrink it, so room measured
+      // now can't disappear under us
+      size_t const room = into.capacity() - std::min(into.capacity(), into.size());
+      size_t const wanted = std::min({ max, (size() + 1) / 2, room + 1 });
+
+      if (wanted == 0 || !steal(out)) return 0;
+      size_t taken = 1;
+      T item;
+      while (taken < wanted && steal(item)) {
+        into.push(item);
+        ++taken;
+      }
+      return taken;
+    }
+
+    // a snapshot - only exact when nobody is pushing, popping or stealing
+    size_t size() const noexcept {
+      int64_t const bottom = m_bottom.load(std::memory_order_relaxed);
+      int64_t const top = m_top.load(std::memory_order_relaxed);
+      return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+    bool empty() const noexcept { return size() == 0; }
+    size_t capacity() const noexcept { return m_slots.size(); }
+
+  private:
+    // thieves hammer top, the owner lives on bottom - keep them on separate lines
+    alignas(cache_line_size) std::atomic<int64_t> m_top{0};
+    alignas(cache_line_size) std::atomic<int64_t> m_bottom{0};
+    alignas(cache_line_size) size_t m_mask;
+    UniqueBuffer<std::atomic<T>> m_slots;
+};
@@ -0,0 +1,412 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#include <cache_line.h>
+#include <unique_buffer.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define JOB_TRACE_TSC 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/*
+Trace policies for ThreadPool - a flight recorder of what every worker was doing.
+
+Build with CPP_REFRESH_JOB_TRACE defined (the CMake option of the same name) and the pool records,
+per worker:
+
+    job begin / end       with the worker's own queue depth at the start, as a counter track
+    steals                which victim, how many victims were tried first, how many jobs came over
+    park / unpark         so idle time shows up as a slice instead of a gap
+
+into its own TraceRing, and keeps per-worker counters (jobs run, steal attempts and successes,
+parks) next to it. Without the define the pool holds a NoJobTrace whose hooks are empty - the
+pool then compiles to exactly what it was, and anything that costs more than a hook call (queue
+depth reads) is additionally behind `if constexpr (PoolTrace::enabled)` on the pool side. The
+define changes the pool's layout, so it must be the same for every translation unit.
+
+    pool.trace().write_chrome_json(file);   // open in chrome://tracing or ui.perfetto.dev
+
+Rings are fixed size and overwrite their oldest events, so the dump is always the last
+events_per_worker events of each worker - what led up to the stall, not what started the run.
+Each ring has one writer (its worker; threads helping from outside the pool share one extra ring
+behind a mutex) that writes with plain relaxed stores, and a dump may run at any time: it copies
+the ring and then throws away whatever the writer may have overwritten while it copied.
+
+Timestamps are the TSC on x86 (a few ns to read, against tens for steady_clock) and are converted
+to microseconds against steady_clock when dumping; elsewhere they are steady_clock nanoseconds.
+*/
+
+#if defined(CPP_REFRESH_JOB_TRACE)
+inline constexpr bool job_trace_enabled = true;
+#else
+inline constexpr bool job_trace_enabled = false;
+#endif
+
+enum class TraceEventKind : uint8_t { job_begin, job_end, steal, park, unpark };
+
+struct TraceEvent {
+    uint64_t ticks = 0;
+    TraceEventKind kind = TraceEventKind::job_begin;
+    uint16_t arg0 = 0;   // job_begin: queue depth, steal: victim
+    uint32_t arg1 = 0;   // steal: victims tried, including the one that paid off (20 bits)
+    uint32_t arg2 = 0;   // steal: jobs taken (20 bits)
+};
+
+namespace trace_detail {
+
+inline uint64_t ticks() noexcept {
+#if defined(JOB_TRACE_TSC)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+inline uint64_t steady_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace trace_detail
+
+// single writer, any number of concurrent readers. each slot is a tiny seqlock: the writer
+// clears its sequence word, writes the event and then publishes the sequence (event index + 1),
+// and a reader keeps an event only if it saw that same sequence before and after copying it - so
+// torn slots and slots reused by a later lap are both caught.
+class TraceRing
+{
+public:
+    explicit TraceRing(size_t capacity)
+        : m_slots(std::bit_ceil(std::max<size_t>(capacity, 2))),
+          m_mask(m_slots.size() - 1) {}
+
+    void record(const TraceEvent& e) noexcept {
+        uint64_t const i = m_head.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[i & m_mask];
+        slot.seq.store(0, std::memory_order_relaxed);
+        // a reader whose copy sees any of the stores below also sees the 0 above in its re-check
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.ticks.store(e.ticks, std::memory_order_relaxed);
+        slot.payload.store(pack(e), std::memory_order_relaxed);
+        slot.seq.store(i + 1, std::memory_order_release);
+        m_head.store(i + 1, std::memory_order_release);
+    }
+
+    // the events still in the ring, oldest first - a consecutive run ending at the newest one
+    void snapshot(std::vector<TraceEvent>& out) const {
+        uint64_t const head = m_head.load(std::memory_order_acquire);
+        uint64_t const first = head > m_slots.size() ? head - m_slots.size() : 0;
+        size_t const start = out.size();
+        for (uint64_t i = first; i < head; ++i) {
+            Slot const& slot = m_slots[i & m_mask];
+            uint64_t const before = slot.seq.load(std::memory_order_acquire);
+            TraceEvent e = unpack(slot.payload.load(std::memory_order_relaxed));
+            e.ticks = slot.ticks.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t const after = slot.seq.load(std::memory_order_relaxed);
+            if (before != i + 1 || after != i + 1) {
+                // lapped: this event is gone, and so is everything older we already copied
+                out.resize(start);
+                continue;
+            }
+            out.push_back(e);
+        }
+    }
+
+    size_t capacity() const noexcept { return m_slots.size(); }
+
+    // events ever recorded, and how many of them have been overwritten since
+    uint64_t recorded() const noexcept { return m_head.load(std::memory_order_relaxed); }
+    uint64_t overwritten() const noexcept {
+        uint64_t const head = recorded();
+        return head > m_slots.size() ? head - m_slots.size() : 0;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};   // index + 1 of the event held, 0 while being written
+        std::atomic<uint64_t> ticks{0};
+        std::atomic<uint64_t> payload{0};
+    };
+
+    // [ arg2 : 20 | arg1 : 20 | arg0 : 16 | kind : 8 ], the args saturate
+    static constexpr uint32_t arg_max = 0xfffff;
+
+    static uint64_t pack(const TraceEvent& e) noexcept {
+        return static_cast<uint64_t>(e.kind) | (static_cast<uint64_t>(e.arg0) << 8) |
+               (static_cast<uint64_t>(std::min(e.arg1, arg_max)) << 24) |
+               (static_cast<uint64_t>(std::min(e.arg2, arg_max)) << 44);
+    }
+
+    static TraceEvent unpack(uint64_t bits) noexcept {
+        TraceEvent e;
+        e.kind = static_cast<TraceEventKind>(bits & 0xff);
+        e.arg0 = static_cast<uint16_t>((bits >> 8) & 0xffff);
+        e.arg1 = static_cast<uint32_t>((bits >> 24) & arg_max);
+        e.arg2 = static_cast<uint32_t>((bits >> 44) & arg_max);
+        return e;
+    }
+
+    UniqueBuffer<Slot> m_slots;
+    size_t const m_mask;
+    alignas(cache_line_size) std::atomic<uint64_t> m_head{0};
+};
+
+struct JobTraceCounters {
+    uint64_t jobs = 0;
+    uint64_t steal_attempts = 0;   // victims tried
+    uint64_t steals = 0;           // tries that came back with work
+    uint64_t jobs_stolen = 0;
+    uint64_t parks = 0;
+};
+
+struct NoJobTrace {
+    static constexpr bool enabled = false;
+    using Counters = JobTraceCounters;
+
+    explicit NoJobTrace(size_t, size_t = 0) noexcept {}
+
+    void on_job_begin(size_t, size_t) noexcept {}
+    void on_job_end(size_t) noexcept {}
+    void on_steal(size_t, size_t, size_t, size_t) noexcept {}
+    void on_steal_failed(size_t, size_t) noexcept {}
+    void on_park(size_t) noexcept {}
+    void on_unpark(size_t) noexcept {}
+
+    Counters counters(size_t) const noexcept { return {}; }
+    Counters totals() const noexcept { return {}; }
+
+    void write_chrome_json(std::ostream& out) const { out << "{\"traceEvents\":[]}\n"; }
+};
+
+class JobTrace
+{
+public:
+    static constexpr bool enabled = true;
+    static constexpr size_t default_events_per_worker = 16384;
+
+    using Counters = JobTraceCounters;
+
+    // `workers` rings, plus one for threads that help from outside the pool
+    explicit JobTrace(size_t workers, size_t events_per_worker = default_events_per_worker)
+        : m_workers(workers),
+          m_start_ticks(trace_detail::ticks()),
+          m_start_ns(trace_detail::steady_ns()) {
+        m_tracks.reserve(workers + 1);
+        for (size_t i = 0; i <= workers; ++i) {
+            m_tracks.push_back(std::make_unique<Track>(events_per_worker));
+        }
+    }
+
+    JobTrace(const JobTrace&) = delete;
+    JobTrace& operator=(const JobTrace&) = delete;
+
+    // `worker` is the worker index, or workers() for a thread helping from outside
+    void on_job_begin(size_t worker, size_t queue_depth) noexcept {
+        record(worker, [&](Track& t) {
+            bump(t.jobs);
+            t.ring.record(TraceEvent{trace_detail::ticks(), TraceEventKind::job_begin,
+                                     static_cast<uint16_t>(std::min<size_t>(queue_depth, 0xffff)), 0, 0});
+        });
+    }
+
+    void on_job_end(size_t worker) noexcept {
+        record(worker, [&](Track& t) { t.ring.record(TraceEvent{trace_detail::ticks(), TraceEventKind::job_end}); });
+    }
+
+    // attempts counts every victim tried in this sweep, the successful one included
+    void on_steal(size_t worker, size_t victim, size_t attempts, size_t taken) noexcept {
+        record(worker, [&](Track& t) {
+            bump(t.steal_attempts, attempts);
+            bump(t.steals);
+            bump(t.jobs_stolen, taken);
+            t.ring.record(TraceEvent{trace_detail::ticks(), TraceEventKind::steal,
+                                     static_cast<uint16_t>(std::min<size_t>(victim, 0xffff)),
+                                     static_cast<uint32_t>(attempts), static_cast<uint32_t>(taken)});
+        });
+    }
+
+    // a sweep that found nothing only counts - spinning workers would flood the ring otherwise
+    void on_steal_failed(size_t worker, size_t attempts) noexcept {
+        record(worker, [&](Track& t) { bump(t.steal_attempts, attempts); });
+    }
+
+    void on_park(size_t worker) noexcept {
+        record(worker, [&](Track& t) {
+            bump(t.parks);
+            t.ring.record(TraceEvent{trace_detail::ticks(), TraceEventKind::park});
+        });
+    }
+
+    void on_unpark(size_t worker) noexcept {
+        record(worker, [&](Track& t) { t.ring.record(TraceEvent{trace_detail::ticks(), TraceEventKind::unpark}); });
+    }
+
+    size_t workers() const noexcept { return m_workers; }
+
+    Counters counters(size_t worker) const noexcept {
+        Track const& t = *m_tracks[std::min(worker, m_workers)];
+        return Counters{t.jobs.load(std::memory_order_relaxed), t.steal_attempts.load(std::memory_order_relaxed),
+                        t.steals.load(std::memory_order_relaxed), t.jobs_stolen.load(std::memory_order_relaxed),
+                        t.parks.load(std::memory_order_relaxed)};
+    }
+
+    // every worker and the helper track summed
+    Counters totals() const noexcept {
+        Counters sum;
+        for (size_t i = 0; i <= m_workers; ++i) {
+            Counters const c = counters(i);
+            sum.jobs += c.jobs;
+            sum.steal_attempts += c.steal_attempts;
+            sum.steals += c.steals;
+            sum.jobs_stolen += c.jobs_stolen;
+            sum.parks += c.parks;
+        }
+        return sum;
+    }
+
+    // events ending up in the ring of `worker`, copied out oldest first
+    std::vector<TraceEvent> events(size_t worker) const {
+        std::vector<TraceEvent> out;
+        m_tracks[std::min(worker, m_workers)]->ring.snapshot(out);
+        return out;
+    }
+
+    // Chrome trace-event JSON (also what Perfetto imports): one thread per worker plus one for
+    // helping threads, jobs and parked spans as slices, steals as instant events and queue depth
+    // as a counter track per worker
+    void write_chrome_json(std::ostream& out) const {
+        // ticks -> microseconds, measured over the trace's whole lifetime
+        uint64_t const elapsed_ticks = trace_detail::ticks() - m_start_ticks;
+        uint64_t const elapsed_ns = trace_detail::steady_ns() - m_start_ns;
+        double const us_per_tick = elapsed_ticks == 0 || elapsed_ns == 0
+            ? 0.001
+            : static_cast<double>(elapsed_ns) / static_cast<double>(elapsed_ticks) / 1000.0;
+
+        auto const flags = out.flags();
+        auto const precision = out.precision();
+        out << std::fixed << std::setprecision(3);
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        auto const begin = [&] {
+            if (!first) out << ",\n";
+            first = false;
+        };
+
+        std::vector<TraceEvent> events;
+        for (size_t worker = 0; worker <= m_workers; ++worker) {
+            auto const tid = worker;
+            begin();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << tid << ",\"args\":{\"name\":\"";
+            if (worker == m_workers) {
+                out << "helping threads";
+            } else {
+                out << "worker " << worker;
+            }
+            out << "\"}}";
+
+            events.clear();
+            m_tracks[worker]->ring.snapshot(events);
+
+            // the ring may start in the middle of a slice - skip ends whose begin was overwritten
+            int jobs_open = 0;
+            bool parked = false;
+            for (TraceEvent const& e : events) {
+                double const ts = static_cast<double>(e.ticks - m_start_ticks) * us_per_tick;
+                switch (e.kind) {
+                case TraceEventKind::job_begin:
+                    ++jobs_open;
+                    begin();
+                    out << "{\"ph\":\"B\",\"name\":\"job\",\"pid\":0,\"tid\":" << tid << ",\"ts\":" << ts << "}";
+                    if (worker < m_workers) {
+                        begin();
+                        out << "{\"ph\":\"C\",\"name\":\"queue depth " << worker << "\",\"pid\":0,\"tid\":" << tid
+                            << ",\"ts\":" << ts << ",\"args\":{\"depth\":" << e.arg0 << "}}";
+                    }
+                    break;
+                case TraceEventKind::job_end:
+                    if (jobs_open == 0) break;
+                    --jobs_open;
+                    begin();
+                    out << "{\"ph\":\"E\",\"name\":\"job\",\"pid\":0,\"tid\":" << tid << ",\"ts\":" << ts << "}";
+                    break;
+                case TraceEventKind::steal:
+                    begin();
+                    out << "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"steal\",\"pid\":0,\"tid\":" << tid << ",\"ts\":" << ts
+                        << ",\"args\":{\"victim\":" << e.arg0 << ",\"attempts\":" << e.arg1 << ",\"taken\":" << e.arg2 << "}}";
+                    break;
+                case TraceEventKind::park:
+                    parked = true;
+                    begin();
+                    out << "{\"ph\":\"B\",\"name\":\"parked\",\"pid\":0,\"tid\":" << tid << ",\"ts\":" << ts << "}";
+                    break;
+                case TraceEventKind::unpark:
+                    if (!parked) break;
+                    parked = false;
+                    begin();
+                    out << "{\"ph\":\"E\",\"name\":\"parked\",\"pid\":0,\"tid\":" << tid << ",\"ts\":" << ts << "}";
+                    break;
+                }
+            }
+        }
+        out << "\n]}\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    // one per worker, on its own lines. counters are only written by the track's owner, so a
+    // relaxed load and store is enough - no RMW on the hot path
+    struct alignas(cache_line_size) Track {
+        explicit Track(size_t capacity) : ring(capacity) {}
+
+        TraceRing ring;
+        alignas(cache_line_size) std::atomic<uint64_t> jobs{0};
+        std::atomic<uint64_t> steal_attempts{0};
+        std::atomic<uint64_t> steals{0};
+        std::atomic<uint64_t> jobs_stolen{0};
+        std::atomic<uint64_t> parks{0};
+    };
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // the helper track has many writers - they take turns
+    template <typename F>
+    void record(size_t worker, F&& f) noexcept {
+        if (worker < m_workers) {
+            f(*m_tracks[worker]);
+            return;
+        }
+        std::scoped_lock lock(m_helper_mutex);
+        f(*m_tracks[m_workers]);
+    }
+
+    size_t const m_workers;
+    uint64_t const m_start_ticks;
+    uint64_t const m_start_ns;
+    std::vector<std::unique_ptr<Track>> m_tracks;
+    std::mutex m_helper_mutex;
+};
+
+using PoolTrace = std::conditional_t<job_trace_enabled, JobTrace, NoJobTrace>;
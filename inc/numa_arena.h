@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <arena_allocator.h>
+#include <cache_line.h>
+#include <page_alloc.h>
+#include <unique_buffer.h>
+
+/*
+NUMA-aware arena set - one ArenaAllocator per node, each one's blocks placed on that node.
+
+A single arena built on one thread serves every core from whichever node its pages happened to
+land on, so on a two socket box half the allocations are remote. Here every node gets its own
+arena whose blocks carry PageOptions::numa_node (mbind on Linux, VirtualAllocExNuma on Windows),
+and allocate() routes to the calling thread's node.
+
+Only when the local arena is full (fixed arenas) does a request spill to another node. That, and
+explicit allocate_on() calls for a node other than the caller's, count as remote hits - a high
+remote count means threads aren't where we expected or a node's arena is undersized.
+
+On machines without NUMA (or where the topology can't be read) there is just node 0.
+*/
+
+namespace numa {
+
+// highest node id + 1. node ids can be sparse, which just leaves some arenas unused.
+inline size_t node_count() {
+    static size_t const count = [] {
+#if defined(_WIN32)
+        ULONG highest = 0;
+        return GetNumaHighestNodeNumber(&highest) ? static_cast<size_t>(highest) + 1 : size_t(1);
+#elif defined(__linux__)
+        // e.g. "0", "0-1" or "0,2-3"
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string list;
+        if (!(online >> list)) return size_t(1);
+
+        size_t highest = 0;
+        size_t value = 0;
+        for (char c : list) {
+            if (c >= '0' && c <= '9') {
+                value = value * 10 + static_cast<size_t>(c - '0');
+            } else {
+                highest = std::max(highest, value);
+                value = 0;
+            }
+        }
+        return std::max(highest, value) + 1;
+#else
+        return size_t(1);
+#endif
+    }();
+    return count;
+}
+
+// the node the calling thread is running on right now. this is a syscall on Linux, so hot paths
+// go through cached_current_node() instead.
+inline size_t current_node() noexcept {
+#if defined(_WIN32)
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node = 0;
+    return GetNumaProcessorNodeEx(&processor, &node) ? node : 0;
+#elif defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+    return node;
+#else
+    return 0;
+#endif
+}
+
+// threads rarely migrate between sockets, so re-asking every so many calls is plenty
+inline size_t cached_current_node() noexcept {
+    constexpr uint32_t refresh_interval = 1024;
+    struct Cache {
+        size_t node = 0;
+        uint32_t calls = 0;
+    };
+    static thread_local Cache cache;
+    if (cache.calls++ % refresh_interval == 0) {
+        cache.node = current_node();
+    }
+    return cache.node;
+}
+
+} // namespace numa
+
+class NumaArenaSet
+{
+public:
+    // fixed arenas of bytes_per_node each. a full local arena spills to the other nodes before
+    // allocate() gives up and returns nullptr.
+    NumaArenaSet(size_t bytes_per_node, PageOptions pages = {})
+        : m_node_count(numa::node_count()),
+          m_nodes(m_node_count) {
+        for (size_t n = 0; n < m_node_count; ++n) {
+            m_nodes[n].arena = std::make_unique<ArenaAllocator>(bytes_per_node, on_node(pages, n));
+        }
+    }
+
+    // chained arenas - each node grows on its own, so allocate() never leaves the local node
+    NumaArenaSet(size_t initial_block_size, ArenaGrowth growth, PageOptions pages = {})
+        : m_node_count(numa::node_count()),
+          m_nodes(m_node_count) {
+        for (size_t n = 0; n < m_node_count; ++n) {
+            m_nodes[n].arena = std::make_unique<ArenaAllocator>(initial_block_size, growth, on_node(pages, n));
+        }
+    }
+
+    NumaArenaSet(const NumaArenaSet&) = delete;
+    NumaArenaSet& operator=(const NumaArenaSet&) = delete;
+
+    void* allocate(size_t object_size, size_t object_alignment) {
+        size_t const local = std::min(numa::cached_current_node(), m_node_count - 1);
+
+        if (void* p = m_nodes[local].arena->allocate(object_size, object_alignment)) {
+            m_nodes[local].local_hits.fetch_add(1, std::memory_order_relaxed);
+            return p;
+        }
+
+        for (size_t i = 1; i < m_node_count; ++i) {
+            size_t const n = (local + i) % m_node_count;
+            if (void* p = m_nodes[n].arena->allocate(object_size, object_alignment)) {
+                m_nodes[n].remote_hits.fetch_add(1, std::memory_order_relaxed);
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    // place an allocation on a specific node, e.g. a buffer a worker pinned there will consume
+    void* allocate_on(size_t node, size_t object_size, size_t object_alignment) {
+        if (node >= m_node_count) {
+            return nullptr;
+        }
+        void* p = m_nodes[node].arena->allocate(object_size, object_alignment);
+        if (p != nullptr) {
+            bool const local = node == std::min(numa::cached_current_node(), m_node_count - 1);
+            (local ? m_nodes[node].local_hits : m_nodes[node].remote_hits).fetch_add(1, std::memory_order_relaxed);
+        }
+        return p;
+    }
+
+    // same rules as ArenaAllocator::reset() - every node is rewound, counters are kept
+    void reset() {
+        for (size_t n = 0; n < m_node_count; ++n) {
+            m_nodes[n].arena->reset();
+        }
+    }
+
+    size_t node_count() const noexcept { return m_node_count; }
+    ArenaAllocator& node_arena(size_t node) { return *m_nodes[node].arena; }
+
+    // allocations served by `node` for a thread running on it / on some other node
+    uint64_t local_hits(size_t node) const noexcept { return m_nodes[node].local_hits.load(std::memory_order_relaxed); }
+    uint64_t remote_hits(size_t node) const noexcept { return m_nodes[node].remote_hits.load(std::memory_order_relaxed); }
+
+    uint64_t total_local_hits() const noexcept {
+        uint64_t total = 0;
+        for (size_t n = 0; n < m_node_count; ++n) total += local_hits(n);
+        return total;
+    }
+
+    uint64_t total_remote_hits() const noexcept {
+        uint64_t total = 0;
+        for (size_t n = 0; n < m_node_count; ++n) total += remote_hits(n);
+        return total;
+    }
+
+    void reset_stats() noexcept {
+        for (size_t n = 0; n < m_node_count; ++n) {
+            m_nodes[n].local_hits.store(0, std::memory_order_relaxed);
+            m_nodes[n].remote_hits.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static PageOptions on_node(PageOptions pages, size_t node) noexcept {
+        // a single node needs no binding, and skipping it keeps plain heap backing possible
+        if (numa::node_count() > 1) {
+            pages.numa_node = static_cast<int>(node);
+        }
+        return pages;
+    }
+
+    // counters are bumped by every thread on the node, so each node gets its own cache line
+    struct alignas(cache_line_size) Node {
+        std::unique_ptr<ArenaAllocator> arena;
+        std::atomic<uint64_t> local_hits{0};
+        std::atomic<uint64_t> remote_hits{0};
+    };
+
+    size_t const m_node_count;
+    UniqueBuffer<Node> m_nodes;
+};
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cache_line.h>
+
+/*
+PageAlloc - UniqueBuffer allocation policy for big, long-lived buffers (arena blocks, I/O staging).
+
+Nothing is ever value-initialized: mapped pages arrive zeroed from the OS, and heap backing is for
+storage that is about to be overwritten. So a 1 GiB arena costs nothing until its pages are used.
+
+  heap                   - aligned operator new, cache line aligned, no zeroing pass
+  pages                  - anonymous mmap / VirtualAlloc, page aligned
+  transparent_huge_pages - mmap + madvise(MADV_HUGEPAGE) so the kernel backs it with 2 MiB pages
+                           when it can (Linux; plain pages elsewhere)
+  huge_pages             - explicit MAP_HUGETLB / MEM_LARGE_PAGES. these need reserved huge pages
+                           (or SeLockMemoryPrivilege on Windows), so on failure we fall back to
+                           transparent huge pages rather than failing the allocation
+
+populate pre-faults the whole range up front (MAP_POPULATE, or touching each page elsewhere), for
+buffers where a page fault on the hot path is worse than paying for all of them at startup.
+
+numa_node asks for the pages to live on one NUMA node (mbind / VirtualAllocExNuma). it implies
+mapped pages even with heap backing, since a policy can only be set on whole pages. the policy is
+"preferred" rather than a hard bind, so an exhausted node spills instead of OOM-killing us, and if
+the kernel refuses the call entirely we are left with first-touch placement - which still puts the
+pages on the right node as long as the owning thread is the first to write them.
+*/
+
+enum class PageBacking { heap, pages, transparent_huge_pages, huge_pages };
+
+struct PageOptions {
+    PageBacking backing = PageBacking::heap;
+    bool populate = false;
+    int numa_node = -1;   // -1: wherever the OS likes
+};
+
+class PageAlloc
+{
+public:
+    static constexpr bool value_initialize = false;
+
+    PageAlloc() = default;
+    PageAlloc(PageOptions options) : m_options(options) {}
+
+    void* allocate(size_t bytes, size_t alignment) {
+        if (uses_heap()) {
+            void* p = ::operator new(bytes, std::align_val_t(std::max(alignment, cache_line_size)));
+            if (m_options.populate) touch(p, bytes, os_page_size());
+            return p;
+        }
+
+        void* p = map(bytes);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    // the mapping's length comes from bytes, rounded the way map() rounded it - never from
+    // m_mapped, which belongs to whichever mapping was made last (a growing UniqueBuffer maps
+    // the new block before it frees the old one)
+    void deallocate(void* p, size_t bytes, size_t alignment) noexcept {
+        if (uses_heap()) {
+            ::operator delete(p, std::align_val_t(std::max(alignment, cache_line_size)));
+            return;
+        }
+        unmap(p, bytes);
+    }
+
+    // growing a mapping: mremap on Linux, which moves page table entries instead of copying and
+    // keeps the node binding and huge page advice. pages added this way aren't pre-faulted.
+    // heap backing and other platforms decline, and UniqueBuffer copies instead.
+    void* reallocate(void* p, size_t old_bytes, size_t new_bytes, size_t) noexcept {
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+        if (uses_heap()) {
+            return nullptr;
+        }
+        size_t const old_len = mapping_length(old_bytes);
+        size_t const len = mapping_length(new_bytes);
+        if (len <= old_len) {
+            return p; // the rounding already left enough room
+        }
+        void* grown = mremap(p, old_len, len, MREMAP_MAYMOVE);
+        if (grown == MAP_FAILED) {
+            return nullptr;
+        }
+        m_mapped = len;
+        return grown;
+#else
+        (void)p;
+        (void)old_bytes;
+        (void)new_bytes;
+        return nullptr;
+#endif
+    }
+
+    const PageOptions& options() const noexcept { return m_options; }
+
+    // what the last allocate() (or reallocate()) actually got - huge_pages may have fallen back.
+    // for inspection only; freeing goes by the size the caller passes back
+    bool huge_backed() const noexcept { return m_huge_backed; }
+    size_t mapped_bytes() const noexcept { return m_mapped; }
+
+    static size_t os_page_size() noexcept {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+private:
+    bool uses_heap() const noexcept {
+        return m_options.backing == PageBacking::heap && m_options.numa_node < 0;
+    }
+
+    static size_t round_up(size_t value, size_t granularity) noexcept {
+        return (value + granularity - 1) / granularity * granularity;
+    }
+
+    // how map() rounds a request on POSIX: explicit and transparent huge pages both take whole
+    // 2 MiB pages (MAP_HUGETLB asks for 2 MiB pages and falls back to THP at the same length),
+    // everything else os pages
+    size_t mapping_length(size_t bytes) const noexcept {
+        bool const huge = m_options.backing == PageBacking::transparent_huge_pages ||
+                          m_options.backing == PageBacking::huge_pages;
+        return round_up(bytes, huge ? huge_page_size : os_page_size());
+    }
+
+    static void touch(void* p, size_t bytes, size_t page) noexcept {
+        volatile std::byte* bytes_ptr = static_cast<std::byte*>(p);
+        for (size_t offset = 0; offset < bytes; offset += page) {
+            bytes_ptr[offset] = std::byte{0};
+        }
+    }
+
+#if defined(_WIN32)
+    void* virtual_alloc(size_t len, DWORD type) noexcept {
+        if (m_options.numa_node >= 0) {
+            return VirtualAllocExNuma(GetCurrentProcess(), nullptr, len, type, PAGE_READWRITE,
+                                      static_cast<DWORD>(m_options.numa_node));
+        }
+        return VirtualAlloc(nullptr, len, type, PAGE_READWRITE);
+    }
+
+    void* map(size_t bytes) noexcept {
+        if (m_options.backing == PageBacking::huge_pages) {
+            size_t const large = GetLargePageMinimum();
+            if (large != 0) {
+                size_t const len = round_up(bytes, large);
+                void* p = virtual_alloc(len, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES);
+                if (p != nullptr) {
+                    m_mapped = len;
+                    m_huge_backed = true;
+                    return p; // large pages are always resident
+                }
+            }
+        }
+
+        size_t const len = round_up(bytes, os_page_size());
+        void* p = virtual_alloc(len, MEM_RESERVE | MEM_COMMIT);
+        if (p != nullptr) {
+            m_mapped = len;
+            m_huge_backed = false;
+            if (m_options.populate) touch(p, len, os_page_size());
+        }
+        return p;
+    }
+
+    void unmap(void* p, size_t) noexcept {
+        VirtualFree(p, 0, MEM_RELEASE); // releases the whole reservation, no length needed
+    }
+#else
+    void* map(size_t bytes) noexcept {
+        bool const bind = m_options.numa_node >= 0;
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_POPULATE)
+        // pre-faulting before mbind would place the pages before the policy exists, so a bound
+        // mapping is populated by hand afterwards instead
+        if (m_options.populate && !bind) flags |= MAP_POPULATE;
+#endif
+
+        void* p = MAP_FAILED;
+        size_t len = 0;
+        m_huge_backed = false;
+
+#if defined(MAP_HUGETLB)
+        if (m_options.backing == PageBacking::huge_pages) {
+            len = mapping_length(bytes);
+            // ask for 2 MiB pages by name: plain MAP_HUGETLB takes the system default size, which
+            // may be 1 GiB, and then munmap/mremap at our 2 MiB rounded lengths fail with EINVAL
+#if defined(MAP_HUGE_2MB)
+            int const huge_2mb = MAP_HUGE_2MB;
+#elif defined(MAP_HUGE_SHIFT)
+            int const huge_2mb = 21 << MAP_HUGE_SHIFT;   // glibc's sys/mman.h has the shift only
+#else
+            int const huge_2mb = 21 << 26;
+#endif
+            p = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | huge_2mb, -1, 0);
+            m_huge_backed = p != MAP_FAILED;
+            // no reserved huge pages - fall through to transparent huge pages
+        }
+#endif
+
+        if (p == MAP_FAILED) {
+            bool const want_thp = m_options.backing == PageBacking::transparent_huge_pages ||
+                                  m_options.backing == PageBacking::huge_pages;
+            // THP can only back 2 MiB aligned extents, so round those mappings to whole huge pages
+            len = mapping_length(bytes);
+            p = mmap(nullptr, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (p == MAP_FAILED) {
+                return nullptr;
+            }
+#if defined(MADV_HUGEPAGE)
+            if (want_thp) madvise(p, len, MADV_HUGEPAGE);
+#endif
+        }
+
+        if (bind) bind_to_node(p, len);
+
+#if defined(MAP_POPULATE)
+        if (m_options.populate && bind) touch(p, len, os_page_size());
+#else
+        if (m_options.populate) touch(p, len, os_page_size());
+#endif
+        m_mapped = len;
+        return p;
+    }
+
+    void bind_to_node(void* p, size_t len) const noexcept {
+#if defined(__linux__) && defined(SYS_mbind)
+        constexpr int mpol_preferred = 1; // from <numaif.h>, which would drag in libnuma
+        constexpr size_t mask_bits = 1024;
+        if (static_cast<size_t>(m_options.numa_node) >= mask_bits) return;
+
+        unsigned long mask[mask_bits / (8 * sizeof(unsigned long))] = {};
+        size_t const node = static_cast<size_t>(m_options.numa_node);
+        size_t const word_bits = 8 * sizeof(unsigned long);
+        mask[node / word_bits] = 1ul << (node % word_bits);
+        // maxnode is one past the bits the kernel reads (it decrements before use). failures
+        // are ignored on purpose - see first-touch in the header comment.
+        syscall(SYS_mbind, p, len, mpol_preferred, mask, mask_bits + 1, 0u);
+#else
+        (void)p;
+        (void)len;
+#endif
+    }
+
+    void unmap(void* p, size_t bytes) noexcept {
+        munmap(p, mapping_length(bytes));
+    }
+#endif
+
+    PageOptions m_options{};
+    size_t m_mapped = 0;       // length of the most recent mapping
+    bool m_huge_backed = false;
+};
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include <cache_line.h>
+#include <thread_pool.h>
+#include <unique_buffer.h>
+
+/*
+Parallel algorithms on a ThreadPool - parallel_for, parallel_reduce, parallel_inclusive_scan.
+
+    ThreadPool pool;
+    SmallVector<float, 8> v = ...;
+    float sum = parallel_reduce(pool, v, 0.0f, std::plus<>{});
+
+Ranges are anything contiguous with data()/size() (SmallVector, UniqueBuffer, std::vector,
+std::span). Work is cut into chunks, chunk 0 runs on the calling thread and the rest are submitted
+to the pool; the caller then helps run jobs until its chunks are done (ThreadPool::wait_until), so
+these can be nested inside jobs without parking a worker.
+
+Grain: by default a range is cut into about chunks_per_worker chunks per worker, but never
+smaller than min_grain elements - enough chunks for stealing to even out imbalance, few enough
+that a chunk's work dwarfs its submit. Ranges under one grain run serially on the caller. Pass
+an explicit grain to override.
+
+parallel_reduce_chunks hands each worker a whole chunk instead of one element at a time, so a
+chunk can go to a vectorized kernel (simd.h) and only the per-chunk results are combined.
+
+Reductions are deterministic. Each chunk folds its elements left to right into a partial on its
+own cache line, and the caller folds init and then the partials in chunk order - so op only has
+to be associative, never commutative, and which worker ran what doesn't change the result. The
+chunking depends only on the size, the grain and the pool's worker count; with an explicit grain
+floating point results are bit-identical across pool sizes too.
+
+If a body throws, chunks that haven't started yet are skipped, the call still waits for the ones
+already running, and then rethrows the first exception on the calling thread.
+*/
+
+namespace parallel_detail {
+
+inline constexpr size_t chunks_per_worker = 4;
+inline constexpr size_t min_grain = 4096;
+
+struct ChunkPlan {
+    size_t count = 0;   // number of chunks
+    size_t size = 0;    // elements per chunk, the last one may be shorter
+
+    ChunkPlan(size_t n, size_t workers, size_t grain) {
+        if (n == 0) return;
+        if (grain == 0) {
+            size_t const target = std::max<size_t>(workers, 1) * chunks_per_worker;
+            grain = std::max(min_grain, (n + target - 1) / target);
+        }
+        size = grain;
+        count = (n + grain - 1) / grain;
+    }
+
+    size_t begin(size_t chunk) const noexcept { return chunk * size; }
+    size_t end(size_t chunk, size_t n) const noexcept { return std::min(n, (chunk + 1) * size); }
+};
+
+// shared by a fork_join's chunks: how many pool chunks are still out, and the first exception
+// any chunk threw. once something has failed the chunks that haven't started are skipped.
+struct ForkState {
+    std::atomic<size_t> remaining;
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;   // written once, by whoever flips failed
+
+    explicit ForkState(size_t pending) : remaining(pending) {}
+
+    template <typename Chunk>
+    void run(Chunk& chunk, size_t i) noexcept {
+        if (failed.load(std::memory_order_relaxed)) return;
+        try {
+            chunk(i);
+        } catch (...) {
+            if (!failed.exchange(true, std::memory_order_acq_rel)) error = std::current_exception();
+        }
+    }
+};
+
+// runs chunk(i) for every i in [0, count): 1..count-1 on the pool, 0 here, then helps until the
+// rest are done. the state lives on our stack, which is fine - nothing touches it after the last
+// decrement, and we don't return (or unwind) before that, even when a chunk throws. the first
+// exception is rethrown here once every chunk has finished or been skipped.
+template <typename Chunk>
+void fork_join(ThreadPool& pool, size_t count, Chunk& chunk) {
+    if (count == 0) return;
+    if (count == 1) {
+        chunk(size_t(0));
+        return;
+    }
+
+    ForkState state(count - 1);
+    for (size_t i = 1; i < count; ++i) {
+        pool.submit([&chunk, &state, i] {
+            state.run(chunk, i);
+            state.remaining.fetch_sub(1, std::memory_order_release);
+        });
+    }
+    state.run(chunk, 0);
+    pool.wait_until([&state] { return state.remaining.load(std::memory_order_acquire) == 0; });
+    if (state.error) std::rethrow_exception(state.error);
+}
+
+template <typename T>
+struct alignas(cache_line_size) Partial {
+    T value{};
+};
+
+template <typename Range>
+auto as_span(Range&& range) {
+    return std::span(std::ranges::data(range), std::ranges::size(range));
+}
+
+} // namespace parallel_detail
+
+// body(first, last) for consecutive sub-ranges covering [0, n) exactly once
+template <typename Body>
+void parallel_for(ThreadPool& pool, size_t n, Body&& body, size_t grain = 0) {
+    parallel_detail::ChunkPlan const plan(n, pool.worker_count(), grain);
+    auto chunk = [&](size_t c) { body(plan.begin(c), plan.end(c, n)); };
+    parallel_detail::fork_join(pool, plan.count, chunk);
+}
+
+// reduce(chunk) for every chunk of the range, as a std::span, then init combine r0 combine r1 ...
+// in chunk order. the building block for handing whole chunks to a kernel, e.g.
+//     parallel_reduce_chunks(pool, v, 0.0f, [](std::span<const float> c) { return simd::sum(c); }, std::plus<>{})
+template <typename Range, typename T, typename Reduce, typename Combine>
+T parallel_reduce_chunks(ThreadPool& pool, Range&& range, T init, Reduce reduce, Combine combine, size_t grain = 0) {
+    static_assert(std::is_default_constructible_v<T>, "partials are default constructed before being filled");
+    auto const in = parallel_detail::as_span(range);
+    size_t const n = in.size();
+    parallel_detail::ChunkPlan const plan(n, pool.worker_count(), grain);
+    if (plan.count == 0) {
+        return init;
+    }
+
+    UniqueBuffer<parallel_detail::Partial<T>> partials(plan.count);
+    auto chunk = [&](size_t c) {
+        size_t const first = plan.begin(c);
+        partials[c].value = reduce(in.subspan(first, plan.end(c, n) - first));
+    };
+    parallel_detail::fork_join(pool, plan.count, chunk);
+
+    for (size_t c = 0; c < plan.count; ++c) {
+        init = combine(std::move(init), std::move(partials[c].value));
+    }
+    return init;
+}
+
+// init op r[0] op r[1] op ... - evaluated as init op (fold of chunk 0) op (fold of chunk 1) ...
+template <typename Range, typename T, typename Op = std::plus<>>
+T parallel_reduce(ThreadPool& pool, Range&& range, T init, Op op = {}, size_t grain = 0) {
+    auto fold = [&op](auto chunk) {
+        T acc = chunk[0];
+        for (size_t i = 1; i < chunk.size(); ++i) acc = op(std::move(acc), chunk[i]);
+        return acc;
+    };
+    return parallel_reduce_chunks(pool, std::forward<Range>(range), std::move(init), fold, op, grain);
+}
+
+// out[i] = in[0] op ... op in[i]. in and out must be the same size and may be the same range.
+// two passes: chunk totals in parallel, a serial prefix over the totals, then every chunk scans
+// again seeded with the prefix before it - about 2n applications of op instead of n.
+template <typename In, typename Out, typename Op = std::plus<>>
+void parallel_inclusive_scan(ThreadPool& pool, In&& input, Out&& output, Op op = {}, size_t grain = 0) {
+    auto const in = parallel_detail::as_span(input);
+    auto const out = parallel_detail::as_span(output);
+    using T = std::remove_cvref_t<decltype(out[0])>;
+    static_assert(std::is_default_constructible_v<T>, "partials are default constructed before being filled");
+    assert(in.size() == out.size());
+
+    size_t const n = in.size();
+    parallel_detail::ChunkPlan const plan(n, pool.worker_count(), grain);
+    if (plan.count == 0) {
+        return;
+    }
+
+    // pass 1: every chunk's total (the last chunk's is never needed)
+    UniqueBuffer<parallel_detail::Partial<T>> partials(plan.count);
+    auto total = [&](size_t c) {
+        if (c + 1 == plan.count) return;
+        size_t const first = plan.begin(c);
+        size_t const last = plan.end(c, n);
+        T acc = in[first];
+        for (size_t i = first + 1; i < last; ++i) acc = op(std::move(acc), in[i]);
+        partials[c].value = std::move(acc);
+    };
+    if (plan.count > 1) {
+        parallel_detail::fork_join(pool, plan.count, total);
+    }
+
+    // partials[c] becomes the prefix of everything before chunk c + 1
+    for (size_t c = 1; c + 1 < plan.count; ++c) {
+        partials[c].value = op(partials[c - 1].value, partials[c].value);
+    }
+
+    // pass 2: each chunk scans its own elements, seeded with the prefix before it
+    auto scan = [&](size_t c) {
+        size_t const first = plan.begin(c);
+        size_t const last = plan.end(c, n);
+        T acc = c == 0 ? T(in[first]) : op(partials[c - 1].value, in[first]);
+        out[first] = acc;
+        for (size_t i = first + 1; i < last; ++i) {
+            acc = op(std::move(acc), in[i]);
+            out[i] = acc;
+        }
+    };
+    parallel_detail::fork_join(pool, plan.count, scan);
+}
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include <arena_allocator.h>
+#include <parallel.h>
+#include <unique_buffer.h>
+
+/*
+Parallel sorting on a ThreadPool, plus the adjacent-pair scan that usually follows it.
+
+    // audit an arena: sort every allocation record by address, then look for neighbours that overlap
+    parallel_radix_sort(pool, chunks, [](const ChunkInfo& c) { return c.begin; }, &scratch);
+    bool overlap = parallel_any_adjacent(pool, chunks, [](auto& a, auto& b) { return a.end > b.begin; });
+
+parallel_radix_sort - stable LSD radix sort on an integer or pointer key, a byte per pass. A pass
+counts digits per chunk in parallel, turns the counts into per-chunk output offsets and scatters
+in parallel; every chunk owns its output slots, so there are no atomics. One read up front finds
+which key bytes differ anywhere, and only those get a pass - pointers into one arena share their
+top bytes, so 8-byte pointer keys usually take three to five passes instead of eight.
+
+parallel_sort - for integer or pointer elements under std::less / ranges::less this is the radix
+sort, with the element as its own key. Anything else is merge sorted: chunks are std::sort-ed in
+parallel and then merged pairwise in log2(chunks) rounds. Every merge is cut into grain-sized
+pieces at merge-path co-ranks (a binary search per piece), so even the last round - a single
+merge of everything - keeps every worker busy. Not stable.
+
+parallel_any_adjacent - pred(r[i], r[i + 1]) for any i, checked chunk by chunk in parallel (the
+chunks overlap by one element) and given up as soon as some chunk finds a pair.
+
+Scratch: sorting needs a second buffer as big as the range plus a little bookkeeping. Pass an
+ArenaAllocator and all of it comes from there, inside an ArenaScope that gives it back before
+returning - so nobody else may allocate from that arena meanwhile, and it can't be the arena
+being audited. Without one it comes from the heap. Elements travel through the scratch buffer by
+move assignment, so they must be default constructible and movable.
+
+Grain works as in parallel.h; the default suits most sizes.
+*/
+
+namespace parallel_detail {
+
+template <typename K>
+concept RadixKey = (std::integral<K> && !std::same_as<K, bool>) || std::is_pointer_v<K>;
+
+inline constexpr size_t radix_buckets = 256;
+
+// the key as an unsigned integer with the same order
+template <RadixKey K>
+auto radix_bits(K key) noexcept {
+    if constexpr (std::is_pointer_v<K>) {
+        return reinterpret_cast<uintptr_t>(key);
+    } else if constexpr (std::is_signed_v<K>) {
+        using U = std::make_unsigned_t<K>;
+        return static_cast<U>(static_cast<U>(key) ^ static_cast<U>(U(1) << (sizeof(U) * 8 - 1)));
+    } else {
+        return key;
+    }
+}
+
+template <typename T, typename Alloc>
+UniqueBuffer<T, Alloc> scratch(size_t size, const Alloc& alloc) {
+    return UniqueBuffer<T, Alloc>::uninitialized(size, alloc);
+}
+
+// runs sort(alloc) with an allocation policy for its scratch, rewinding the arena afterwards
+template <typename Sort>
+void with_scratch(ArenaAllocator* arena, Sort&& sort) {
+    if (arena == nullptr) {
+        sort(UninitializedAlloc{});
+        return;
+    }
+    ArenaScope scope(*arena);
+    sort(ArenaAlloc(*arena));
+}
+
+// from[i] -> to[i], in parallel
+template <typename T>
+void move_all(ThreadPool& pool, const ChunkPlan& plan, std::span<T> from, std::span<T> to) {
+    auto chunk = [&](size_t c) {
+        std::move(from.begin() + plan.begin(c), from.begin() + plan.end(c, from.size()), to.begin() + plan.begin(c));
+    };
+    fork_join(pool, plan.count, chunk);
+}
+
+template <typename T, typename Key, typename Alloc>
+void radix_sort(ThreadPool& pool, std::span<T> data, Key& key, const Alloc& alloc, size_t grain) {
+    size_t const n = data.size();
+    if (n < 2) {
+        return;
+    }
+    ChunkPlan const plan(n, pool.worker_count(), grain);
+    auto bits = [&key](const T& item) { return radix_bits(key(item)); };
+    using Bits = decltype(bits(data[0]));
+
+    // which bytes vary at all: OR of every key XOR the first one
+    Bits const first = bits(data[0]);
+    auto varying = scratch<Partial<Bits>>(plan.count, alloc);
+    auto find_varying = [&](size_t c) {
+        Bits acc = 0;
+        for (size_t i = plan.begin(c), last = plan.end(c, n); i < last; ++i) {
+            acc |= bits(data[i]) ^ first;
+        }
+        varying[c].value = acc;
+    };
+    fork_join(pool, plan.count, find_varying);
+    Bits mask = 0;
+    for (size_t c = 0; c < plan.count; ++c) {
+        mask |= varying[c].value;
+    }
+    if (mask == 0) {
+        return;   // all keys equal
+    }
+
+    auto counts = scratch<size_t>(plan.count * radix_buckets, alloc);
+    auto buffer = scratch<T>(n, alloc);
+    std::span<T> from = data;
+    std::span<T> to(buffer.data(), n);
+
+    for (unsigned shift = 0; shift < sizeof(Bits) * 8; shift += 8) {
+        if (((mask >> shift) & 0xff) == 0) {
+            continue;
+        }
+        auto digit = [&bits, shift](const T& item) { return static_cast<size_t>((bits(item) >> shift) & 0xff); };
+
+        auto count = [&](size_t c) {
+            size_t* bucket = counts.data() + c * radix_buckets;
+            std::fill_n(bucket, radix_buckets, size_t(0));
+            for (size_t i = plan.begin(c), last = plan.end(c, n); i < last; ++i) {
+                ++bucket[digit(from[i])];
+            }
+        };
+        fork_join(pool, plan.count, count);
+
+        // chunk c's run of digit d lands after all smaller digits and after the earlier chunks'
+        // runs of d - which is what keeps the sort stable
+        size_t offset = 0;
+        for (size_t d = 0; d < radix_buckets; ++d) {
+            for (size_t c = 0; c < plan.count; ++c) {
+                size_t& slot = counts[c * radix_buckets + d];
+                size_t const k = slot;
+                slot = offset;
+                offset += k;
+            }
+        }
+
+        auto scatter = [&](size_t c) {
+            size_t* next = counts.data() + c * radix_buckets;
+            for (size_t i = plan.begin(c), last = plan.end(c, n); i < last; ++i) {
+                to[next[digit(from[i])]++] = std::move(from[i]);
+            }
+        };
+        fork_join(pool, plan.count, scatter);
+        std::swap(from, to);
+    }
+
+    if (from.data() != data.data()) {
+        move_all(pool, plan, from, data);
+    }
+}
+
+// how many of the first k outputs of a stable merge of a[0, n) and b[0, m) come from a
+template <typename T, typename Compare>
+size_t co_rank(size_t k, const T* a, size_t n, const T* b, size_t m, Compare& comp) {
+    size_t lo = k > m ? k - m : 0;
+    size_t hi = std::min(k, n);
+    while (lo < hi) {
+        size_t const i = lo + (hi - lo) / 2;
+        size_t const j = k - i;
+        // a[i] goes out before b[j - 1] (a wins ties), so more than i come from a
+        if (j > 0 && i < n && !comp(b[j - 1], a[i])) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+template <typename T, typename Compare, typename Alloc>
+void merge_sort(ThreadPool& pool, std::span<T> data, Compare& comp, const Alloc& alloc, size_t grain) {
+    size_t const n = data.size();
+    ChunkPlan const plan(n, pool.worker_count(), grain);
+    if (plan.count <= 1) {
+        std::sort(data.begin(), data.end(), comp);
+        return;
+    }
+
+    auto sort_chunk = [&](size_t c) {
+        std::sort(data.begin() + plan.begin(c), data.begin() + plan.end(c, n), comp);
+    };
+    fork_join(pool, plan.count, sort_chunk);
+
+    auto buffer = scratch<T>(n, alloc);
+    std::span<T> from = data;
+    std::span<T> to(buffer.data(), n);
+
+    // each round merges neighbouring runs of `width` into runs of 2 * width. a merge's output is
+    // cut into pieces of plan.size, numbered per_pair to a pair, and every piece is a job. all
+    // the co-ranks are found before any piece starts moving elements out from under them.
+    size_t const max_pieces = 2 * plan.count;
+    auto splits = scratch<size_t>(max_pieces, alloc);
+    for (size_t width = plan.size; width < n; width *= 2) {
+        size_t const pairs = (n + 2 * width - 1) / (2 * width);
+        size_t const per_pair = 2 * width / plan.size;
+        assert(pairs * per_pair <= max_pieces);
+
+        // piece t of its pair: output [k0, k1) of the merge of a = [lo, mid) and b = [mid, hi)
+        struct Piece {
+            size_t lo, mid, hi, k0, k1;
+        };
+        auto piece = [&](size_t t) {
+            size_t const lo = (t / per_pair) * 2 * width;
+            size_t const mid = std::min(n, lo + width);
+            size_t const hi = std::min(n, lo + 2 * width);
+            size_t const k0 = std::min(hi - lo, (t % per_pair) * plan.size);
+            return Piece{lo, mid, hi, k0, std::min(hi - lo, k0 + plan.size)};
+        };
+
+        auto find_split = [&](size_t t) {
+            Piece const p = piece(t);
+            splits[t] = co_rank(p.k0, from.data() + p.lo, p.mid - p.lo, from.data() + p.mid, p.hi - p.mid, comp);
+        };
+        fork_join(pool, pairs * per_pair, find_split);
+
+        auto merge_piece = [&](size_t t) {
+            Piece const p = piece(t);
+            if (p.k0 == p.k1) {
+                return;   // past the end of the short last pair
+            }
+            bool const last_of_pair = p.k1 == p.hi - p.lo;
+            size_t const i0 = splits[t];
+            size_t const i1 = last_of_pair ? p.mid - p.lo : splits[t + 1];
+            T* a = from.data() + p.lo;
+            T* b = from.data() + p.mid;
+            std::merge(std::make_move_iterator(a + i0), std::make_move_iterator(a + i1),
+                       std::make_move_iterator(b + (p.k0 - i0)), std::make_move_iterator(b + (p.k1 - i1)),
+                       to.data() + p.lo + p.k0, comp);
+        };
+        fork_join(pool, pairs * per_pair, merge_piece);
+        std::swap(from, to);
+    }
+
+    if (from.data() != data.data()) {
+        move_all(pool, plan, from, data);
+    }
+}
+
+} // namespace parallel_detail
+
+// stable sort by key(element), which must return an integer or a pointer
+template <typename Range, typename Key>
+void parallel_radix_sort(ThreadPool& pool, Range&& range, Key key, ArenaAllocator* scratch = nullptr, size_t grain = 0) {
+    auto const data = parallel_detail::as_span(range);
+    using T = typename decltype(data)::element_type;
+    static_assert(parallel_detail::RadixKey<std::remove_cvref_t<std::invoke_result_t<Key&, const T&>>>,
+                  "radix keys are integers or pointers");
+    parallel_detail::with_scratch(scratch, [&](const auto& alloc) {
+        parallel_detail::radix_sort(pool, data, key, alloc, grain);
+    });
+}
+
+template <typename Range, typename Compare = std::less<>>
+void parallel_sort(ThreadPool& pool, Range&& range, Compare comp = {}, ArenaAllocator* scratch = nullptr, size_t grain = 0) {
+    auto const data = parallel_detail::as_span(range);
+    using T = typename decltype(data)::element_type;
+    constexpr bool ascending = std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<T>> ||
+                               std::is_same_v<Compare, std::ranges::less>;
+
+    if constexpr (ascending && parallel_detail::RadixKey<T>) {
+        parallel_radix_sort(pool, data, [](T item) { return item; }, scratch, grain);
+    } else {
+        parallel_detail::with_scratch(scratch, [&](const auto& alloc) {
+            parallel_detail::merge_sort(pool, data, comp, alloc, grain);
+        });
+    }
+}
+
+// whether pred(r[i], r[i + 1]) holds for some i - e.g. an overlap between sorted neighbours
+template <typename Range, typename Pred>
+bool parallel_any_adjacent(ThreadPool& pool, Range&& range, Pred pred, size_t grain = 0) {
+    auto const in = parallel_detail::as_span(range);
+    if (in.size() < 2) {
+        return false;
+    }
+
+    size_t const pairs = in.size() - 1;
+    parallel_detail::ChunkPlan const plan(pairs, pool.worker_count(), grain);
+    std::atomic<bool> found{false};
+    auto chunk = [&](size_t c) {
+        for (size_t i = plan.begin(c), last = plan.end(c, pairs); i < last; ++i) {
+            if (pred(in[i], in[i + 1])) {
+                found.store(true, std::memory_order_relaxed);
+                return;
+            }
+            // every so often, see whether another chunk has already answered the question
+            if ((i & 1023) == 0 && found.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    };
+    parallel_detail::fork_join(pool, plan.count, chunk);
+    return found.load(std::memory_order_relaxed);
+}
+
+template <typename Range, typename Compare = std::less<>>
+bool parallel_is_sorted(ThreadPool& pool, Range&& range, Compare comp = {}, size_t grain = 0) {
+    return !parallel_any_adjacent(pool, std::forward<Range>(range),
+                                  [&comp](const auto& a, const auto& b) { return comp(b, a); }, grain);
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <arena_allocator.h>
+#include <cache_line.h>
+#include <thread_slot.h>
+#include <unique_buffer.h>
+
+/*
+FixedPool - O(1) fixed-size block allocator for same-sized nodes that die one at a time.
+
+Blocks are carved out of slabs, taken either from an ArenaAllocator or from the pool's own
+UniqueBuffers, and freed blocks are threaded onto an intrusive free list that lives inside the
+blocks themselves. Nothing touches the heap once the slabs exist.
+
+Single-threaded pools (the default) keep one plain free list. Thread-safe pools give every thread
+slot its own magazine of free blocks, so the common alloc/free pair has no atomics at all.
+Magazines trade full batches with a shared lock-free stack. The stack head carries a tag next to
+the pointer, so a batch that is popped, reused and pushed back between our load and CAS can't
+fool us (ABA). A block may be freed from any thread - it simply joins that thread's magazine.
+
+A pool carved from an arena must be destroyed (or stop being used) before the arena resets.
+*/
+
+struct PoolOptions {
+    size_t blocks_per_slab = 256;
+    bool thread_safe = false;   // per-thread magazines + lock-free batch stack
+    size_t magazine_size = 64;  // blocks a thread caches before handing half back
+};
+
+class FixedPool
+{
+public:
+    // slabs come from the pool's own buffers
+    FixedPool(size_t block_size, size_t block_alignment, PoolOptions options = {})
+        : FixedPool(nullptr, block_size, block_alignment, options) {}
+
+    // slabs are carved out of `arena`
+    FixedPool(ArenaAllocator& arena, size_t block_size, size_t block_alignment, PoolOptions options = {})
+        : FixedPool(&arena, block_size, block_alignment, options) {}
+
+    FixedPool(const FixedPool&) = delete;
+    FixedPool& operator=(const FixedPool&) = delete;
+
+    void* allocate() {
+        if (!m_options.thread_safe) {
+            if (m_local == nullptr && !carve(m_local)) {
+                return nullptr;
+            }
+            FreeNode* node = m_local;
+            m_local = node->next;
+            return node;
+        }
+
+        size_t const slot = this_thread_slot();
+        if (slot == no_thread_slot) {
+            std::scoped_lock lock(m_overflow_mutex);
+            return magazine_pop(m_overflow);
+        }
+        return magazine_pop(m_magazines[slot]);
+    }
+
+    void deallocate(void* p) noexcept {
+        if (p == nullptr) {
+            return;
+        }
+        FreeNode* node = ::new (p) FreeNode{};
+
+        if (!m_options.thread_safe) {
+            node->next = m_local;
+            m_local = node;
+            return;
+        }
+
+        size_t const slot = this_thread_slot();
+        if (slot == no_thread_slot) {
+            std::scoped_lock lock(m_overflow_mutex);
+            magazine_push(m_overflow, node);
+            return;
+        }
+        magazine_push(m_magazines[slot], node);
+    }
+
+    size_t block_size() const noexcept { return m_block_size; }
+    size_t block_alignment() const noexcept { return m_block_alignment; }
+    bool thread_safe() const noexcept { return m_options.thread_safe; }
+
+    // blocks carved so far, free or not
+    size_t capacity() const {
+        std::scoped_lock lock(m_slab_mutex);
+        return m_slab_count * m_options.blocks_per_slab;
+    }
+
+private:
+    // free blocks are reinterpreted as list nodes. next_batch is only meaningful on the head of
+    // a batch sitting in the shared stack; it is atomic because a stale popper may read it while
+    // the batch's new owner is already reusing the block (the tag makes that popper's CAS fail).
+    struct FreeNode {
+        FreeNode* next = nullptr;
+        std::atomic<FreeNode*> next_batch{nullptr};
+    };
+
+    struct alignas(cache_line_size) Magazine {
+        FreeNode* head = nullptr;
+        size_t count = 0;
+    };
+
+    // tagged stack head: [ tag : 16 | pointer : 48 ] on 64-bit, [ tag : 32 | pointer : 32 ] on 32-bit
+    static constexpr unsigned pointer_bits = sizeof(void*) == 8 ? 48 : 32;
+    static constexpr uint64_t pointer_mask = (uint64_t(1) << pointer_bits) - 1;
+
+    static uint64_t pack(FreeNode* node, uint64_t tag) noexcept {
+        uint64_t const bits = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(node));
+        assert((bits & ~pointer_mask) == 0 && "pointer doesn't fit the tagged head");
+        return (tag << pointer_bits) | bits;
+    }
+    static FreeNode* unpack(uint64_t head) noexcept {
+        return reinterpret_cast<FreeNode*>(static_cast<uintptr_t>(head & pointer_mask));
+    }
+    static uint64_t tag_of(uint64_t head) noexcept { return head >> pointer_bits; }
+
+    FixedPool(ArenaAllocator* arena, size_t block_size, size_t block_alignment, PoolOptions options)
+        : m_arena(arena),
+          m_block_alignment(std::max(block_alignment, alignof(FreeNode))),
+          m_block_size(round_up(std::max(block_size, sizeof(FreeNode)), m_block_alignment)),
+          m_options(options) {
+        m_options.magazine_size = std::max<size_t>(m_options.magazine_size, 2);
+        // slabs are carved into whole batches so every batch in the shared stack has batch_size nodes
+        m_options.blocks_per_slab = round_up(std::max<size_t>(m_options.blocks_per_slab, 1), batch_size());
+        if (m_options.thread_safe) {
+            m_magazines = UniqueBuffer<Magazine>(max_thread_slots);
+        }
+    }
+
+    static size_t round_up(size_t value, size_t alignment) noexcept {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    size_t batch_size() const noexcept { return m_options.magazine_size / 2; }
+
+    void* magazine_pop(Magazine& magazine) {
+        if (magazine.head == nullptr) {
+            FreeNode* batch = pop_batch();
+            if (batch == nullptr && !carve(batch)) {
+                return nullptr;
+            }
+            magazine.head = batch;
+            magazine.count = batch_size();
+        }
+        FreeNode* node = magazine.head;
+        magazine.head = node->next;
+        --magazine.count;
+        return node;
+    }
+
+    void magazine_push(Magazine& magazine, FreeNode* node) noexcept {
+        node->next = magazine.head;
+        magazine.head = node;
+
+        // full magazine: hand half of it back so frees on one thread feed allocations on others
+        if (++magazine.count == m_options.magazine_size) {
+            FreeNode* batch = magazine.head;
+            FreeNode* last = batch;
+            for (size_t i = 1; i < batch_size(); ++i) last = last->next;
+            magazine.head = last->next;
+            magazine.count -= batch_size();
+            last->next = nullptr;
+            push_batch(batch);
+        }
+    }
+
+    void push_batch(FreeNode* batch) noexcept {
+        uint64_t head = m_shared.load(std::memory_order_relaxed);
+        do {
+            batch->next_batch.store(unpack(head), std::memory_order_relaxed);
+        } while (!m_shared.compare_exchange_weak(head, pack(batch, tag_of(head) + 1),
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    }
+
+    FreeNode* pop_batch() noexcept {
+        uint64_t head = m_shared.load(std::memory_order_acquire);
+        while (true) {
+            FreeNode* batch = unpack(head);
+            if (batch == nullptr) {
+                return nullptr;
+            }
+            // may be stale if someone else won the batch first - then the tag has moved on
+            FreeNode* next = batch->next_batch.load(std::memory_order_relaxed);
+            if (m_shared.compare_exchange_weak(head, pack(next, tag_of(head) + 1),
+                                               std::memory_order_acquire,
+                                               std::memory_order_acquire)) {
+                return batch;
+            }
+        }
+    }
+
+    // grabs a new slab and links it into batches. one batch comes back through `out`, the rest
+    // go to the shared stack (thread-safe pools only - a single-threaded pool keeps it all).
+    bool carve(FreeNode*& out) {
+        size_t const bytes = m_block_size * m_options.blocks_per_slab;
+        std::byte* slab = nullptr;
+        {
+            std::scoped_lock lock(m_slab_mutex);
+            if (m_arena != nullptr) {
+                slab = static_cast<std::byte*>(m_arena->allocate(bytes, m_block_alignment));
+            } else {
+                // over-allocate so the first block can be aligned however the buffer lands
+                UniqueBuffer<std::byte, UninitializedAlloc> buffer(bytes + m_block_alignment - 1);
+                uintptr_t addr = reinterpret_cast<uintptr_t>(buffer.data());
+                slab = reinterpret_cast<std::byte*>(round_up(addr, m_block_alignment));
+                m_slabs.push_back(std::move(buffer));
+            }
+            if (slab == nullptr) {
+                return false;
+            }
+            ++m_slab_count;
+        }
+
+        size_t const per_batch = m_options.thread_safe ? batch_size() : m_options.blocks_per_slab;
+        for (size_t first = 0; first < m_options.blocks_per_slab; first += per_batch) {
+            FreeNode* head = nullptr;
+            for (size_t i = first + per_batch; i-- > first; ) {
+                FreeNode* node = ::new (slab + i * m_block_size) FreeNode{};
+                node->next = head;
+                head = node;
+            }
+            if (first == 0) {
+                out = head;
+            } else {
+                push_batch(head);
+            }
+        }
+        return true;
+    }
+
+    ArenaAllocator* const m_arena;
+    size_t const m_block_alignment;
+    size_t const m_block_size;
+    PoolOptions m_options;
+
+    FreeNode* m_local = nullptr;                 // single-threaded free list
+    UniqueBuffer<Magazine> m_magazines;          // one per thread slot (thread-safe pools)
+    Magazine m_overflow;                         // threads without a slot share this one
+    std::mutex m_overflow_mutex;
+
+    std::vector<UniqueBuffer<std::byte, UninitializedAlloc>> m_slabs; // owned slabs when there is no arena
+    size_t m_slab_count = 0;
+    mutable std::mutex m_slab_mutex;
+
+    alignas(cache_line_size) std::atomic<uint64_t> m_shared{0}; // tagged head of the batch stack
+};
+
+// typed front end - allocate/deallocate raw T-sized blocks, or create/destroy objects in them
+template <typename T>
+class PoolAllocator
+{
+public:
+    explicit PoolAllocator(PoolOptions options = {})
+        : m_pool(sizeof(T), alignof(T), options) {}
+
+    explicit PoolAllocator(ArenaAllocator& arena, PoolOptions options = {})
+        : m_pool(arena, sizeof(T), alignof(T), options) {}
+
+    T* allocate() { return static_cast<T*>(m_pool.allocate()); }
+    void deallocate(T* p) noexcept { m_pool.deallocate(p); }
+
+    // nullptr when the pool's arena is exhausted
+    template <typename... Args>
+    T* create(Args&&... args) {
+        void* p = m_pool.allocate();
+        if (p == nullptr) {
+            return nullptr;
+        }
+        try {
+            return ::new (p) T(std::forward<Args>(args)...);
+        } catch (...) {
+            m_pool.deallocate(p);
+            throw;
+        }
+    }
+
+    void destroy(T* p) noexcept {
+        if (p != nullptr) {
+            p->~T();
+            m_pool.deallocate(p);
+        }
+    }
+
+    FixedPool& pool() noexcept { return m_pool; }
+
+private:
+    FixedPool m_pool;
+};
+
+// a handful of power of two size classes (min_block .. max_block) over FixedPools, for mixed
+// small sizes that are still freed one at a time. requests above max_block return nullptr.
+class SizeClassAllocator
+{
+public:
+    static constexpr size_t min_block = 16;
+    static constexpr size_t max_block = 1024;
+    static constexpr size_t class_count = 7; // 16, 32, ... 1024
+
+    explicit SizeClassAllocator(PoolOptions options = {}) {
+        for (size_t i = 0; i < class_count; ++i) {
+            m_classes[i] = std::make_unique<FixedPool>(min_block << i, alignof(std::max_align_t), options);
+        }
+    }
+
+    explicit SizeClassAllocator(ArenaAllocator& arena, PoolOptions options = {}) {
+        for (size_t i = 0; i < class_count; ++i) {
+            m_classes[i] = std::make_unique<FixedPool>(arena, min_block << i, alignof(std::max_align_t), options);
+        }
+    }
+
+    void* allocate(size_t size) {
+        size_t const index = class_of(size);
+        return index < class_count ? m_classes[index]->allocate() : nullptr;
+    }
+
+    // size must be the size passed to allocate()
+    void deallocate(void* p, size_t size) noexcept {
+        size_t const index = class_of(size);
+        if (index < class_count) {
+            m_classes[index]->deallocate(p);
+        }
+    }
+
+    static size_t class_of(size_t size) noexcept {
+        size_t index = 0;
+        for (size_t block = min_block; block < size; block <<= 1) ++index;
+        return index;
+    }
+
+private:
+    std::unique_ptr<FixedPool> m_classes[class_count];
+};
@@ -0,0 +1,421 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+// x86-64 only: SSE2 is its baseline, so the SSE2 path needs no check. 32-bit x86 gets the scalar path.
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// per-function ISA for the x86 kernels, so the rest of the program can stay at the baseline.
+// MSVC lets any function use any intrinsic and needs nothing here.
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+// no multiply-add contraction anywhere in here: a fused dot rounds differently on the paths that
+// have FMA (AVX-512, NEON, scalar on aarch64) than on the ones that don't. MSVC doesn't contract
+// unless asked to with /fp:contract.
+#if defined(__clang__)
+#pragma float_control(push)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+/*
+simd - float kernels (sum, dot, min, max, map_reduce) over contiguous ranges.
+
+std::accumulate over floats can't be vectorized: the compiler may not reassociate the additions,
+so every add waits for the previous one. These kernels reassociate on purpose, in one fixed way:
+element i goes into accumulator lane i % 32, and the 32 lanes are combined in the same pairwise
+tree at the end. The SSE2 path does that with 8 registers of 4 lanes, AVX2 with 4 of 8, AVX-512
+with 2 of 16, NEON with 8 of 4, and the scalar fallback with a plain array - so every path
+produces bit-identical results, and the independent registers keep several adds in flight.
+
+On x86-64 the path is picked once at runtime from what the CPU (and OS) supports; kernels(isa) runs a
+specific one, for tests and benchmarks. NEON is a compile-time choice on ARM.
+
+The results are a different (and usually more accurate) rounding of the sum than a left-to-right
+loop, not the same one. NaNs propagate through sum and dot; for min/max with NaN inputs the result
+is unspecified. dot doesn't use FMA, so that it matches across paths.
+
+For parallel work, give each chunk to one of these: see parallel_reduce_chunks in parallel.h.
+*/
+
+namespace simd {
+
+enum class Isa { scalar, sse2, avx2, avx512, neon };
+
+inline constexpr size_t lanes = 32;
+
+// block kernels: fold `blocks` runs of 32 floats into the 32 lane accumulators
+struct Kernels {
+    Isa isa;
+    void (*sum)(const float* p, size_t blocks, float* acc);
+    void (*dot)(const float* a, const float* b, size_t blocks, float* acc);
+    void (*min)(const float* p, size_t blocks, float* acc);
+    void (*max)(const float* p, size_t blocks, float* acc);
+};
+
+namespace detail {
+
+inline void sum_scalar(const float* p, size_t blocks, float* acc) {
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        for (size_t k = 0; k < lanes; ++k) acc[k] += p[k];
+    }
+}
+
+inline void dot_scalar(const float* a, const float* b, size_t blocks, float* acc) {
+    for (size_t i = 0; i < blocks; ++i, a += lanes, b += lanes) {
+        for (size_t k = 0; k < lanes; ++k) {
+            float const product = a[k] * b[k];
+            acc[k] += product;
+        }
+    }
+}
+
+inline void min_scalar(const float* p, size_t blocks, float* acc) {
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        for (size_t k = 0; k < lanes; ++k) acc[k] = p[k] < acc[k] ? p[k] : acc[k];
+    }
+}
+
+inline void max_scalar(const float* p, size_t blocks, float* acc) {
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        for (size_t k = 0; k < lanes; ++k) acc[k] = p[k] > acc[k] ? p[k] : acc[k];
+    }
+}
+
+#if defined(SIMD_X86)
+
+// SSE2 is part of x86-64, so no target attribute - SIMD_X86 is only defined there.
+// 8 registers x 4 lanes cover a block.
+#define SIMD_SSE_KERNEL(name, combine)                                            \
+    inline void name(const float* p, size_t blocks, float* acc) {                  \
+        __m128 r[8];                                                               \
+        for (int k = 0; k < 8; ++k) r[k] = _mm_loadu_ps(acc + 4 * k);              \
+        for (size_t b = 0; b < blocks; ++b, p += lanes) {                          \
+            for (int k = 0; k < 8; ++k) r[k] = combine(r[k], _mm_loadu_ps(p + 4 * k)); \
+        }                                                                          \
+        for (int k = 0; k < 8; ++k) _mm_storeu_ps(acc + 4 * k, r[k]);              \
+    }
+
+SIMD_SSE_KERNEL(sum_sse2, _mm_add_ps)
+// min/max with the loaded value first: `p < acc ? p : acc` like the scalar path
+inline __m128 min_sse2_op(__m128 acc, __m128 v) { return _mm_min_ps(v, acc); }
+inline __m128 max_sse2_op(__m128 acc, __m128 v) { return _mm_max_ps(v, acc); }
+SIMD_SSE_KERNEL(min_sse2, min_sse2_op)
+SIMD_SSE_KERNEL(max_sse2, max_sse2_op)
+#undef SIMD_SSE_KERNEL
+
+inline void dot_sse2(const float* a, const float* b, size_t blocks, float* acc) {
+    __m128 r[8];
+    for (int k = 0; k < 8; ++k) r[k] = _mm_loadu_ps(acc + 4 * k);
+    for (size_t i = 0; i < blocks; ++i, a += lanes, b += lanes) {
+        for (int k = 0; k < 8; ++k) {
+            r[k] = _mm_add_ps(r[k], _mm_mul_ps(_mm_loadu_ps(a + 4 * k), _mm_loadu_ps(b + 4 * k)));
+        }
+    }
+    for (int k = 0; k < 8; ++k) _mm_storeu_ps(acc + 4 * k, r[k]);
+}
+
+SIMD_TARGET("avx2") inline void sum_avx2(const float* p, size_t blocks, float* acc) {
+    __m256 r0 = _mm256_loadu_ps(acc), r1 = _mm256_loadu_ps(acc + 8);
+    __m256 r2 = _mm256_loadu_ps(acc + 16), r3 = _mm256_loadu_ps(acc + 24);
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        r0 = _mm256_add_ps(r0, _mm256_loadu_ps(p));
+        r1 = _mm256_add_ps(r1, _mm256_loadu_ps(p + 8));
+        r2 = _mm256_add_ps(r2, _mm256_loadu_ps(p + 16));
+        r3 = _mm256_add_ps(r3, _mm256_loadu_ps(p + 24));
+    }
+    _mm256_storeu_ps(acc, r0);
+    _mm256_storeu_ps(acc + 8, r1);
+    _mm256_storeu_ps(acc + 16, r2);
+    _mm256_storeu_ps(acc + 24, r3);
+}
+
+SIMD_TARGET("avx2") inline void dot_avx2(const float* a, const float* b, size_t blocks, float* acc) {
+    __m256 r0 = _mm256_loadu_ps(acc), r1 = _mm256_loadu_ps(acc + 8);
+    __m256 r2 = _mm256_loadu_ps(acc + 16), r3 = _mm256_loadu_ps(acc + 24);
+    for (size_t i = 0; i < blocks; ++i, a += lanes, b += lanes) {
+        r0 = _mm256_add_ps(r0, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b)));
+        r1 = _mm256_add_ps(r1, _mm256_mul_ps(_mm256_loadu_ps(a + 8), _mm256_loadu_ps(b + 8)));
+        r2 = _mm256_add_ps(r2, _mm256_mul_ps(_mm256_loadu_ps(a + 16), _mm256_loadu_ps(b + 16)));
+        r3 = _mm256_add_ps(r3, _mm256_mul_ps(_mm256_loadu_ps(a + 24), _mm256_loadu_ps(b + 24)));
+    }
+    _mm256_storeu_ps(acc, r0);
+    _mm256_storeu_ps(acc + 8, r1);
+    _mm256_storeu_ps(acc + 16, r2);
+    _mm256_storeu_ps(acc + 24, r3);
+}
+
+SIMD_TARGET("avx2") inline void min_avx2(const float* p, size_t blocks, float* acc) {
+    __m256 r[4];
+    for (int k = 0; k < 4; ++k) r[k] = _mm256_loadu_ps(acc + 8 * k);
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        for (int k = 0; k < 4; ++k) r[k] = _mm256_min_ps(_mm256_loadu_ps(p + 8 * k), r[k]);
+    }
+    for (int k = 0; k < 4; ++k) _mm256_storeu_ps(acc + 8 * k, r[k]);
+}
+
+SIMD_TARGET("avx2") inline void max_avx2(const float* p, size_t blocks, float* acc) {
+    __m256 r[4];
+    for (int k = 0; k < 4; ++k) r[k] = _mm256_loadu_ps(acc + 8 * k);
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        for (int k = 0; k < 4; ++k) r[k] = _mm256_max_ps(_mm256_loadu_ps(p + 8 * k), r[k]);
+    }
+    for (int k = 0; k < 4; ++k) _mm256_storeu_ps(acc + 8 * k, r[k]);
+}
+
+SIMD_TARGET("avx512f") inline void sum_avx512(const float* p, size_t blocks, float* acc) {
+    __m512 r0 = _mm512_loadu_ps(acc), r1 = _mm512_loadu_ps(acc + 16);
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        r0 = _mm512_add_ps(r0, _mm512_loadu_ps(p));
+        r1 = _mm512_add_ps(r1, _mm512_loadu_ps(p + 16));
+    }
+    _mm512_storeu_ps(acc, r0);
+    _mm512_storeu_ps(acc + 16, r1);
+}
+
+SIMD_TARGET("avx512f") inline void dot_avx512(const float* a, const float* b, size_t blocks, float* acc) {
+    __m512 r0 = _mm512_loadu_ps(acc), r1 = _mm512_loadu_ps(acc + 16);
+    for (size_t i = 0; i < blocks; ++i, a += lanes, b += lanes) {
+        r0 = _mm512_add_ps(r0, _mm512_mul_ps(_mm512_loadu_ps(a), _mm512_loadu_ps(b)));
+        r1 = _mm512_add_ps(r1, _mm512_mul_ps(_mm512_loadu_ps(a + 16), _mm512_loadu_ps(b + 16)));
+    }
+    _mm512_storeu_ps(acc, r0);
+    _mm512_storeu_ps(acc + 16, r1);
+}
+
+SIMD_TARGET("avx512f") inline void min_avx512(const float* p, size_t blocks, float* acc) {
+    __m512 r0 = _mm512_loadu_ps(acc), r1 = _mm512_loadu_ps(acc + 16);
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        r0 = _mm512_min_ps(_mm512_loadu_ps(p), r0);
+        r1 = _mm512_min_ps(_mm512_loadu_ps(p + 16), r1);
+    }
+    _mm512_storeu_ps(acc, r0);
+    _mm512_storeu_ps(acc + 16, r1);
+}
+
+SIMD_TARGET("avx512f") inline void max_avx512(const float* p, size_t blocks, float* acc) {
+    __m512 r0 = _mm512_loadu_ps(acc), r1 = _mm512_loadu_ps(acc + 16);
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        r0 = _mm512_max_ps(_mm512_loadu_ps(p), r0);
+        r1 = _mm512_max_ps(_mm512_loadu_ps(p + 16), r1);
+    }
+    _mm512_storeu_ps(acc, r0);
+    _mm512_storeu_ps(acc + 16, r1);
+}
+
+// what the CPU supports *and* the OS saves across context switches
+inline bool cpu_has(Isa isa) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    switch (isa) {
+    case Isa::avx2:   return __builtin_cpu_supports("avx2");
+    case Isa::avx512: return __builtin_cpu_supports("avx512f");
+    default:          return isa == Isa::scalar || isa == Isa::sse2;
+    }
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int const max_leaf = info[0];
+    __cpuid(info, 1);
+    bool const osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long const xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool const ymm = (xcr0 & 0x6) == 0x6;
+    bool const zmm = (xcr0 & 0xe6) == 0xe6;
+    int leaf7[4] = {};
+    if (max_leaf >= 7) __cpuidex(leaf7, 7, 0);
+    switch (isa) {
+    case Isa::avx2:   return ymm && (leaf7[1] & (1 << 5)) != 0;
+    case Isa::avx512: return zmm && (leaf7[1] & (1 << 16)) != 0;
+    default:          return isa == Isa::scalar || isa == Isa::sse2;
+    }
+#else
+    return isa == Isa::scalar || isa == Isa::sse2;
+#endif
+}
+
+#elif defined(SIMD_NEON)
+
+#define SIMD_NEON_KERNEL(name, combine)                                           \
+    inline void name(const float* p, size_t blocks, float* acc) {                  \
+        float32x4_t r[8];                                                          \
+        for (int k = 0; k < 8; ++k) r[k] = vld1q_f32(acc + 4 * k);                 \
+        for (size_t b = 0; b < blocks; ++b, p += lanes) {                          \
+            for (int k = 0; k < 8; ++k) r[k] = combine(r[k], vld1q_f32(p + 4 * k)); \
+        }                                                                          \
+        for (int k = 0; k < 8; ++k) vst1q_f32(acc + 4 * k, r[k]);                  \
+    }
+
+SIMD_NEON_KERNEL(sum_neon, vaddq_f32)
+SIMD_NEON_KERNEL(min_neon, vminq_f32)
+SIMD_NEON_KERNEL(max_neon, vmaxq_f32)
+#undef SIMD_NEON_KERNEL
+
+inline void dot_neon(const float* a, const float* b, size_t blocks, float* acc) {
+    float32x4_t r[8];
+    for (int k = 0; k < 8; ++k) r[k] = vld1q_f32(acc + 4 * k);
+    for (size_t i = 0; i < blocks; ++i, a += lanes, b += lanes) {
+        for (int k = 0; k < 8; ++k) r[k] = vaddq_f32(r[k], vmulq_f32(vld1q_f32(a + 4 * k), vld1q_f32(b + 4 * k)));
+    }
+    for (int k = 0; k < 8; ++k) vst1q_f32(acc + 4 * k, r[k]);
+}
+
+inline bool cpu_has(Isa isa) noexcept { return isa == Isa::scalar || isa == Isa::neon; }
+
+#else
+
+inline bool cpu_has(Isa isa) noexcept { return isa == Isa::scalar; }
+
+#endif
+
+// the fixed pairwise tree over the lanes - the same for every path
+template <typename Op>
+float combine_lanes(float* acc, Op op) {
+    for (size_t width = lanes / 2; width > 0; width /= 2) {
+        for (size_t k = 0; k < width; ++k) acc[k] = op(acc[k], acc[k + width]);
+    }
+    return acc[0];
+}
+
+inline float add(float a, float b) { return a + b; }
+inline float smaller(float a, float b) { return b < a ? b : a; }
+inline float larger(float a, float b) { return b > a ? b : a; }
+
+template <typename Range>
+std::span<const float> as_floats(const Range& range) {
+    return std::span<const float>(std::ranges::data(range), std::ranges::size(range));
+}
+
+} // namespace detail
+
+inline bool supported(Isa isa) noexcept { return detail::cpu_has(isa); }
+
+// the kernels for one path. asking for an unsupported one gets the scalar kernels.
+inline Kernels kernels(Isa isa) noexcept {
+    if (!supported(isa)) isa = Isa::scalar;
+    switch (isa) {
+#if defined(SIMD_X86)
+    case Isa::sse2:   return { isa, detail::sum_sse2, detail::dot_sse2, detail::min_sse2, detail::max_sse2 };
+    case Isa::avx2:   return { isa, detail::sum_avx2, detail::dot_avx2, detail::min_avx2, detail::max_avx2 };
+    case Isa::avx512: return { isa, detail::sum_avx512, detail::dot_avx512, detail::min_avx512, detail::max_avx512 };
+#elif defined(SIMD_NEON)
+    case Isa::neon:   return { isa, detail::sum_neon, detail::dot_neon, detail::min_neon, detail::max_neon };
+#endif
+    default:          return { Isa::scalar, detail::sum_scalar, detail::dot_scalar, detail::min_scalar, detail::max_scalar };
+    }
+}
+
+// the widest path this machine runs, resolved on first use
+inline const Kernels& active() noexcept {
+    static Kernels const best = [] {
+        for (Isa isa : { Isa::avx512, Isa::avx2, Isa::neon, Isa::sse2 }) {
+            if (supported(isa)) return kernels(isa);
+        }
+        return kernels(Isa::scalar);
+    }();
+    return best;
+}
+
+inline float sum(std::span<const float> v, const Kernels& k = active()) {
+    float acc[lanes] = {};
+    size_t const blocks = v.size() / lanes;
+    k.sum(v.data(), blocks, acc);
+    for (size_t i = blocks * lanes; i < v.size(); ++i) acc[i % lanes] += v[i];
+    return detail::combine_lanes(acc, detail::add);
+}
+
+// a and b must be the same length
+inline float dot(std::span<const float> a, std::span<const float> b, const Kernels& k = active()) {
+    size_t const n = std::min(a.size(), b.size());
+    float acc[lanes] = {};
+    size_t const blocks = n / lanes;
+    k.dot(a.data(), b.data(), blocks, acc);
+    for (size_t i = blocks * lanes; i < n; ++i) {
+        float const product = a[i] * b[i];
+        acc[i % lanes] += product;
+    }
+    return detail::combine_lanes(acc, detail::add);
+}
+
+// +infinity for an empty range
+inline float min(std::span<const float> v, const Kernels& k = active()) {
+    float acc[lanes];
+    std::fill(acc, acc + lanes, std::numeric_limits<float>::infinity());
+    size_t const blocks = v.size() / lanes;
+    k.min(v.data(), blocks, acc);
+    for (size_t i = blocks * lanes; i < v.size(); ++i) acc[i % lanes] = detail::smaller(acc[i % lanes], v[i]);
+    return detail::combine_lanes(acc, detail::smaller);
+}
+
+// -infinity for an empty range
+inline float max(std::span<const float> v, const Kernels& k = active()) {
+    float acc[lanes];
+    std::fill(acc, acc + lanes, -std::numeric_limits<float>::infinity());
+    size_t const blocks = v.size() / lanes;
+    k.max(v.data(), blocks, acc);
+    for (size_t i = blocks * lanes; i < v.size(); ++i) acc[i % lanes] = detail::larger(acc[i % lanes], v[i]);
+    return detail::combine_lanes(acc, detail::larger);
+}
+
+// sum of map(x) - fused, so the mapped values never go to memory. map is inlined into a loop
+// with the same 32-lane layout as sum(), which the compiler vectorizes at whatever ISA the
+// translation unit is built for; map_reduce(v, identity) == sum(v).
+template <typename Map>
+float map_reduce(std::span<const float> v, Map&& map) {
+    float acc[lanes] = {};
+    size_t const blocks = v.size() / lanes;
+    const float* p = v.data();
+    for (size_t b = 0; b < blocks; ++b, p += lanes) {
+        for (size_t k = 0; k < lanes; ++k) acc[k] += static_cast<float>(map(p[k]));
+    }
+    for (size_t i = blocks * lanes; i < v.size(); ++i) acc[i % lanes] += static_cast<float>(map(v[i]));
+    return detail::combine_lanes(acc, detail::add);
+}
+
+// the same for SmallVector, UniqueBuffer, std::vector, ... - anything contiguous with data()/size()
+template <typename Range>
+float sum(const Range& v) { return sum(detail::as_floats(v)); }
+
+template <typename A, typename B>
+float dot(const A& a, const B& b) { return dot(detail::as_floats(a), detail::as_floats(b)); }
+
+template <typename Range>
+float min(const Range& v) { return min(detail::as_floats(v)); }
+
+template <typename Range>
+float max(const Range& v) { return max(detail::as_floats(v)); }
+
+template <typename Range, typename Map>
+    requires (!std::is_same_v<Range, std::span<const float>>)
+float map_reduce(const Range& v, Map&& map) { return map_reduce(detail::as_floats(v), std::forward<Map>(map)); }
+
+} // namespace simd
+
+#if defined(__clang__)
+#pragma float_control(pop)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#undef SIMD_TARGET
+#undef SIMD_X86
+#undef SIMD_NEON
@@ -1,125 +1,109 @@
 #pragma once
 
-template <typename T, size_t N>
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <unique_buffer.h>
+
+/*
+SmallVector<T, N, Alloc> - a vector that keeps its first N elements inline and only spills to
+Alloc once it outgrows them.
+
+Alloc is a UniqueBuffer allocation policy: HeapAlloc by default, ArenaAlloc (arena_allocator.h)
+to take the spill from an ArenaAllocator. Only allocate/deallocate and the optional reallocate
+are used - new elements are always value-initialized, like std::vector's.
+
+Growth doubles the capacity. Trivially relocatable elements (trivially copyable ones, or types
+that specialize is_trivially_relocatable) move with a single memcpy, and once they are on the
+heap the block grows through the policy's reallocate - realloc often extends it in place and
+copies nothing at all. Everything else moves element by element with move_if_noexcept.
+
+Layout: one pointer to the elements - the inline storage or the heap block - plus size and
+capacity, so element access and iteration never branch on where the elements live. Size is the
+type both are stored in; CompactSmallVector picks uint32_t, which shrinks the header from 24 to
+16 bytes and caps the vector at 2^32 - 1 elements (growing past that throws length_error) - for
+the many-small-vectors case, where the header is most of each object. Being inline is just
+data() pointing at our own storage, so a move has to re-point it; the ctors take care of that.
+*/
+
+// specialize for types whose objects can be moved by copying their bytes and simply forgetting
+// the source - no pointers into themselves, nothing registered by address. most handles
+// (unique_ptr-like types) qualify.
+template <typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+template <typename T, size_t N, typename Alloc = HeapAlloc, typename Size = size_t>
 class SmallVector {
-    union VectorStore {
+    static_assert(std::is_unsigned_v<Size>, "Size must be an unsigned integer type");
+    static_assert(N <= std::numeric_limits<Size>::max(), "inline capacity doesn't fit in Size");
+
+    union InlineStore {
         T stack[N];
-        T* heap_data_ptr = nullptr;
 
-        VectorStore() {}
-        ~VectorStore() {}
+        InlineStore() {}
+        ~InlineStore() {}
     };
 
+    static constexpr bool relocatable = is_trivially_relocatable_v<T>;
+    static constexpr bool can_reallocate = relocatable &&
+        requires(Alloc& a, void* p, size_t n) { { a.reallocate(p, n, n, n) } -> std::same_as<void*>; };
+
     public:
-        SmallVector<T, N>() : m_size(0), m_capacity(N), m_on_stack(true) {}
-        SmallVector<T, N>(size_t size) : SmallVector<T, N>(size, 0) { }
-
-        SmallVector<T, N>(size_t size, T default_value) : 
-                            m_size(size), 
-                            m_capacity(m_size > N ? m_size + N : N), 
-                            m_on_stack(m_size <= N) {
-            if (m_on_stack) {
-                for (int i = 0; i < m_size; i++) {
-                    m_storage.stack[i] = T(default_value);
-                }
-            } else {
-                m_storage.heap_data_ptr = new T[m_capacity] { default_value };
-            }
-        }
+        SmallVector() : m_data(m_storage.stack), m_size(0), m_capacity(N) {}
 
-        SmallVector<T, N>(std::initializer_list<T> init) : 
-                        m_size(init.size()), 
-                        m_capacity(m_size > N ? m_size : N),
-                        m_on_stack(m_size <= N) {
-            T* to_modify;
-            if (m_on_stack) {
-                to_modify = m_storage.stack;
-            } else {
-                m_storage.heap_data_ptr = reinterpret_cast<T*>(new std::byte[m_capacity * sizeof(T)]);
-                to_modify = m_storage.heap_data_ptr;
-            }
+        explicit SmallVector(Alloc alloc) : m_data(m_storage.stack), m_size(0), m_capacity(N), m_alloc(std::move(alloc)) {}
 
-            int i = 0;
-            for (auto v : init) {
-                new (to_modify + i) T(v);
-                ++i;
-            }
+        // size value-initialized elements
+        explicit SmallVector(size_t size, Alloc alloc = Alloc()) : SmallVector(std::move(alloc)) {
+            resize(size);
         }
 
-        SmallVector<T, N>(SmallVector<T,N>&& src) noexcept {
-            if (src.m_on_stack) {
-                for (size_t i = 0; i < src.m_size; ++i) {
-                    new (m_storage.stack + i) T(std::move(src.m_storage.stack[i]));
-                }
-            } else {
-                m_storage.heap_data_ptr = reinterpret_cast<T*>(new std::byte[src.m_capacity * sizeof(T)]);
-                std::swap(m_storage.heap_data_ptr, src.m_storage.heap_data_ptr);
-            }
+        SmallVector(size_t size, const T& default_value, Alloc alloc = Alloc()) : SmallVector(std::move(alloc)) {
+            resize(size, default_value);
+        }
 
-            m_size = src.m_size;
-            m_capacity = src.m_capacity;
-            m_on_stack = src.m_on_stack;
+        SmallVector(std::initializer_list<T> init, Alloc alloc = Alloc()) : SmallVector(std::move(alloc)) {
+            reserve(init.size());
+            std::uninitialized_copy(init.begin(), init.end(), data());
+            m_size = static_cast<Size>(init.size());
+        }
 
-            src.m_size = 0;
-            src.m_on_stack = true;
+        // a heap block changes hands as is; inline elements have to be moved over one by one
+        SmallVector(SmallVector&& src) noexcept(std::is_nothrow_move_constructible_v<T>)
+            : m_data(m_storage.stack), m_size(0), m_capacity(N), m_alloc(std::move(src.m_alloc)) {
+            take(src);
         }
 
-        SmallVector<T, N>& operator=(SmallVector<T,N>&& src) noexcept {
-            if (!empty()) {
-                for (const T* it = begin(); it != end(); ++it) {
-                    it->~T();
-                }
+        SmallVector& operator=(SmallVector&& src) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            if (this != &src) {
+                release();
+                m_alloc = std::move(src.m_alloc);
+                take(src);
             }
-            
-            if (src.m_on_stack) {
-                for (size_t i = 0; i < src.m_size; ++i) {
-                    new (m_storage.stack + i) T(std::move(src.m_storage.stack[i]));
-                }
-            } else {
-                m_storage.heap_data_ptr = reinterpret_cast<T*>(new std::byte[src.m_capacity * sizeof(T)]);
-                std::swap(m_storage.heap_data_ptr, src.m_storage.heap_data_ptr);
-            }
-
-            m_size = src.m_size;
-            m_capacity = src.m_capacity;
-            m_on_stack = src.m_on_stack;
-
-            src.m_size = 0;
-            src.m_on_stack = true;
-
             return *this;
         }
 
-        SmallVector<T, N>(const SmallVector<T, N>& copy) {
-            if (copy.m_on_stack) {
-                for (size_t i = 0; i < copy.m_size; ++i) {
-                    new (m_storage.stack + i) T(copy.m_storage.stack[i]);
-                }
-            } else {
-                m_storage.heap_data_ptr = reinterpret_cast<T*>(new std::byte[copy.m_capacity * sizeof(T)]);
-                for (int i = 0; i < copy.m_size; i++) {
-                    new (m_storage.heap_data_ptr + i) T(copy[i]);
-                }
-            }
-
+        SmallVector(const SmallVector& copy) : SmallVector(copy.m_alloc) {
+            reserve(copy.m_size);
+            std::uninitialized_copy_n(copy.data(), copy.m_size, data());
             m_size = copy.m_size;
-            m_capacity = copy.m_capacity;
-            m_on_stack = copy.m_on_stack;
         }
 
-        ~SmallVector<T, N>() {
-            for (const T* it = begin(); it != end(); ++it) {
-                it->~T();
-            }
-
-            if (!m_on_stack) {
-                delete[] reinterpret_cast<std::byte*>(m_storage.heap_data_ptr);
-            }
-
-            m_storage.heap_data_ptr = nullptr;
-            m_size = 0;
-            m_capacity = N;
-            m_on_stack = true;
+        ~SmallVector() {
+            release();
         }
 
         T& operator[](size_t index) {
@@ -130,174 +114,296 @@ class SmallVector {
             return get_element(index);
         }
 
-        SmallVector<T, N>& operator=(const SmallVector<T, N>& copy) {
-            if (this == 0) {
+        // keeps our storage (and allocator) and copies the elements into it
+        SmallVector& operator=(const SmallVector& copy) {
+            if (this == &copy) {
                 return *this;
             }
 
-            if (!empty()) {
-                for (const T* it = begin(); it != end(); ++it) {
-                    it->~T();
-                }
-            }
+            clear();
+            reserve(copy.m_size);
+            std::uninitialized_copy_n(copy.data(), copy.m_size, data());
+            m_size = copy.m_size;
+            return *this;
+        }
 
-            if (!m_on_stack) {
-                delete[] reinterpret_cast<std::byte*>(m_storage.heap_data_ptr);
-            }
+        T* begin() noexcept { return m_data; }
+        const T* begin() const noexcept { return m_data; }
+        T* end() noexcept { return m_data + m_size; }
+        const T* end() const noexcept { return m_data + m_size; }
 
-            if (copy.m_on_stack) {
-                for (size_t i = 0; i < copy.m_size; ++i) {
-                    new (m_storage.stack + i) T(copy.m_storage.stack[i]);
-                }            
-            } else {
-                m_storage.heap_data_ptr = reinterpret_cast<T*>(new std::byte[copy.m_capacity * sizeof(T)]);
-                for (int i = 0; i < copy.m_size; i++) {
-                    new (m_storage.heap_data_ptr + i) T(copy[i]);
-                }
-            }
+        T* data() noexcept { return m_data; }
+        const T* data() const noexcept { return m_data; }
 
-            m_size = copy.m_size;
-            m_capacity = copy.m_capacity;
-            m_on_stack = copy.m_on_stack;
-            return *this;
+    private:
+        T* m_data;          // m_storage.stack while inline, the heap block after that
+        Size m_size;
+        Size m_capacity;
+        [[no_unique_address]] Alloc m_alloc;
+        InlineStore m_storage;
+
+        T& get_element(size_t index) {
+            return m_data[index];
         }
 
-        T* begin() { 
-            if (m_on_stack) {
-                return &(m_storage.stack[0]);
-            } else {
-                return m_storage.heap_data_ptr;
+        const T& get_element(size_t index) const {
+            return m_data[index];
+        }
+
+        static constexpr size_t max_capacity = std::min<size_t>(std::numeric_limits<Size>::max(), SIZE_MAX / sizeof(T));
+
+        // a T built in a side buffer and later memcpy'd to its slot, without a move
+        // constructor call - only for relocatable T
+        struct Relocating {
+            alignas(T) std::byte bytes[sizeof(T)];
+            bool live = true;
+
+            template <typename... Args>
+            explicit Relocating(Args&&... args) { new (bytes) T(std::forward<Args>(args)...); }
+            ~Relocating() { if (live) std::launder(reinterpret_cast<T*>(bytes))->~T(); }
+
+            T* relocate_to(T* slot) noexcept {
+                std::memcpy(static_cast<void*>(slot), bytes, sizeof(T));
+                live = false;
+                return std::launder(slot);
             }
+        };
+
+        size_t grown_capacity(size_t required) const {
+            if (required > max_capacity) throw std::length_error("SmallVector capacity exceeds its size type");
+            return std::min(max_capacity, std::max(required, size_t(m_capacity) * 2));
         }
 
-        const T* begin() const { 
-            if (m_on_stack) {
-                return &(m_storage.stack[0]);
-            } else {
-                return m_storage.heap_data_ptr;
+        T* allocate(size_t capacity) {
+            return static_cast<T*>(m_alloc.allocate(capacity * sizeof(T), alignof(T)));
+        }
+
+        void free_heap() noexcept {
+            if (!on_stack()) {
+                m_alloc.deallocate(m_data, size_t(m_capacity) * sizeof(T), alignof(T));
             }
         }
 
-        T* end() { 
-            if (m_on_stack) {
-                return &(m_storage.stack[m_size]);
+        // moves count elements into uninitialized memory at `to` and ends the originals. if a
+        // move (or, for throwing moves, a copy) fails, `from` is left as it was
+        static void relocate(T* from, size_t count, T* to) {
+            if constexpr (relocatable) {
+                std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
             } else {
-                return (m_storage.heap_data_ptr + m_size);
+                if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+                    std::uninitialized_move_n(from, count, to);
+                } else {
+                    std::uninitialized_copy_n(from, count, to);
+                }
+                std::destroy_n(from, count);
             }
         }
 
-        const T* end() const { 
-            if (m_on_stack) {
-                return &(m_storage.stack[m_size]);
-            } else {
-                return (m_storage.heap_data_ptr + m_size);
+        // switches to a block of `capacity` (<= max_capacity) elements, which must hold at least m_size
+        void grow_to(size_t capacity) {
+            if constexpr (can_reallocate) {
+                if (!on_stack()) {
+                    void* grown = m_alloc.reallocate(m_data, size_t(m_capacity) * sizeof(T),
+                                                     capacity * sizeof(T), alignof(T));
+                    if (grown != nullptr) {
+                        m_data = static_cast<T*>(grown);
+                        m_capacity = static_cast<Size>(capacity);
+                        return;
+                    }
+                }
             }
+
+            T* buffer = allocate(capacity);
+            try {
+                relocate(data(), m_size, buffer);
+            } catch (...) {
+                m_alloc.deallocate(buffer, capacity * sizeof(T), alignof(T));
+                throw;
+            }
+            adopt(buffer, capacity);
         }
 
-    private:
-        size_t m_size;
-        size_t m_capacity;
-        bool m_on_stack;
-        VectorStore m_storage;
+        void adopt(T* buffer, size_t capacity) noexcept {
+            free_heap();
+            m_data = buffer;
+            m_capacity = static_cast<Size>(capacity);
+        }
 
-        T& get_element(size_t index) {
-            if (m_on_stack) {
-                return m_storage.stack[index];
-            } else {
-                return m_storage.heap_data_ptr[index];
+        // out of line so emplace_back itself stays small enough to inline. args may refer to one
+        // of our own elements, so the new element is built before the old ones go anywhere.
+        template <typename... Args>
+        T& grow_and_emplace_back(Args&&... args) {
+            size_t const capacity = grown_capacity(m_size + 1);
+            if constexpr (can_reallocate) {
+                if (!on_stack()) {
+                    // realloc may free what args point at, so build the element off to the side
+                    // first. it is relocatable, so getting it into place is a memcpy as well.
+                    Relocating value(std::forward<Args>(args)...);
+                    grow_to(capacity);
+                    T* slot = value.relocate_to(m_data + m_size);
+                    ++m_size;
+                    return *slot;
+                }
             }
+
+            T* buffer = allocate(capacity);
+            T* slot = nullptr;
+            try {
+                slot = new (buffer + m_size) T(std::forward<Args>(args)...);
+                relocate(data(), m_size, buffer);
+            } catch (...) {
+                if (slot != nullptr) slot->~T();
+                m_alloc.deallocate(buffer, capacity * sizeof(T), alignof(T));
+                throw;
+            }
+            adopt(buffer, capacity);
+            ++m_size;
+            return *slot;
         }
 
-        const T& get_element(size_t index) const {
-            if (m_on_stack) {
-                return m_storage.stack[index];
-            } else {
-                return m_storage.heap_data_ptr[index];
+        // steals src's heap block or moves its inline elements over, leaving src empty and
+        // inline. we must be empty and inline ourselves.
+        void take(SmallVector& src) {
+            if (src.on_stack()) {
+                relocate(src.m_data, src.m_size, m_data);
+                m_size = std::exchange(src.m_size, 0);
+                return;
             }
+
+            m_data = std::exchange(src.m_data, src.m_storage.stack);
+            m_size = std::exchange(src.m_size, 0);
+            m_capacity = std::exchange(src.m_capacity, static_cast<Size>(N));
+        }
+
+        void release() noexcept {
+            clear();
+            free_heap();
+            m_data = m_storage.stack;
+            m_capacity = N;
         }
 
     public:
-        T at(size_t index) {             
+        T at(size_t index) {
             if (index >= m_size) {
                 throw std::out_of_range("index out of range of vector");
             }
-            return get_element(index); 
+            return get_element(index);
         }
 
         const T at(size_t index) const {
             if (index >= m_size) {
                 throw std::out_of_range("index out of range of vector");
             }
-            return get_element(index); 
+            return get_element(index);
+        }
+
+        // constructs the element in place from args - no temporary, no move
+        template <typename... Args>
+        T& emplace_back(Args&&... args) {
+            if (m_size == m_capacity) {
+                return grow_and_emplace_back(std::forward<Args>(args)...);
+            }
+            T* slot = new (m_data + m_size) T(std::forward<Args>(args)...);
+            ++m_size;
+            return *slot;
         }
 
         // needed for perfect forwarding
         template<class U = T>
         void push_back(U&& element) {
-            if (m_on_stack) {
-                if (m_size < N) { // still on the stack
-                    // construct the stack element in the buffer
-                    new (m_storage.stack + m_size) T(std::forward<U>(element));
-                } else { // if we've exhausted stack space, it's time to grow onto the heap
-                    size_t new_capacity = (N == 0) ? 1 : N * 2;
-                    
-                    // allocate raw memory for the new capacity
-                    T* new_heap_buffer = reinterpret_cast<T*>(new std::byte[new_capacity * sizeof(T)]);
-
-                    // 2. Move elements from the stack to the new heap buffer
-                    for (size_t i = 0; i < m_size; ++i) {
-                        new (new_heap_buffer + i) T(std::move_if_noexcept(m_storage.stack[i]));
-                        (m_storage.stack + i)->~T();
-                    }
-                    
-                    // finally, place the element
-                    new (new_heap_buffer + m_size) T(element);
-
-                    // Update internal state 
-                    m_storage.heap_data_ptr = new_heap_buffer;
-                    m_on_stack = false;
-                    m_capacity = new_capacity;
-                }
-            } else { // already on heap
-                if (m_size < m_capacity) {
-                    new (m_storage.heap_data_ptr + m_size) T(element);
-                } else { // Heap is full, grow the space
-                     size_t new_capacity = (m_capacity == 0) ? 1 : m_capacity * 2;
-                    
-                    // allocate raw memory for the new capacity
-                    T* new_heap_buffer = reinterpret_cast<T*>(new std::byte[new_capacity * sizeof(T)]);
-
-                    // 2. Move elements from the stack to the new heap buffer
-                    for (size_t i = 0; i < m_size; ++i) {
-                        new (new_heap_buffer + i) T(std::move_if_noexcept(m_storage.heap_data_ptr[i]));
-                        (m_storage.heap_data_ptr + i)->~T();
-                    }
-                    
-                    // finally, place the element
-                    new (new_heap_buffer + m_size) T(element);
-
-                    // Update internal state
-                    delete[] reinterpret_cast<std::byte*>(m_storage.heap_data_ptr);
-                    m_storage.heap_data_ptr = new_heap_buffer;
-                    m_on_stack = false;
-                    m_capacity = new_capacity;
-                }
+            emplace_back(std::forward<U>(element));
+        }
+
+        // constructs an element in front of pos, shifting the ones from pos on up by one.
+        // returns it; pointers at or after pos are invalidated, all of them if we grow.
+        template <typename... Args>
+        T* emplace(const T* pos, Args&&... args) {
+            size_t const index = static_cast<size_t>(pos - begin());
+            if (index == m_size) {
+                emplace_back(std::forward<Args>(args)...);
+                return data() + index;
+            }
+
+            // args may refer to an element about to shift
+            std::conditional_t<relocatable, Relocating, T> value(std::forward<Args>(args)...);
+            if (m_size == m_capacity) {
+                grow_to(grown_capacity(m_size + 1));
             }
-            m_size++;
+
+            T* first = data() + index;
+            T* last = data() + m_size;
+            if constexpr (relocatable) {
+                std::memmove(static_cast<void*>(first + 1), static_cast<const void*>(first), (m_size - index) * sizeof(T));
+                value.relocate_to(first);
+                ++m_size;
+            } else {
+                new (last) T(std::move(last[-1]));
+                ++m_size;
+                std::move_backward(first, last - 1, last);
+                *first = std::move(value);
+            }
+            return first;
+        }
+
+        template <class U = T>
+        T* insert(const T* pos, U&& value) {
+            return emplace(pos, std::forward<U>(value));
+        }
+
+        // count copies of value in front of pos
+        T* insert(const T* pos, size_t count, const T& value) {
+            size_t const index = static_cast<size_t>(pos - begin());
+            size_t const old_size = m_size;
+            resize(old_size + count, value);
+            std::rotate(data() + index, data() + old_size, data() + m_size);
+            return data() + index;
         }
 
         void pop_back() {
-            if (m_size == 0) { 
+            if (m_size == 0) {
                 throw std::out_of_range("vector already empty");
             }
 
-            if (m_on_stack) {
-                m_storage.stack[m_size].~T();
-            } else {
-                m_storage.heap_data_ptr[m_size].~T();
+            --m_size;
+            get_element(m_size).~T();
+        }
+
+        // makes room for `capacity` elements without constructing any. never shrinks, and never
+        // moves back inline.
+        void reserve(size_t capacity) {
+            if (capacity > m_capacity) {
+                if (capacity > max_capacity) throw std::length_error("SmallVector capacity exceeds its size type");
+                grow_to(capacity);
             }
+        }
 
-            --m_size;
+        // new elements are value-initialized; shrinking destroys the tail and keeps the storage
+        void resize(size_t size) {
+            if (size <= m_size) {
+                std::destroy(data() + size, data() + m_size);
+                m_size = static_cast<Size>(size);
+                return;
+            }
+            if (size > m_capacity) {
+                grow_to(grown_capacity(size));
+            }
+            std::uninitialized_value_construct(data() + m_size, data() + size);
+            m_size = static_cast<Size>(size);
+        }
+
+        void resize(size_t size, const T& value) {
+            if (size <= m_size) {
+                resize(size);
+                return;
+            }
+            if (size > m_capacity) {
+                T fill(value);   // value may live in the block we're about to leave
+                grow_to(grown_capacity(size));
+                std::uninitialized_fill(data() + m_size, data() + size, fill);
+            } else {
+                std::uninitialized_fill(data() + m_size, data() + size, value);
+            }
+            m_size = static_cast<Size>(size);
         }
 
         size_t size() noexcept { return m_size; }
@@ -305,11 +411,16 @@ class SmallVector {
         size_t  capacity() noexcept { return m_capacity; }
         const size_t capacity() const noexcept { return m_capacity; }
 
-        bool on_stack() noexcept { return m_on_stack; }
-        bool empty() noexcept { return m_size == 0; }
+        bool on_stack() const noexcept { return m_data == m_storage.stack; }
+        bool empty() const noexcept { return m_size == 0; }
         void clear() noexcept {
-            while (!empty()) {
-                pop_back();
-            }
-         } 
-};
\ No newline at end of file
+            std::destroy_n(data(), m_size);
+            m_size = 0;
+        }
+
+        const Alloc& allocator() const noexcept { return m_alloc; }
+};
+
+// 32-bit size and capacity: a 16-byte header instead of 24, for containers of many small vectors
+template <typename T, size_t N, typename Alloc = HeapAlloc>
+using CompactSmallVector = SmallVector<T, N, Alloc, uint32_t>;
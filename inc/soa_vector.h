@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <cache_line.h>
+#include <unique_buffer.h>
+
+/*
+SoAVector<Fields...> - a growable table stored structure-of-arrays: one contiguous column per
+field instead of one struct per row.
+
+    SoAVector<std::byte*, std::byte*> chunks;   // begin, end
+    chunks.push_back(b, e);
+
+    chunks.sort_by<0>();                        // by begin
+    auto ends = chunks.column<1>();             // std::span<std::byte*>
+    for (auto [begin, end] : chunks) { ... }    // zip-style: one tuple of references per row
+
+A loop that only reads one field streams through that field's column and nothing else, so every
+cache line fetched is all useful data, and a column is exactly what the SIMD kernels take
+(simd::sum(table.column<2>())). Columns start on a cache line (64 bytes, enough for any vector
+width up to AVX-512).
+
+Fields must be trivially copyable - columns grow like UniqueBuffer's, with realloc or memcpy.
+Alloc is the columns' UniqueBuffer allocation policy: SoAVector uses UninitializedAlloc, so
+growing never zeroes the spare capacity; BasicSoAVector<ArenaAlloc, ...> keeps the columns in an
+ArenaAllocator.
+
+Rows are proxies (std::tuple<Fields&...>), so the iterators are proxy iterators like
+std::views::zip's - fine for range-for and hand-written loops, but not for std::sort. Use
+sort_by<I>() instead, which argsorts the key column alone and then moves each column once.
+*/
+template <typename Alloc, typename... Fields>
+class BasicSoAVector
+{
+    static_assert(sizeof...(Fields) > 0, "a table needs at least one column");
+    static_assert((std::is_trivially_copyable_v<Fields> && ...), "columns grow by memcpy - fields must be trivially copyable");
+
+    template <typename F>
+    using Column = AlignedBuffer<F, cache_line_size, Alloc>;
+
+public:
+    static constexpr size_t column_count = sizeof...(Fields);
+    static constexpr size_t column_alignment = cache_line_size;
+
+    template <size_t I>
+    using field_type = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    using value_type = std::tuple<Fields...>;
+    using reference = std::tuple<Fields&...>;
+    using const_reference = std::tuple<const Fields&...>;
+
+    template <bool Const>
+    class Iterator
+    {
+    public:
+        using iterator_concept = std::random_access_iterator_tag;
+        using iterator_category = std::input_iterator_tag;   // proxy - the reference isn't value_type&
+        using value_type = std::tuple<Fields...>;
+        using reference = std::conditional_t<Const, std::tuple<const Fields&...>, std::tuple<Fields&...>>;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+
+        reference operator*() const {
+            return std::apply([](auto*... p) { return reference(*p...); }, m_rows);
+        }
+
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        Iterator& operator++() { return *this += 1; }
+        Iterator operator++(int) { Iterator old = *this; ++*this; return old; }
+        Iterator& operator--() { return *this -= 1; }
+        Iterator operator--(int) { Iterator old = *this; --*this; return old; }
+
+        Iterator& operator+=(difference_type n) {
+            std::apply([n](auto*&... p) { ((p += n), ...); }, m_rows);
+            return *this;
+        }
+        Iterator& operator-=(difference_type n) { return *this += -n; }
+
+        friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+        friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+        friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const Iterator& a, const Iterator& b) {
+            return std::get<0>(a.m_rows) - std::get<0>(b.m_rows);
+        }
+
+        // every column moves in step, so the first one says where we are
+        friend bool operator==(const Iterator& a, const Iterator& b) {
+            return std::get<0>(a.m_rows) == std::get<0>(b.m_rows);
+        }
+        friend auto operator<=>(const Iterator& a, const Iterator& b) {
+            return std::get<0>(a.m_rows) <=> std::get<0>(b.m_rows);
+        }
+
+    private:
+        friend class BasicSoAVector;
+        using Rows = std::conditional_t<Const, std::tuple<const Fields*...>, std::tuple<Fields*...>>;
+
+        explicit Iterator(Rows rows) : m_rows(rows) {}
+
+        Rows m_rows{};
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    BasicSoAVector() requires std::default_initializable<Alloc> : BasicSoAVector(Alloc()) {}
+
+    explicit BasicSoAVector(Alloc alloc) : m_columns(Column<Fields>(0, alloc)...) {}
+
+    // columns are UniqueBuffers, and like them the table is move-only
+    BasicSoAVector(BasicSoAVector&& src) noexcept
+        : m_columns(std::move(src.m_columns)),
+          m_size(std::exchange(src.m_size, 0)),
+          m_capacity(std::exchange(src.m_capacity, 0)) {}
+
+    BasicSoAVector& operator=(BasicSoAVector&& src) noexcept {
+        if (this != &src) {
+            m_columns = std::move(src.m_columns);
+            m_size = std::exchange(src.m_size, 0);
+            m_capacity = std::exchange(src.m_capacity, 0);
+        }
+        return *this;
+    }
+
+    BasicSoAVector(const BasicSoAVector&) = delete;
+    BasicSoAVector& operator=(const BasicSoAVector&) = delete;
+
+    // by value - the arguments may be elements of this table, which growing would move
+    void push_back(Fields... values) {
+        if (m_size == m_capacity) {
+            grow_to(std::max<size_t>(16, m_capacity * 2));
+        }
+        store(m_size, values...);
+        ++m_size;
+    }
+
+    void push_back(const value_type& row) {
+        std::apply([this](const Fields&... values) { push_back(values...); }, row);
+    }
+
+    void pop_back() {
+        if (m_size == 0) {
+            throw std::out_of_range("table already empty");
+        }
+        --m_size;
+    }
+
+    reference operator[](size_t row) noexcept {
+        assert(row < m_size && "row out of range for table");
+        return std::apply([row](auto&... column) { return reference(column.data()[row]...); }, m_columns);
+    }
+
+    const_reference operator[](size_t row) const noexcept {
+        assert(row < m_size && "row out of range for table");
+        return std::apply([row](const auto&... column) { return const_reference(column.data()[row]...); }, m_columns);
+    }
+
+    reference at(size_t row) {
+        if (row >= m_size) throw std::out_of_range("row out of range for table");
+        return (*this)[row];
+    }
+
+    const_reference at(size_t row) const {
+        if (row >= m_size) throw std::out_of_range("row out of range for table");
+        return (*this)[row];
+    }
+
+    // the live part of column I, column_alignment aligned
+    template <size_t I>
+    std::span<field_type<I>> column() noexcept {
+        return std::span<field_type<I>>(std::get<I>(m_columns).data(), m_size);
+    }
+
+    template <size_t I>
+    std::span<const field_type<I>> column() const noexcept {
+        return std::span<const field_type<I>>(std::get<I>(m_columns).data(), m_size);
+    }
+
+    iterator begin() noexcept { return iterator(rows(0)); }
+    iterator end() noexcept { return iterator(rows(m_size)); }
+    const_iterator begin() const noexcept { return const_iterator(rows(0)); }
+    const_iterator end() const noexcept { return const_iterator(rows(m_size)); }
+
+    void reserve(size_t capacity) {
+        if (capacity > m_capacity) {
+            grow_to(capacity);
+        }
+    }
+
+    // new rows are value-initialized (zeroed), shrinking keeps the storage
+    void resize(size_t size) {
+        if (size > m_capacity) {
+            grow_to(std::max(size, m_capacity * 2));
+        }
+        if (size > m_size) {
+            for_each_column([this, size](auto& column) {
+                using F = std::remove_pointer_t<decltype(column.data())>;
+                std::fill(column.data() + m_size, column.data() + size, F{});
+            });
+        }
+        m_size = size;
+    }
+
+    void clear() noexcept { m_size = 0; }
+
+    // rows ordered by column I. not stable. the sort runs over (key, row) pairs copied out of
+    // column I alone, so it never touches the other columns; each column is then gathered into
+    // the new order exactly once.
+    template <size_t I, typename Compare = std::less<>>
+    void sort_by(Compare comp = {}) {
+        if (m_size < 2) {
+            return;
+        }
+        struct Keyed {
+            field_type<I> key;
+            size_t row;
+        };
+        auto keyed = UniqueBuffer<Keyed, UninitializedAlloc>::uninitialized(m_size);
+        auto const keys = column<I>();
+        for (size_t i = 0; i < m_size; ++i) {
+            keyed[i] = Keyed{keys[i], i};
+        }
+        std::sort(keyed.data(), keyed.data() + m_size,
+                  [&comp](const Keyed& a, const Keyed& b) { return comp(a.key, b.key); });
+        gather([&keyed](size_t i) { return keyed[i].row; });
+    }
+
+    // row i becomes what was row order[i]; order must be a permutation of [0, size())
+    void permute(std::span<const size_t> order) {
+        assert(order.size() == m_size);
+        gather([order](size_t i) { return order[i]; });
+    }
+
+    size_t size() const noexcept { return m_size; }
+    size_t capacity() const noexcept { return m_capacity; }
+    bool empty() const noexcept { return m_size == 0; }
+
+private:
+    // every column rebuilt as new[i] = old[source(i)]
+    template <typename Source>
+    void gather(Source source) {
+        for_each_column([this, &source](auto& column) {
+            using C = std::remove_cvref_t<decltype(column)>;
+            C gathered = C::uninitialized(m_capacity, column.allocator());
+            for (size_t i = 0; i < m_size; ++i) {
+                gathered.data()[i] = column.data()[source(i)];
+            }
+            column = std::move(gathered);
+        });
+    }
+
+    template <typename F>
+    void for_each_column(F&& f) {
+        std::apply([&f](auto&... column) { (f(column), ...); }, m_columns);
+    }
+
+    auto rows(size_t row) noexcept {
+        return std::apply([row](auto&... column) { return std::tuple<Fields*...>(column.data() + row...); }, m_columns);
+    }
+
+    auto rows(size_t row) const noexcept {
+        return std::apply([row](const auto&... column) { return std::tuple<const Fields*...>(column.data() + row...); }, m_columns);
+    }
+
+    void store(size_t row, const Fields&... values) {
+        store_at(row, std::index_sequence_for<Fields...>{}, values...);
+    }
+
+    template <size_t... I>
+    void store_at(size_t row, std::index_sequence<I...>, const Fields&... values) {
+        ((std::get<I>(m_columns).data()[row] = values), ...);
+    }
+
+    // every column holds `capacity` (trivially constructed) elements; only the first m_size count
+    void grow_to(size_t capacity) {
+        for_each_column([capacity](auto& column) { column.resize(capacity); });
+        m_capacity = capacity;
+    }
+
+    std::tuple<Column<Fields>...> m_columns;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
+
+template <typename... Fields>
+using SoAVector = BasicSoAVector<UninitializedAlloc, Fields...>;
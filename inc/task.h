@@ -0,0 +1,584 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <arena_allocator.h>
+#include <pool_allocator.h>
+#include <thread_pool.h>
+
+/*
+Task<T> - lazy C++20 coroutines that hop onto a ThreadPool instead of blocking a worker.
+
+    Task<int> load(ThreadPool& pool, int id) {
+        co_await schedule_on(pool);              // from here on we run on a worker
+        co_return expensive(id);
+    }
+
+    Task<int> both(ThreadPool& pool) {
+        auto [a, b] = co_await when_all(load(pool, 1), load(pool, 2));   // in parallel
+        co_return a + b;
+    }
+
+    int total = sync_wait(both(pool));           // the one blocking call, from outside the pool
+
+A Task does nothing until it is awaited. co_await starts it on the awaiting thread; a task that
+finishes right there hands its result straight back without the awaiter ever suspending, so long
+loops of synchronous co_awaits run in constant stack. One that suspends (on schedule_on, a latch,
+...) has the awaiter parked as its continuation and resumes it from whichever thread finishes it.
+Exceptions travel with the result and are rethrown by co_await (or sync_wait).
+
+schedule_on(pool) suspends and resumes the coroutine as a pool job. From a worker that is a push
+onto the bottom of the worker's own deque, so a continuation is the next thing the same worker
+runs unless someone steals it first. Nothing in here ever blocks a thread: when_all, AsyncLatch
+and AsyncBarrier park coroutines, and whoever completes the last piece resumes them - inline, or
+as pool jobs when given a pool.
+
+Frames come from a thread-safe SizeClassAllocator shared by all tasks - its per-thread-slot
+magazines make a frame allocation a pop off the calling worker's own free list, and a frame freed
+on another worker just joins that worker's cache. Frames above its largest class go to the heap.
+A task whose first two parameters are (std::allocator_arg_t, ArenaAllocator&) puts its frame in
+that arena instead; such frames are never freed individually, the arena takes them back on
+reset().
+*/
+
+namespace coro_detail {
+
+template <typename T>
+struct Access;
+
+// every frame is prefixed with where it came from, so operator delete can give it back
+struct alignas(std::max_align_t) FrameHeader {
+    ArenaAllocator* arena = nullptr;
+    bool pooled = false;
+};
+
+// lives for the whole program - frames may be freed during static destruction
+inline SizeClassAllocator& frame_pool() {
+    static SizeClassAllocator* pool = new SizeClassAllocator(PoolOptions{ .blocks_per_slab = 64, .thread_safe = true });
+    return *pool;
+}
+
+inline void* allocate_frame(size_t size, ArenaAllocator* arena) {
+    size_t const bytes = size + sizeof(FrameHeader);
+    void* block = nullptr;
+    bool pooled = false;
+    if (arena != nullptr) {
+        block = arena->allocate(bytes, alignof(FrameHeader));
+        if (block == nullptr) throw std::bad_alloc();
+    } else if (bytes <= SizeClassAllocator::max_block) {
+        block = frame_pool().allocate(bytes);
+        if (block == nullptr) throw std::bad_alloc();
+        pooled = true;
+    } else {
+        block = ::operator new(bytes);
+    }
+    auto* header = ::new (block) FrameHeader{arena, pooled};
+    return header + 1;
+}
+
+inline void free_frame(void* frame, size_t size) noexcept {
+    auto* header = static_cast<FrameHeader*>(frame) - 1;
+    if (header->arena != nullptr) {
+        return;   // the arena takes it back wholesale
+    }
+    if (header->pooled) {
+        frame_pool().deallocate(header, size + sizeof(FrameHeader));
+        return;
+    }
+    ::operator delete(header);
+}
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    // set by whichever comes second - the awaiter parking itself or the task finishing - to
+    // tell it that the other has already happened
+    std::atomic<bool> handoff{false};
+
+    static void* operator new(size_t size) { return allocate_frame(size, nullptr); }
+
+    template <typename... Args>
+    static void* operator new(size_t size, std::allocator_arg_t, ArenaAllocator& arena, Args&&...) {
+        return allocate_frame(size, &arena);
+    }
+
+    static void operator delete(void* frame, size_t size) noexcept { free_frame(frame, size); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        void await_suspend(std::coroutine_handle<Promise> done) noexcept {
+            PromiseBase& p = done.promise();
+            if (p.handoff.exchange(true, std::memory_order_acq_rel)) {
+                p.continuation.resume();   // the awaiter parked first and is waiting on us
+            }
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+};
+
+// starts `task` on this thread, and suspends `awaiting` only if the task didn't finish inline.
+// resume-then-check instead of symmetric transfer: GCC only makes the transfer a tail call with
+// optimisation on, and a debug build would otherwise grow the stack with every synchronous
+// co_await in a loop.
+template <typename Promise>
+bool start_and_park(std::coroutine_handle<Promise> task, std::coroutine_handle<> awaiting) noexcept {
+    PromiseBase& p = task.promise();
+    p.continuation = awaiting;
+    task.resume();
+    return !p.handoff.exchange(true, std::memory_order_acq_rel);
+}
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::variant<std::monostate, T, std::exception_ptr> result;
+
+    template <typename U>
+        requires std::is_constructible_v<T, U&&>
+    void return_value(U&& value) {
+        result.template emplace<1>(std::forward<U>(value));
+    }
+
+    void unhandled_exception() noexcept { result.template emplace<2>(std::current_exception()); }
+
+    T take() {
+        if (result.index() == 2) std::rethrow_exception(std::get<2>(result));
+        assert(result.index() == 1 && "task result taken before it finished");
+        return std::move(std::get<1>(result));
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    std::exception_ptr error;
+
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+// void results stand in as std::monostate inside when_all's tuple
+template <typename T>
+using non_void_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+} // namespace coro_detail
+
+template <typename T = void>
+class Task
+{
+    static_assert(!std::is_reference_v<T>, "return a pointer or std::reference_wrapper instead");
+
+public:
+    struct promise_type : coro_detail::Promise<T> {
+        Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    };
+
+    using value_type = T;
+
+    Task() noexcept = default;
+
+    Task(Task&& src) noexcept : m_handle(std::exchange(src.m_handle, {})) {}
+
+    Task& operator=(Task&& src) noexcept {
+        if (this != &src) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(src.m_handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    // a task that was never awaited is simply never run
+    ~Task() {
+        if (m_handle) m_handle.destroy();
+    }
+
+    bool valid() const noexcept { return static_cast<bool>(m_handle); }
+    bool done() const noexcept { return m_handle && m_handle.done(); }
+
+    // starts the task; resumes us with its result (or rethrows its exception) once it is done
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> task;
+
+            bool await_ready() const noexcept {
+                assert(task && "awaiting an empty (default constructed or moved from) Task");
+                return task.done();
+            }
+
+            bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                return coro_detail::start_and_park(task, awaiting);
+            }
+
+            T await_resume() { return task.promise().take(); }
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    friend struct coro_detail::Access<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : m_handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+namespace coro_detail {
+
+// the pieces sync_wait and when_all need that co_await doesn't give them: start a task without
+// taking its result, and take the result later
+template <typename T>
+struct Access {
+    // waits for completion without rethrowing - the result stays in the promise
+    struct Completion {
+        std::coroutine_handle<typename Task<T>::promise_type> task;
+
+        bool await_ready() const noexcept { return task.done(); }
+
+        bool await_suspend(std::coroutine_handle<> awaiting) noexcept { return start_and_park(task, awaiting); }
+
+        void await_resume() noexcept {}
+    };
+
+    static Completion completion(Task<T>& task) noexcept { return Completion{task.m_handle}; }
+    static T take(Task<T>& task) { return task.m_handle.promise().take(); }
+};
+
+// a coroutine that is started by hand and, when it finishes, tells `arrive()` - the driver for
+// sync_wait and each when_all child. its frame sits suspended at the end until its owner
+// destroys it.
+struct Starter {
+    struct promise_type {
+        std::coroutine_handle<> (*arrive)(void* context) noexcept = nullptr;
+        void* context = nullptr;
+
+        static void* operator new(size_t size) { return allocate_frame(size, nullptr); }
+        static void operator delete(void* frame, size_t size) noexcept { free_frame(frame, size); }
+
+        Starter get_return_object() noexcept { return Starter{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept {
+                auto& p = self.promise();
+                return p.arrive(p.context);
+            }
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }   // children never throw - Completion doesn't rethrow
+    };
+
+    explicit Starter(std::coroutine_handle<promise_type> h) noexcept : handle(h) {}
+    Starter(Starter&& src) noexcept : handle(std::exchange(src.handle, {})) {}
+    Starter& operator=(Starter&&) = delete;
+    ~Starter() {
+        if (handle) handle.destroy();
+    }
+
+    void start(std::coroutine_handle<> (*arrive)(void*) noexcept, void* context) {
+        handle.promise().arrive = arrive;
+        handle.promise().context = context;
+        handle.resume();
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+Starter run_to_completion(Task<T>& task) {
+    co_await Access<T>::completion(task);
+}
+
+// n children plus the parent itself - the parent's own arrival (after it has started every
+// child) keeps a child that finishes synchronously from resuming a parent that hasn't suspended
+struct WhenAllState {
+    explicit WhenAllState(size_t children) : remaining(children + 1) {}
+
+    std::atomic<size_t> remaining;
+    std::coroutine_handle<> parent;
+
+    static std::coroutine_handle<> child_done(void* context) noexcept {
+        auto& state = *static_cast<WhenAllState*>(context);
+        if (state.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            return state.parent;
+        }
+        return std::noop_coroutine();
+    }
+};
+
+struct WhenAllAwaiter {
+    WhenAllState& state;
+    std::vector<Starter>& children;
+
+    bool await_ready() const noexcept { return children.empty(); }
+
+    bool await_suspend(std::coroutine_handle<> parent) {
+        state.parent = parent;
+        for (Starter& child : children) {
+            child.start(&WhenAllState::child_done, &state);
+        }
+        // false: everything already finished, carry on without suspending
+        return state.remaining.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    void await_resume() noexcept {}
+};
+
+} // namespace coro_detail
+
+// suspends, then resumes on one of pool's workers
+inline auto schedule_on(ThreadPool& pool, JobOptions options = {}) noexcept {
+    struct Awaiter {
+        ThreadPool& pool;
+        JobOptions options;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> self) {
+            pool.submit(options, [self] { self.resume(); });
+        }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{pool, options};
+}
+
+// runs task to completion and returns its result. blocks the calling thread, so call it from
+// outside the pool - a worker blocking here can't run the jobs the task is waiting for.
+template <typename T>
+T sync_wait(Task<T> task) {
+    // notified under the lock: the waiter can't see `done`, return and take the signal off its
+    // stack until the finishing thread is through with it. an atomic flag's notify would run
+    // after the store, possibly on a dead object.
+    struct Signal {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool done = false;
+    } signal;
+    coro_detail::Starter driver = coro_detail::run_to_completion(task);
+    driver.start([](void* context) noexcept -> std::coroutine_handle<> {
+        auto& s = *static_cast<Signal*>(context);
+        std::scoped_lock lock(s.mutex);
+        s.done = true;
+        s.cv.notify_one();
+        return std::noop_coroutine();
+    }, &signal);
+    {
+        std::unique_lock lock(signal.mutex);
+        signal.cv.wait(lock, [&] { return signal.done; });
+    }
+    return coro_detail::Access<T>::take(task);
+}
+
+// awaits every task, each started in turn on the awaiting thread (a task that begins with
+// schedule_on() hands itself to the pool, so they run in parallel); resumes with all the results
+// once the last one finishes, void results as std::monostate. the first exception, in argument
+// order, is rethrown once all of them are done.
+template <typename... Ts>
+Task<std::tuple<coro_detail::non_void_t<Ts>...>> when_all(Task<Ts>... tasks) {
+    std::vector<coro_detail::Starter> children;
+    children.reserve(sizeof...(Ts));
+    (children.push_back(coro_detail::run_to_completion(tasks)), ...);
+
+    coro_detail::WhenAllState state(sizeof...(Ts));
+    co_await coro_detail::WhenAllAwaiter{state, children};
+
+    auto take = [](auto& task) {
+        using T = typename std::remove_reference_t<decltype(task)>::value_type;
+        if constexpr (std::is_void_v<T>) {
+            coro_detail::Access<T>::take(task);
+            return std::monostate{};
+        } else {
+            return coro_detail::Access<T>::take(task);
+        }
+    };
+    co_return std::tuple<coro_detail::non_void_t<Ts>...>{take(tasks)...};
+}
+
+template <typename T>
+Task<std::conditional_t<std::is_void_v<T>, void, std::vector<coro_detail::non_void_t<T>>>> when_all(std::vector<Task<T>> tasks) {
+    std::vector<coro_detail::Starter> children;
+    children.reserve(tasks.size());
+    for (Task<T>& task : tasks) {
+        children.push_back(coro_detail::run_to_completion(task));
+    }
+
+    coro_detail::WhenAllState state(tasks.size());
+    co_await coro_detail::WhenAllAwaiter{state, children};
+
+    if constexpr (std::is_void_v<T>) {
+        for (Task<T>& task : tasks) coro_detail::Access<T>::take(task);
+    } else {
+        std::vector<T> results;
+        results.reserve(tasks.size());
+        for (Task<T>& task : tasks) results.push_back(coro_detail::Access<T>::take(task));
+        co_return results;
+    }
+}
+
+/*
+AsyncLatch - a one-shot countdown that coroutines co_await instead of blocking on.
+
+Waiters push themselves onto a lock-free stack; the count_down that reaches zero swaps the stack
+for a "released" marker and resumes everyone on it - inline, or as jobs on the pool given at
+construction. Awaiting a released latch doesn't suspend at all.
+*/
+class AsyncLatch
+{
+public:
+    explicit AsyncLatch(std::ptrdiff_t count) noexcept : m_count(count) {
+        if (count <= 0) m_waiters.store(released(), std::memory_order_relaxed);
+    }
+
+    AsyncLatch(ThreadPool& pool, std::ptrdiff_t count) noexcept : AsyncLatch(count) { m_pool = &pool; }
+
+    AsyncLatch(const AsyncLatch&) = delete;
+    AsyncLatch& operator=(const AsyncLatch&) = delete;
+
+    void count_down(std::ptrdiff_t n = 1) {
+        std::ptrdiff_t const before = m_count.fetch_sub(n, std::memory_order_acq_rel);
+        assert(before >= n && "latch counted below zero");
+        if (before == n) {
+            release();
+        }
+    }
+
+    bool try_wait() const noexcept { return m_waiters.load(std::memory_order_acquire) == released(); }
+
+    struct Awaiter {
+        AsyncLatch& latch;
+        std::coroutine_handle<> handle;
+        Awaiter* next = nullptr;
+
+        bool await_ready() const noexcept { return latch.try_wait(); }
+
+        bool await_suspend(std::coroutine_handle<> self) noexcept {
+            handle = self;
+            void* head = latch.m_waiters.load(std::memory_order_acquire);
+            do {
+                if (head == latch.released()) return false;   // released while we got here
+                next = static_cast<Awaiter*>(head);
+            } while (!latch.m_waiters.compare_exchange_weak(head, this, std::memory_order_release,
+                                                            std::memory_order_acquire));
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    Awaiter operator co_await() noexcept { return Awaiter{*this, {}}; }
+
+private:
+    // any address that can't be an Awaiter
+    void* released() const noexcept { return const_cast<AsyncLatch*>(this); }
+
+    void release() {
+        void* head = m_waiters.exchange(released(), std::memory_order_acq_rel);
+        for (auto* w = static_cast<Awaiter*>(head); w != nullptr;) {
+            Awaiter* const next = w->next;   // read before resuming - w lives in the waiter's frame
+            resume(w->handle);
+            w = next;
+        }
+    }
+
+    void resume(std::coroutine_handle<> h) {
+        if (m_pool != nullptr) {
+            m_pool->submit([h] { h.resume(); });
+        } else {
+            h.resume();
+        }
+    }
+
+    std::atomic<std::ptrdiff_t> m_count;
+    std::atomic<void*> m_waiters{nullptr};
+    ThreadPool* m_pool = nullptr;
+};
+
+/*
+AsyncBarrier - a reusable rendezvous for a fixed number of coroutines.
+
+co_await barrier.arrive_and_wait() parks the coroutine until all `count` have arrived in the
+current phase. The last to arrive doesn't suspend: it starts the next phase and resumes the rest
+(inline, or as pool jobs) before carrying on itself. Arrivals are rare next to the work between
+them, so a mutex guards the waiter list.
+*/
+class AsyncBarrier
+{
+public:
+    explicit AsyncBarrier(size_t count) : m_count(count) { assert(count > 0); }
+    AsyncBarrier(ThreadPool& pool, size_t count) : AsyncBarrier(count) { m_pool = &pool; }
+
+    AsyncBarrier(const AsyncBarrier&) = delete;
+    AsyncBarrier& operator=(const AsyncBarrier&) = delete;
+
+    auto arrive_and_wait() noexcept {
+        struct Awaiter {
+            AsyncBarrier& barrier;
+
+            bool await_ready() const noexcept { return false; }
+            bool await_suspend(std::coroutine_handle<> self) { return barrier.arrive(self); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // phases completed so far
+    size_t phase() const {
+        std::scoped_lock lock(m_mutex);
+        return m_phase;
+    }
+
+private:
+    // true to suspend - false for the last arrival, which has already released the others
+    bool arrive(std::coroutine_handle<> self) {
+        std::vector<std::coroutine_handle<>> released;
+        {
+            std::scoped_lock lock(m_mutex);
+            if (m_waiting.size() + 1 < m_count) {
+                m_waiting.push_back(self);
+                return true;
+            }
+            released.swap(m_waiting);
+            ++m_phase;
+        }
+        for (std::coroutine_handle<> h : released) {
+            if (m_pool != nullptr) {
+                m_pool->submit([h] { h.resume(); });
+            } else {
+                h.resume();
+            }
+        }
+        return false;
+    }
+
+    size_t const m_count;
+    ThreadPool* m_pool = nullptr;
+    mutable std::mutex m_mutex;
+    std::vector<std::coroutine_handle<>> m_waiting;
+    size_t m_phase = 0;
+};
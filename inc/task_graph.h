@@ -0,0 +1,247 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <arena_allocator.h>
+#include <thread_pool.h>
+
+/*
+TaskGraph - a dependency DAG that is built once and executed on a ThreadPool as often as needed.
+
+    TaskGraph frame;
+    auto a = frame.add([&] { simulate(); });
+    auto b = frame.add([&] { animate(); });
+    auto c = frame.add([&] { cull(); });
+    auto d = frame.add([&] { render(); });
+    frame.precede(a, b);   // b and c after a,
+    frame.precede(a, c);
+    frame.precede(b, d);   // d after both
+    frame.precede(c, d);
+
+    while (running) frame.run(pool);
+
+Nodes, edges and the callables themselves live in an arena owned by the graph, so building costs
+a bump per object and executing costs nothing at all - run() only resets one counter per node.
+Each node counts the predecessors it is still waiting for; a finishing task decrements its
+successors' counters and whoever takes one to zero owns that successor. The first one it frees
+runs right there on the same worker (it usually wants the data just produced), the rest are
+submitted to the pool, so no worker ever blocks waiting for a dependency.
+
+Cycles are not detected - a graph with one never finishes. Don't add tasks or edges while a run
+is in flight.
+*/
+class TaskGraph
+{
+    struct Node;
+
+public:
+    class Task
+    {
+    public:
+        Task() = default;
+        bool valid() const noexcept { return m_node != nullptr; }
+
+    private:
+        friend class TaskGraph;
+        explicit Task(Node* node) : m_node(node) {}
+        Node* m_node = nullptr;
+    };
+
+    static constexpr size_t default_arena_size = 16 * 1024;
+
+    explicit TaskGraph(size_t initial_arena_size = default_arena_size)
+        : m_arena(initial_arena_size, ArenaGrowth{}) {}
+
+    // waits for a run still in flight rather than pulling the nodes out from under it
+    ~TaskGraph() {
+        wait();
+        destroy_callables();
+    }
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    template <typename F>
+    Task add(F&& f) {
+        using Fn = std::decay_t<F>;
+        static_assert(std::is_invocable_v<Fn&>, "tasks take no arguments");
+
+        Node* node = create<Node>();
+        node->callable = new (allocate(sizeof(Fn), alignof(Fn))) Fn(std::forward<F>(f));
+        node->invoke = [](void* fn) { (*static_cast<Fn*>(fn))(); };
+        if constexpr (!std::is_trivially_destructible_v<Fn>) {
+            node->destroy = [](void* fn) { static_cast<Fn*>(fn)->~Fn(); };
+        }
+
+        node->next_node = m_nodes;
+        m_nodes = node;
+        ++m_node_count;
+        return Task(node);
+    }
+
+    // `after` starts only once `before` has finished
+    void precede(Task before, Task after) {
+        assert(before.valid() && after.valid());
+        Edge* edge = create<Edge>();
+        edge->to = after.m_node;
+        edge->next = before.m_node->successors;
+        before.m_node->successors = edge;
+        ++after.m_node->dependencies;
+        ++m_edge_count;
+    }
+
+    // starts the roots on `pool` and returns at once. options apply to every task of the run.
+    void dispatch(ThreadPool& pool, JobOptions options = {}) {
+        assert(m_remaining.load(std::memory_order_acquire) == 0 && "the previous run hasn't finished");
+        if (m_node_count == 0) {
+            return;
+        }
+        // m_remaining can read 0 while the last task of the previous run hasn't set m_settled yet.
+        // resetting it under that task would let its late store mark the new run settled
+        wait_settled();
+        m_pool = &pool;
+        m_options = options;
+        m_settled.store(false, std::memory_order_relaxed);
+        for (Node* n = m_nodes; n != nullptr; n = n->next_node) {
+            n->pending.store(n->dependencies, std::memory_order_relaxed);
+        }
+        // release: the counters above are visible to whichever worker finishes a task
+        m_remaining.store(static_cast<uint32_t>(m_node_count), std::memory_order_release);
+        for (Node* n = m_nodes; n != nullptr; n = n->next_node) {
+            if (n->dependencies == 0) {
+                submit(n);
+            }
+        }
+    }
+
+    // blocks until every task of the current run has finished. doesn't help - from outside the
+    // pool, run() is usually the better choice.
+    void wait() const {
+        while (true) {
+            uint32_t const remaining = m_remaining.load(std::memory_order_acquire);
+            if (remaining == 0) {
+                break;
+            }
+            m_remaining.wait(remaining, std::memory_order_acquire);
+        }
+        // the last task may still be inside notify_all() - don't let the caller destroy the
+        // graph under it
+        wait_settled();
+    }
+
+    // dispatch + pool.wait(): the calling thread runs tasks too, and returns once the pool is
+    // idle - which includes any unrelated jobs submitted to it meanwhile
+    void run(ThreadPool& pool, JobOptions options = {}) {
+        dispatch(pool, options);
+        pool.wait();
+        wait();
+    }
+
+    // drops every task and edge; the arena keeps its largest block for the next build
+    void clear() {
+        assert(m_remaining.load(std::memory_order_acquire) == 0 && "clearing a graph that is still running");
+        wait_settled();
+        destroy_callables();
+        m_arena.reset();
+        m_nodes = nullptr;
+        m_node_count = 0;
+        m_edge_count = 0;
+    }
+
+    size_t task_count() const noexcept { return m_node_count; }
+    size_t edge_count() const noexcept { return m_edge_count; }
+
+    // bytes of arena the graph takes - constant across runs
+    size_t arena_bytes() const noexcept { return m_arena.used(); }
+
+private:
+    struct Edge {
+        Node* to = nullptr;
+        Edge* next = nullptr;
+    };
+
+    struct Node {
+        void (*invoke)(void*) = nullptr;
+        void (*destroy)(void*) = nullptr;   // null for trivially destructible callables
+        void* callable = nullptr;
+        Edge* successors = nullptr;
+        Node* next_node = nullptr;          // every node of the graph, newest first
+        uint32_t dependencies = 0;
+        std::atomic<uint32_t> pending{0};   // predecessors not finished yet in this run
+    };
+
+    void* allocate(size_t size, size_t alignment) {
+        void* p = m_arena.allocate(size, alignment);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    template <typename T>
+    T* create() {
+        return new (allocate(sizeof(T), alignof(T))) T();
+    }
+
+    // a short spin: only the last task's notify_all() stands between m_remaining == 0 and this
+    void wait_settled() const noexcept {
+        while (!m_settled.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void destroy_callables() noexcept {
+        for (Node* n = m_nodes; n != nullptr; n = n->next_node) {
+            if (n->destroy != nullptr) {
+                n->destroy(n->callable);
+            }
+        }
+    }
+
+    // two pointers of capture - well inside the pool's InlineJob, so no allocation per task either
+    void submit(Node* node) {
+        m_pool->submit(m_options, [this, node] { execute(node); });
+    }
+
+    void execute(Node* node) {
+        while (node != nullptr) {
+            node->invoke(node->callable);
+
+            Node* next = nullptr;
+            for (Edge* e = node->successors; e != nullptr; e = e->next) {
+                if (e->to->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next == nullptr) {
+                        next = e->to;   // ours to run - keep it on this worker
+                    } else {
+                        submit(e->to);
+                    }
+                }
+            }
+
+            // after m_settled the waiter may destroy the graph, so it is the last thing we touch
+            if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                m_remaining.notify_all();
+                m_settled.store(true, std::memory_order_release);
+                return;
+            }
+            node = next;
+        }
+    }
+
+    ArenaAllocator m_arena;
+    Node* m_nodes = nullptr;
+    size_t m_node_count = 0;
+    size_t m_edge_count = 0;
+
+    ThreadPool* m_pool = nullptr;
+    JobOptions m_options{};
+    alignas(cache_line_size) mutable std::atomic<uint32_t> m_remaining{0};   // tasks of this run not finished yet
+    std::atomic<bool> m_settled{true};   // the last task of the run is completely done with us
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <arena_allocator.h>
+
+/*
+ThreadArenaCache - thread-local front end over a shared ArenaAllocator.
+
+Each thread carves a large block (64 KiB by default) out of the shared arena and bump-allocates
+inside it with plain loads and stores. The shared arena's CAS is only touched when a thread's
+block runs dry, so ~100 byte allocations hit shared state roughly once every few hundred calls.
+
+Blocks are tracked in a small thread_local table, searched by a per-cache id and evicted least
+recently used first, so any number of caches can coexist (only the ones a thread is actually
+switching between need a slot) and a destroyed cache's stale slots can never be mistaken for a
+new one. A block is only trusted while the arena's generation matches the one it was carved under,
+which is how reset() (ours or the arena's) invalidates every thread's block at once.
+*/
+
+class ThreadArenaCache
+{
+public:
+    static constexpr size_t default_block_size = 64 * 1024;
+
+    ThreadArenaCache(ArenaAllocator& shared, size_t block_size = default_block_size)
+        : m_shared(shared),
+          m_block_size(block_size),
+          m_id(s_next_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+    // caches are identified by id, not address - copying one would alias its thread blocks
+    ThreadArenaCache(const ThreadArenaCache&) = delete;
+    ThreadArenaCache& operator=(const ThreadArenaCache&) = delete;
+
+    void* allocate(size_t object_size, size_t object_alignment) {
+        if (object_alignment == 0 || (object_alignment & (object_alignment - 1)) != 0) {
+            return nullptr;
+        }
+
+        uint64_t const generation = m_shared.generation();
+
+        // fast path - our block, still valid, and the request fits. no atomics written.
+        for (ThreadBlock& block : t_blocks) {
+            if (block.owner != m_id) {
+                continue;
+            }
+            block.last_used = ++t_clock;
+            if (block.generation == generation) {
+                uintptr_t aligned_addr = (block.cursor + object_alignment - 1) & ~(object_alignment - 1);
+                if (aligned_addr <= block.end && object_size <= block.end - aligned_addr) {
+                    block.cursor = aligned_addr + object_size;
+                    return reinterpret_cast<std::byte*>(aligned_addr);
+                }
+            }
+            return refill(block, generation, object_size, object_alignment);
+        }
+
+        return refill(least_recently_used(), generation, object_size, object_alignment);
+    }
+
+    // rewinds the shared arena, which invalidates every thread's block via the generation bump.
+    // same rules as ArenaAllocator::reset - no thread may be allocating while this runs.
+    void reset() { m_shared.reset(); }
+
+    size_t block_size() const noexcept { return m_block_size; }
+    ArenaAllocator& shared() noexcept { return m_shared; }
+
+private:
+    struct ThreadBlock {
+        uint64_t owner = 0;      // id of the cache this block belongs to, 0 = empty
+        uint64_t generation = 0; // arena generation the block was carved under
+        uintptr_t cursor = 0;
+        uintptr_t end = 0;
+        uint64_t last_used = 0;  // t_clock at this block's last use, 0 = never
+    };
+
+    // a thread rarely talks to more than a couple of caches at once. ids only grow, so they are
+    // searched for rather than mapped onto a slot - two live caches never fight over one.
+    static constexpr size_t thread_slots = 4;
+    // blocks are cache line aligned so neighbouring threads never false-share a block edge
+    static constexpr size_t block_alignment = cache_line_size;
+
+    // an empty slot if there is one (last_used 0), else the block this thread went longest without
+    static ThreadBlock& least_recently_used() noexcept {
+        ThreadBlock* oldest = &t_blocks[0];
+        for (ThreadBlock& block : t_blocks) {
+            if (block.last_used < oldest->last_used) {
+                oldest = &block;
+            }
+        }
+        return *oldest;
+    }
+
+    void* refill(ThreadBlock& block, uint64_t generation, size_t object_size, size_t object_alignment) {
+        // big requests would throw away most of a fresh block (and the rest of the current one),
+        // so they skip the cache and go straight to the shared arena
+        if (object_size > m_block_size / 4 || object_alignment > block_alignment) {
+            return m_shared.allocate(object_size, object_alignment);
+        }
+
+        void* fresh = m_shared.allocate(m_block_size, block_alignment);
+        if (fresh == nullptr) {
+            // not enough room for a whole block - the arena tail may still fit this one object
+            return m_shared.allocate(object_size, object_alignment);
+        }
+
+        block.owner = m_id;
+        block.generation = generation;
+        block.last_used = ++t_clock;
+        block.cursor = reinterpret_cast<uintptr_t>(fresh);
+        block.end = block.cursor + m_block_size;
+
+        // fresh blocks are block_alignment aligned and the request is far smaller, so this fits
+        uintptr_t aligned_addr = (block.cursor + object_alignment - 1) & ~(object_alignment - 1);
+        block.cursor = aligned_addr + object_size;
+        return reinterpret_cast<std::byte*>(aligned_addr);
+    }
+
+    ArenaAllocator& m_shared;
+    size_t const m_block_size;
+    uint64_t const m_id;
+
+    static inline std::atomic<uint64_t> s_next_id{1};
+    static thread_local ThreadBlock t_blocks[thread_slots];
+    static inline thread_local uint64_t t_clock = 0;
+};
+
+// defined out of line - ThreadBlock's member initializers aren't usable until the class is complete
+inline thread_local ThreadArenaCache::ThreadBlock ThreadArenaCache::t_blocks[ThreadArenaCache::thread_slots];
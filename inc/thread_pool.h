@@ -0,0 +1,377 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include <cache_line.h>
+#include <inline_job.h>
+#include <job_queue.h>
+#include <job_trace.h>
+#include <numa_arena.h>
+#include <pool_allocator.h>
+#include <unique_buffer.h>
+
+/*
+ThreadPool - persistent workers for short parallel regions.
+
+Spawning and joining hardware_concurrency() threads per region costs tens of microseconds before
+any work happens; here the workers live as long as the pool. Each worker owns a Chase-Lev
+WorkStealingDeque of job pointers. Jobs are InlineJobs - captures stored inline, one cache line
+each - in blocks from a thread-safe PoolAllocator, so once the pool's slabs and queues have warmed
+up a submit doesn't touch malloc:
+
+  submit()  from a worker pushes onto the bottom of that worker's own deque - no atomic RMWs,
+            and it is the next thing that worker runs. from anywhere else it goes through the
+            shared injection queue, which grows instead of filling up. if the worker's own deque
+            is full the job just runs inline.
+  workers   pop their own deque (LIFO, cache-hot), then steal the oldest half of a randomly
+            chosen victim's jobs, then take from the injection queue. after a short spin with nothing
+            found they park on an epoch counter (std::atomic::wait, a futex on Linux) until the
+            next submit bumps it.
+  wait()    blocks until every job submitted so far has finished, helping to run jobs instead of
+            sleeping while there are any. the count includes the calling job itself, so wait()
+            must be called from outside the pool.
+
+Jobs carry JobOptions:
+
+  priority  one of three lanes - high, normal, background. every queue above exists once per lane
+            and workers always look through the high lane everywhere before touching normal work,
+            so a latency-critical job waits for at most the jobs already running, never for a
+            backlog of bulk work. nothing is preempted.
+  worker    run on this worker only. goes into the worker's mailbox, which thieves and helping
+            threads never touch.
+  numa_node run on a worker whose thread is on this node. goes into a per-node queue that workers
+            on the node take from like the injection queue; workers elsewhere only take from it
+            when they have found nothing at all, so a node without workers can't strand its jobs.
+
+The injection queue is a GrowableJobQueue (chained MPMC rings), so nothing on the submit or run
+path takes a lock except the rare doubling, and a burst of outside submissions queues up instead
+of running on the submitting thread.
+
+Jobs must not throw: an exception leaving a job calls std::terminate, whichever thread runs it.
+Work that can fail catches inside the job and hands the error back itself - fork_join (parallel.h)
+keeps the first exception_ptr and rethrows it on the caller, and Task<T> (task.h) rethrows at the
+co_await.
+
+Built with CPP_REFRESH_JOB_TRACE, trace() records jobs, steals and parking per worker and dumps
+them as a Chrome / Perfetto trace (job_trace.h); otherwise it is an empty NoJobTrace.
+*/
+
+enum class JobPriority { high, normal, background };
+
+// out of range worker / node values are ignored and the job is scheduled like any other
+struct JobOptions {
+    static constexpr size_t any_worker = SIZE_MAX;
+
+    JobPriority priority = JobPriority::normal;
+    size_t worker = any_worker;   // run on this worker index only
+    int numa_node = -1;           // run on a worker on this node, -1: anywhere
+};
+
+class ThreadPool
+{
+public:
+    using Job = InlineJob<>;
+
+    static constexpr size_t default_queue_capacity = 1024;
+    static constexpr size_t lane_count = 3;   // one per JobPriority
+
+    explicit ThreadPool(size_t worker_count = std::max(1u, std::thread::hardware_concurrency()),
+                        size_t queue_capacity = default_queue_capacity)
+        : m_worker_count(std::max<size_t>(worker_count, 1)),
+          m_workers(m_worker_count),
+          m_jobs(PoolOptions{ .thread_safe = true }),
+          m_node_count(numa::node_count()),
+          m_nodes(m_node_count),
+          m_trace(m_worker_count) {
+        for (size_t lane = 0; lane < lane_count; ++lane) {
+            m_injected[lane] = std::make_unique<GrowableJobQueue<Job*>>(queue_capacity);
+            for (size_t n = 0; n < m_node_count; ++n) {
+                m_nodes[n].lanes[lane] = std::make_unique<GrowableJobQueue<Job*>>(affinity_capacity);
+            }
+        }
+        for (size_t i = 0; i < m_worker_count; ++i) {
+            for (size_t lane = 0; lane < lane_count; ++lane) {
+                m_workers[i].deques[lane] = std::make_unique<WorkStealingDeque<Job*>>(queue_capacity);
+                m_workers[i].mailbox[lane] = std::make_unique<GrowableJobQueue<Job*>>(affinity_capacity);
+            }
+            m_workers[i].rng = 0x9e3779b97f4a7c15ull * (i + 1);
+        }
+        for (size_t i = 0; i < m_worker_count; ++i) {
+            m_workers[i].thread = std::thread([this, i] { run(i); });
+        }
+    }
+
+    // finishes everything already submitted, then stops the workers
+    ~ThreadPool() {
+        wait();
+        m_stopping.store(true, std::memory_order_seq_cst);
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        m_epoch.notify_all();
+        for (size_t i = 0; i < m_worker_count; ++i) {
+            m_workers[i].thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    void submit(F&& f) {
+        submit(JobOptions{}, std::forward<F>(f));
+    }
+
+    template <typename F>
+    void submit(JobOptions options, F&& f) {
+        // count the job only once it exists - a throwing copy of `f` or a failed slab mustn't
+        // leave wait() waiting for it
+        Job* job = m_jobs.create(std::forward<F>(f));
+        if (job == nullptr) {
+            throw std::bad_alloc();
+        }
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        size_t const lane = static_cast<size_t>(options.priority);
+
+        if (options.worker < m_worker_count) {
+            m_workers[options.worker].mailbox[lane]->push(job);
+            wake_all(); // only that one worker may take it, and we can't pick which sleeper wakes
+            return;
+        }
+        if (options.numa_node >= 0 && static_cast<size_t>(options.numa_node) < m_node_count) {
+            m_nodes[static_cast<size_t>(options.numa_node)].lanes[lane]->push(job);
+            wake_all();
+            return;
+        }
+
+        bool const queued = t_pool == this ? m_workers[t_worker].deques[lane]->push(job) : inject(lane, job);
+        if (!queued) {
+            run_job(t_pool == this ? t_worker : no_worker, job); // queue full - doing it ourselves beats waiting for room
+            return;
+        }
+        wake_one();
+    }
+
+    // returns once every job submitted before (and during) the call has run
+    void wait() {
+        assert(t_pool != this && "wait() from inside a job would wait for itself");
+        while (true) {
+            uint32_t const pending = m_pending.load(std::memory_order_acquire);
+            if (pending == 0) {
+                return;
+            }
+            if (!run_one(no_worker)) {
+                // whatever is left is running on other threads right now
+                m_pending.wait(pending, std::memory_order_acquire);
+            }
+        }
+    }
+
+    // runs jobs until done() returns true. unlike wait() this works from inside a job too, so a
+    // job can fork work and join it without parking its worker - the building block for
+    // parallel.h. done() is polled between jobs and should be cheap.
+    template <typename Done>
+    void wait_until(Done&& done) {
+        size_t const self = t_pool == this ? t_worker : no_worker;
+        while (!done()) {
+            if (!run_one(self)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    size_t worker_count() const noexcept { return m_worker_count; }
+
+    // index of the calling worker in this pool, or worker_count() for other threads
+    size_t current_worker() const noexcept { return t_pool == this ? t_worker : m_worker_count; }
+
+    // per-worker event rings and counters when built with CPP_REFRESH_JOB_TRACE
+    const PoolTrace& trace() const noexcept { return m_trace; }
+
+private:
+    struct alignas(cache_line_size) Worker {
+        // behind pointers so the hot top/bottom lines aren't shared with the thread handle
+        std::unique_ptr<WorkStealingDeque<Job*>> deques[lane_count];
+        std::unique_ptr<GrowableJobQueue<Job*>> mailbox[lane_count];   // jobs pinned to this worker
+        std::thread thread;
+        uint64_t rng = 0;
+    };
+
+    struct NodeQueues {
+        std::unique_ptr<GrowableJobQueue<Job*>> lanes[lane_count];
+    };
+
+    static constexpr int spins_before_parking = 64;
+    static constexpr size_t max_steal = 32;
+    static constexpr size_t no_worker = SIZE_MAX;
+    static constexpr size_t affinity_capacity = 64;
+
+    bool inject(size_t lane, Job* job) { return m_injected[lane]->push(job); }
+
+    // lane by lane, highest first. `self` is no_worker for threads helping out in wait().
+    bool run_one(size_t self) {
+        Job* job = nullptr;
+        for (size_t lane = 0; lane < lane_count; ++lane) {
+            if (take(self, lane, job)) {
+                run_job(self, job);
+                return true;
+            }
+        }
+        // nothing anywhere we'd normally look - rescue jobs left for a node with no idle workers
+        if (self != no_worker && take_foreign_node(job)) {
+            run_job(self, job);
+            return true;
+        }
+        return false;
+    }
+
+    // own mailbox, own deque and own node first, then victims starting at a random one, then
+    // the injection queue
+    bool take(size_t self, size_t lane, Job*& job) {
+        if (self != no_worker) {
+            Worker& me = m_workers[self];
+            if (me.mailbox[lane]->pop(job) || me.deques[lane]->pop(job) || m_nodes[local_node()].lanes[lane]->pop(job)) {
+                return true;
+            }
+        }
+
+        // workers take half of what a victim has so the next few jobs are local again; helpers
+        // have no deque of their own and take one at a time. mailboxes are never stolen from.
+        size_t const start = static_cast<size_t>(next_random(self) % m_worker_count);
+        size_t attempts = 0;
+        for (size_t i = 0; i < m_worker_count; ++i) {
+            size_t const victim = (start + i) % m_worker_count;
+            if (victim == self) {
+                continue;
+            }
+            ++attempts;
+            WorkStealingDeque<Job*>& deque = *m_workers[victim].deques[lane];
+            size_t const taken = self == no_worker
+                ? (deque.steal(job) ? 1 : 0)
+                : deque.steal_half(*m_workers[self].deques[lane], job, max_steal);
+            if (taken != 0) {
+                m_trace.on_steal(trace_track(self), victim, attempts, taken);
+                return true;
+            }
+        }
+        if (attempts != 0) {
+            m_trace.on_steal_failed(trace_track(self), attempts);
+        }
+
+        return m_injected[lane]->pop(job);
+    }
+
+    bool take_foreign_node(Job*& job) {
+        size_t const local = local_node();
+        for (size_t lane = 0; lane < lane_count; ++lane) {
+            for (size_t n = 0; n < m_node_count; ++n) {
+                if (n != local && m_nodes[n].lanes[lane]->pop(job)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    size_t local_node() const noexcept { return std::min(numa::cached_current_node(), m_node_count - 1); }
+
+    // the trace keeps one track per worker and a last one for everybody else
+    size_t trace_track(size_t self) const noexcept { return self == no_worker ? m_worker_count : self; }
+
+    // noexcept is the contract in code: a job that throws ends the program right here, the same
+    // way on a worker, a helping thread or a submitter running it inline - rather than escaping
+    // a worker's thread function or skipping the bookkeeping below and hanging wait()
+    void run_job(size_t self, Job* job) noexcept {
+        if constexpr (PoolTrace::enabled) {
+            size_t depth = 0;
+            if (self != no_worker) {
+                for (size_t lane = 0; lane < lane_count; ++lane) depth += m_workers[self].deques[lane]->size();
+            }
+            m_trace.on_job_begin(trace_track(self), depth);
+        }
+        (*job)();
+        m_trace.on_job_end(trace_track(self));
+        m_jobs.destroy(job);
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            m_pending.notify_all();
+        }
+    }
+
+    void run(size_t self) {
+        t_pool = this;
+        t_worker = self;
+
+        while (true) {
+            uint32_t const epoch = m_epoch.load(std::memory_order_seq_cst);
+
+            bool found = false;
+            for (int spin = 0; spin < spins_before_parking && !found; ++spin) {
+                found = run_one(self);
+            }
+            if (found) {
+                continue;
+            }
+            if (m_stopping.load(std::memory_order_seq_cst)) {
+                return;
+            }
+
+            // a submit after our epoch read bumps the epoch, so this wait returns at once
+            // instead of sleeping through it
+            m_trace.on_park(self);
+            m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+            m_epoch.wait(epoch, std::memory_order_seq_cst);
+            m_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+            m_trace.on_unpark(self);
+        }
+    }
+
+    void wake_one() {
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_seq_cst) != 0) {
+            m_epoch.notify_one();
+        }
+    }
+
+    void wake_all() {
+        m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_seq_cst) != 0) {
+            m_epoch.notify_all();
+        }
+    }
+
+    // xorshift, per worker - victims only need to be spread out, not unpredictable
+    uint64_t next_random(size_t self) noexcept {
+        if (self == no_worker) {
+            return m_helper_start.fetch_add(1, std::memory_order_relaxed);
+        }
+        uint64_t& x = m_workers[self].rng;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        return x;
+    }
+
+    size_t const m_worker_count;
+    UniqueBuffer<Worker> m_workers;
+    PoolAllocator<Job> m_jobs;
+
+    std::unique_ptr<GrowableJobQueue<Job*>> m_injected[lane_count]; // submissions from outside the pool
+    size_t const m_node_count;
+    UniqueBuffer<NodeQueues> m_nodes;                          // numa_node jobs, by node
+    PoolTrace m_trace;
+
+    alignas(cache_line_size) std::atomic<uint32_t> m_pending{0}; // submitted but not finished
+    alignas(cache_line_size) std::atomic<uint32_t> m_epoch{0};   // bumped on every submit, parked workers wait on it
+    std::atomic<uint32_t> m_sleepers{0};
+    std::atomic<bool> m_stopping{false};
+    alignas(cache_line_size) std::atomic<size_t> m_helper_start{0}; // spreads helping threads over victims
+
+    static inline thread_local ThreadPool* t_pool = nullptr;
+    static inline thread_local size_t t_worker = 0;
+};
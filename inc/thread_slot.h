@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/*
+Dense, recycled ids for live threads.
+
+Per-thread state that belongs to an object (a pool's magazines, for instance) is easiest to keep
+as a small array inside that object indexed by a thread slot: no thread_local lookups keyed by
+object, nothing dangling when the object dies first, and whatever a dead thread left behind is
+simply picked up by the next thread handed the same slot.
+
+Slots are claimed lazily on a thread's first call and returned when it exits. Past
+max_thread_slots live threads, this_thread_slot() returns no_thread_slot and callers take their
+shared fallback path.
+*/
+
+inline constexpr size_t max_thread_slots = 128;
+inline constexpr size_t no_thread_slot = max_thread_slots;
+
+namespace thread_slot_detail {
+
+inline constexpr size_t words = max_thread_slots / 64;
+inline std::atomic<uint64_t> in_use[words];
+
+struct Holder {
+    size_t slot = no_thread_slot;
+
+    Holder() {
+        for (size_t w = 0; w < words && slot == no_thread_slot; ++w) {
+            uint64_t bits = in_use[w].load(std::memory_order_relaxed);
+            while (~bits != 0) {
+                uint64_t const lowest_free = ~bits & (bits + 1);
+                if (in_use[w].compare_exchange_weak(bits, bits | lowest_free, std::memory_order_acquire)) {
+                    slot = w * 64 + static_cast<size_t>(std::countr_zero(lowest_free));
+                    break;
+                }
+            }
+        }
+    }
+
+    ~Holder() {
+        if (slot != no_thread_slot) {
+            // release so the next owner of this slot sees everything we wrote into slot state
+            in_use[slot / 64].fetch_and(~(uint64_t(1) << (slot % 64)), std::memory_order_release);
+        }
+    }
+};
+
+} // namespace thread_slot_detail
+
+inline size_t this_thread_slot() noexcept {
+    static thread_local thread_slot_detail::Holder holder;
+    return holder.slot;
+}
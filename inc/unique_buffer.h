@@ -1,12 +1,22 @@
-#pragma once 
+#pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 // Drill 1 - Unique Buffer
 // 	Modern C++ primitives — write UniqueBuffer<T> (move-only), unit-test copy elision & rule of 5
 
-/* 
+/*
 Spec: UniqueBuffer wraps a raw buffer + size; no copies, movable.
 
 Tests: construction, move ctor leaves source null, destructor frees once.
@@ -16,48 +26,242 @@ Refactor: add reserve, resize, overload operator[].
 Why: shows RAII, move semantics, and memory hygiene in one go.
 */
 
-template <typename T>
+/*
+Allocation policies. A policy only deals in raw bytes - UniqueBuffer constructs and destroys the
+elements itself - and says whether fresh elements must be value-initialized (zeroed, like
+make_unique<T[]>) or may be left as whatever the memory holds (make_unique_for_overwrite).
+Policies may carry state; each buffer keeps its own copy.
+
+    void* allocate(size_t bytes, size_t alignment);                 // throws std::bad_alloc
+    void deallocate(void* p, size_t bytes, size_t alignment) noexcept;
+    static constexpr bool value_initialize;
+
+and optionally, for growing trivially copyable buffers without a copy:
+
+    // new block holding the old contents, or nullptr if it can't (p is then left untouched)
+    void* reallocate(void* p, size_t old_bytes, size_t new_bytes, size_t alignment) noexcept;
+
+See page_alloc.h for mmap / huge page backed storage.
+*/
+
+// the default - elements value-initialized just like make_unique<T[]>(n). ordinary alignments go
+// through malloc so a growing buffer can use realloc, which extends in place whenever the
+// neighbouring memory is free. over-aligned requests use aligned operator new and can't.
+struct HeapAlloc {
+    static constexpr bool value_initialize = true;
+
+    static constexpr bool malloc_aligned(size_t alignment) noexcept {
+        return alignment <= alignof(std::max_align_t);
+    }
+
+    void* allocate(size_t bytes, size_t alignment) {
+        if (malloc_aligned(alignment)) {
+            void* p = std::malloc(bytes);
+            if (p == nullptr) throw std::bad_alloc();
+            return p;
+        }
+        return ::operator new(bytes, std::align_val_t(alignment));
+    }
+
+    void deallocate(void* p, size_t, size_t alignment) noexcept {
+        if (malloc_aligned(alignment)) {
+            std::free(p);
+            return;
+        }
+        ::operator delete(p, std::align_val_t(alignment));
+    }
+
+    void* reallocate(void* p, size_t, size_t new_bytes, size_t alignment) noexcept {
+        return malloc_aligned(alignment) ? std::realloc(p, new_bytes) : nullptr;
+    }
+};
+
+// same heap, but trivial elements are left uninitialized - for buffers that are about to be
+// overwritten anyway, so we don't pay a zeroing pass (and the page faults it triggers) up front
+struct UninitializedAlloc : HeapAlloc {
+    static constexpr bool value_initialize = false;
+};
+
+// Align raises the alignment of data() above alignof(T) - e.g. 64 so SIMD kernels can use aligned
+// loads and the first element starts a cache line. AlignedBuffer<T, 64> below spells it shorter.
+template <typename T, typename Alloc = HeapAlloc, size_t Align = alignof(T)>
 class UniqueBuffer {
+    static_assert(Align != 0 && (Align & (Align - 1)) == 0, "alignment must be a power of 2");
+
     public:
-        UniqueBuffer<T>() : m_size(0), m_buffer(nullptr) {}
+        // guaranteed alignment of data(); kernels can hand it to std::assume_aligned
+        static constexpr size_t alignment = std::max(Align, alignof(T));
 
-        UniqueBuffer<T>(size_t size): m_size(size), m_buffer(std::make_unique<T[]>(size)) { }
-        
-        UniqueBuffer<T>(UniqueBuffer<T>&& src) noexcept 
+        UniqueBuffer() : m_size(0), m_capacity(0), m_buffer(nullptr) {}
+
+        UniqueBuffer(size_t size, Alloc alloc = Alloc())
+            : m_size(0), m_capacity(0), m_buffer(nullptr), m_alloc(std::move(alloc)) {
+            grow_to(size);
+            try {
+                construct_tail(size, Alloc::value_initialize);
+            } catch (...) {
+                release();
+                throw;
+            }
+        }
+
+        // make_unique_for_overwrite: trivial elements are left uninitialized whatever the policy
+        // says - for staging buffers that get filled right after they are allocated
+        static UniqueBuffer uninitialized(size_t size, Alloc alloc = Alloc()) {
+            UniqueBuffer buffer(0, std::move(alloc));
+            buffer.grow_to(size);
+            buffer.construct_tail(size, false);
+            return buffer;
+        }
+
+        UniqueBuffer(UniqueBuffer&& src) noexcept
             : m_size(std::exchange(src.m_size, 0)),
-              m_buffer(std::move(src.m_buffer)) {}
+              m_capacity(std::exchange(src.m_capacity, 0)),
+              m_buffer(std::exchange(src.m_buffer, nullptr)),
+              m_alloc(std::move(src.m_alloc)) {}
 
-        UniqueBuffer<T>& operator=(UniqueBuffer<T>&& src) noexcept {
+        UniqueBuffer& operator=(UniqueBuffer&& src) noexcept {
             if (this != &src) {
-                m_buffer = std::move(src.m_buffer);            
-                m_size = src.m_size;
-                src.m_buffer = nullptr;
-                src.m_size = 0;
+                release();
+                m_buffer = std::exchange(src.m_buffer, nullptr);
+                m_size = std::exchange(src.m_size, 0);
+                m_capacity = std::exchange(src.m_capacity, 0);
+                m_alloc = std::move(src.m_alloc);
             }
             return *this;
         }
 
-        T& operator[](size_t i) {
+        ~UniqueBuffer() { release(); }
+
+        // unchecked in release builds so loops over the buffer can vectorize - use at() when
+        // the index comes from outside
+        T& operator[](size_t i) noexcept {
+            assert(i < m_size && "index out of range for buffer");
+            return m_buffer[i];
+        }
+
+        const T& operator[](size_t i) const noexcept {
+            assert(i < m_size && "index out of range for buffer");
+            return m_buffer[i];
+        }
+
+        T& at(size_t i) {
             if (i >= m_size) throw std::out_of_range("index out of range for buffer");
             return m_buffer[i];
         }
 
-        const T& operator[](size_t i) const {
+        const T& at(size_t i) const {
             if (i >= m_size) throw std::out_of_range("index out of range for buffer");
-            return m_buffer.get()[i];
+            return m_buffer[i];
+        }
+
+        // make room for `capacity` elements without constructing any. elements that don't move
+        // (atomics, mutexes) can only be sized at construction.
+        void reserve(size_t capacity) requires std::is_move_constructible_v<T> {
+            if (capacity > m_capacity) grow_to(capacity);
+        }
+
+        // new elements are initialized the way the constructor would (per the policy),
+        // shrinking destroys the tail but keeps the storage
+        void resize(size_t size) requires std::is_move_constructible_v<T> {
+            if (size < m_size) {
+                std::destroy(m_buffer + size, m_buffer + m_size);
+                m_size = size;
+                return;
+            }
+            reserve(size);
+            construct_tail(size, Alloc::value_initialize);
         }
 
         // prevent copies
-        UniqueBuffer<T> operator=(const UniqueBuffer<T>& copy) = delete;
-        UniqueBuffer<T>(const UniqueBuffer<T>& copy) = delete;
+        UniqueBuffer& operator=(const UniqueBuffer& copy) = delete;
+        UniqueBuffer(const UniqueBuffer& copy) = delete;
 
     private:
-        size_t m_size;
-        std::unique_ptr<T[]> m_buffer;
+        size_t m_size;      // constructed elements
+        size_t m_capacity;  // allocated elements
+        T* m_buffer;
+        [[no_unique_address]] Alloc m_alloc;
+
+        static constexpr bool can_reallocate = std::is_trivially_copyable_v<T> &&
+            requires(Alloc& a, void* p, size_t n) { { a.reallocate(p, n, n, n) } -> std::same_as<void*>; };
+
+        // constructs elements [m_size, size), which must already be allocated
+        void construct_tail(size_t size, bool value_initialize) {
+            if (size <= m_size) return;
+            if (value_initialize) {
+                std::uninitialized_value_construct(m_buffer + m_size, m_buffer + size);
+            } else {
+                std::uninitialized_default_construct(m_buffer + m_size, m_buffer + size);
+            }
+            m_size = size;
+        }
+
+        void grow_to(size_t capacity) {
+            if (capacity == 0) return;
+            if (capacity > SIZE_MAX / sizeof(T)) throw std::bad_array_new_length();
+
+            if constexpr (can_reallocate) {
+                // trivially copyable elements can be moved by the allocator itself (realloc,
+                // mremap), which often means not moving them at all
+                if (m_buffer != nullptr) {
+                    void* grown = m_alloc.reallocate(m_buffer, m_capacity * sizeof(T), capacity * sizeof(T), alignment);
+                    if (grown != nullptr) {
+                        m_buffer = static_cast<T*>(grown);
+                        m_capacity = capacity;
+                        return;
+                    }
+                }
+            }
+
+            T* buffer = static_cast<T*>(m_alloc.allocate(capacity * sizeof(T), alignment));
+            if constexpr (std::is_move_constructible_v<T>) {
+                if (m_buffer != nullptr) {
+                    relocate_into(buffer, capacity);
+                }
+            }
+            m_buffer = buffer;
+            m_capacity = capacity;
+        }
+
+        // moves the live elements into `buffer` and frees the old storage
+        void relocate_into(T* buffer, size_t capacity) {
+            if constexpr (std::is_trivially_copyable_v<T>) {
+                std::memcpy(static_cast<void*>(buffer), m_buffer, m_size * sizeof(T));
+            } else {
+                try {
+                    if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+                        std::uninitialized_move_n(m_buffer, m_size, buffer);
+                    } else {
+                        std::uninitialized_copy_n(m_buffer, m_size, buffer);
+                    }
+                } catch (...) {
+                    m_alloc.deallocate(buffer, capacity * sizeof(T), alignment);
+                    throw;
+                }
+                std::destroy_n(m_buffer, m_size);
+            }
+            m_alloc.deallocate(m_buffer, m_capacity * sizeof(T), alignment);
+        }
+
+        void release() noexcept {
+            if (m_buffer != nullptr) {
+                std::destroy_n(m_buffer, m_size);
+                m_alloc.deallocate(m_buffer, m_capacity * sizeof(T), alignment);
+                m_buffer = nullptr;
+                m_size = 0;
+                m_capacity = 0;
+            }
+        }
 
     public:
         size_t size() noexcept { return m_size; }
         const size_t size() const noexcept { return m_size; }
-        T* data() noexcept { return m_buffer.get(); }
-        const T* data() const noexcept { return m_buffer.get(); }
-};
\ No newline at end of file
+        size_t capacity() const noexcept { return m_capacity; }
+        T* data() noexcept { return m_buffer; }
+        const T* data() const noexcept { return m_buffer; }
+        const Alloc& allocator() const noexcept { return m_alloc; }
+};
+
+template <typename T, size_t Align, typename Alloc = HeapAlloc>
+using AlignedBuffer = UniqueBuffer<T, Alloc, Align>;
@@ -1,7 +1,13 @@
 #include <catch2/catch_test_macros.hpp>
 #include <cstddef> // For std::byte, size_t
 #include <cstdint> // For uintptr_t
+#include <cstring>
 #include <vector>  // For testing allocations of multiple objects
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <type_traits>
 
 #include <arena_allocator.h>
 
@@ -260,6 +266,403 @@ TEST_CASE("ArenaAllocator: Edge Cases", "[arena_allocator]") {
     }
 }
 
+TEST_CASE("ArenaAllocator: Non power of two alignment is rejected", "[arena_allocator]") {
+    ArenaAllocator arena(128);
+    REQUIRE(arena.allocate(8, 3) == nullptr);
+    REQUIRE(arena.allocate(8, 12) == nullptr);
+
+    // a rejected request must not consume any space
+    void* p = arena.allocate(128, 1);
+    REQUIRE(p != nullptr);
+}
+
+TEST_CASE("ArenaAllocator: Huge request fails without wrapping", "[arena_allocator]") {
+    ArenaAllocator arena(64);
+    REQUIRE(arena.allocate(SIZE_MAX - 8, 1) == nullptr);
+    REQUIRE(arena.allocate(SIZE_MAX, 16) == nullptr);
+    REQUIRE(arena.allocate(64, 1) != nullptr);
+}
+
+TEST_CASE("ArenaAllocator: Concurrent allocations hand out every byte exactly once", "[arena_allocator][thread]") {
+    constexpr size_t CHUNK = 16;
+    constexpr size_t CHUNKS = 4096;
+    ArenaAllocator arena(CHUNK * CHUNKS);
+
+    const unsigned P = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::vector<std::byte*>> per_thread(P);
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < P; ++t) {
+        threads.emplace_back([&, t] {
+            while (!go.load(std::memory_order_acquire)) /* spin */;
+            while (void* p = arena.allocate(CHUNK, CHUNK)) {
+                per_thread[t].push_back(static_cast<std::byte*>(p));
+            }
+        });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& th : threads) th.join();
+
+    std::vector<std::byte*> all;
+    for (auto& v : per_thread) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+
+    REQUIRE(all.size() == CHUNKS);
+    for (size_t i = 0; i < all.size(); ++i) {
+        REQUIRE(is_aligned(all[i], CHUNK));
+        if (i > 0) REQUIRE(all[i] - all[i - 1] == CHUNK);
+    }
+}
+
+TEST_CASE("ArenaAllocator: Concurrent mixed alignments never overlap", "[arena_allocator][thread]") {
+    ArenaAllocator arena(64 * 1024);
+
+    const unsigned P = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::vector<std::pair<std::byte*, size_t>>> per_thread(P);
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < P; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t n = 0; ; ++n) {
+                size_t size = 1 + (n * 7 + t) % 24;
+                size_t align = size_t(1) << ((n + t) % 6); // 1..32
+                void* p = arena.allocate(size, align);
+                if (p == nullptr) break;
+                REQUIRE(is_aligned(p, align));
+                per_thread[t].push_back({ static_cast<std::byte*>(p), size });
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    std::vector<std::pair<std::byte*, size_t>> all;
+    for (auto& v : per_thread) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    for (size_t i = 1; i < all.size(); ++i) {
+        REQUIRE(all[i - 1].first + all[i - 1].second <= all[i].first);
+    }
+}
+
+TEST_CASE("ArenaAllocator: Chained arena grows instead of failing", "[arena_allocator][chained]") {
+    ArenaAllocator arena(256, ArenaGrowth{});
+    REQUIRE(arena.chained());
+
+    std::vector<std::byte*> ptrs;
+    for (int i = 0; i < 100; ++i) {
+        std::byte* p = static_cast<std::byte*>(arena.allocate(32, 8));
+        REQUIRE(p != nullptr);
+        REQUIRE(is_aligned(p, 8));
+        ptrs.push_back(p);
+    }
+
+    // 3200 bytes through a 256 byte first block: 256 + 512 + 1024 + 2048
+    REQUIRE(arena.block_count() == 4);
+    REQUIRE(arena.capacity() == 256 + 512 + 1024 + 2048);
+
+    std::sort(ptrs.begin(), ptrs.end());
+    for (size_t i = 1; i < ptrs.size(); ++i) {
+        REQUIRE(ptrs[i] >= ptrs[i - 1] + 32);
+    }
+}
+
+TEST_CASE("ArenaAllocator: Chained reset keeps the largest block", "[arena_allocator][chained]") {
+    ArenaAllocator arena(256, ArenaGrowth{});
+    for (int i = 0; i < 100; ++i) REQUIRE(arena.allocate(32, 8) != nullptr);
+    REQUIRE(arena.block_count() == 4);
+
+    arena.reset();
+    REQUIRE(arena.block_count() == 1);
+    REQUIRE(arena.capacity() == 2048);
+
+    // the retained block now serves the whole first 2 KiB without growing
+    std::byte* first = static_cast<std::byte*>(arena.allocate(32, 8));
+    for (int i = 1; i < 2048 / 32; ++i) {
+        REQUIRE(arena.allocate(32, 8) == first + i * 32);
+    }
+    REQUIRE(arena.block_count() == 1);
+}
+
+TEST_CASE("ArenaAllocator: Chained reset retains a high-water set", "[arena_allocator][chained]") {
+    ArenaGrowth growth;
+    growth.max_retained_blocks = 8;
+    ArenaAllocator arena(256, growth);
+
+    auto frame = [&] {
+        for (int i = 0; i < 100; ++i) REQUIRE(arena.allocate(32, 8) != nullptr);
+    };
+
+    frame();
+    size_t const blocks = arena.block_count();
+    size_t const capacity = arena.capacity();
+    arena.reset();
+
+    // a steady state frame reuses exactly the blocks from last time - no new storage
+    for (int f = 0; f < 5; ++f) {
+        frame();
+        REQUIRE(arena.block_count() <= blocks);
+        REQUIRE(arena.capacity() == capacity);
+        arena.reset();
+    }
+}
+
+TEST_CASE("ArenaAllocator: Chained large requests get a dedicated block", "[arena_allocator][chained]") {
+    ArenaAllocator arena(1024, ArenaGrowth{});
+
+    std::byte* small = static_cast<std::byte*>(arena.allocate(900, 8));
+    REQUIRE(small != nullptr);
+
+    // doesn't fit the remaining 124 bytes and is over a quarter of the next 2 KiB block
+    void* big = arena.allocate(4096, 64);
+    REQUIRE(big != nullptr);
+    REQUIRE(is_aligned(big, 64));
+    REQUIRE(arena.block_count() == 1);
+
+    // the current block's tail is still in use
+    REQUIRE(arena.allocate(100, 1) == small + 900);
+
+    arena.reset();
+    REQUIRE(arena.block_count() == 1);
+    REQUIRE(arena.capacity() == 1024);
+}
+
+TEST_CASE("ArenaAllocator: Fixed arena never grows", "[arena_allocator][chained]") {
+    ArenaAllocator arena(128);
+    REQUIRE_FALSE(arena.chained());
+    REQUIRE(arena.allocate(128, 1) != nullptr);
+    REQUIRE(arena.allocate(1, 1) == nullptr);
+    REQUIRE(arena.block_count() == 1);
+}
+
+TEST_CASE("ArenaAllocator: Chained arena grows safely under contention", "[arena_allocator][chained][thread]") {
+    ArenaAllocator arena(1024, ArenaGrowth{});
+
+    const unsigned P = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::vector<std::pair<std::byte*, size_t>>> per_thread(P);
+    std::vector<std::thread> threads;
+    std::atomic<bool> go{false};
+
+    for (unsigned t = 0; t < P; ++t) {
+        threads.emplace_back([&, t] {
+            while (!go.load(std::memory_order_acquire)) /* spin */;
+            for (size_t n = 0; n < 10'000; ++n) {
+                size_t size = 8 + (n * 11 + t) % 120;
+                void* p = arena.allocate(size, 16);
+                REQUIRE(p != nullptr);
+                per_thread[t].push_back({ static_cast<std::byte*>(p), size });
+            }
+        });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& th : threads) th.join();
+
+    std::vector<std::pair<std::byte*, size_t>> all;
+    for (auto& v : per_thread) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    REQUIRE(all.size() == P * 10'000);
+    for (size_t i = 1; i < all.size(); ++i) {
+        REQUIRE(all[i - 1].first + all[i - 1].second <= all[i].first);
+    }
+}
+
+TEST_CASE("ArenaAllocator: Rewind to marker releases later allocations", "[arena_allocator][scope]") {
+    ArenaAllocator arena(1024);
+    void* keep = arena.allocate(100, 8);
+    REQUIRE(keep != nullptr);
+    REQUIRE(arena.used() == 100);
+
+    ArenaMarker m = arena.mark();
+    void* tmp1 = arena.allocate(200, 16);
+    void* tmp2 = arena.allocate(300, 1);
+    REQUIRE(tmp1 != nullptr);
+    REQUIRE(tmp2 != nullptr);
+
+    arena.rewind(m);
+    REQUIRE(arena.used() == 100);
+
+    // the very same bytes come back
+    REQUIRE(arena.allocate(200, 16) == tmp1);
+}
+
+TEST_CASE("ArenaAllocator: Nested ArenaScopes unwind in order", "[arena_allocator][scope]") {
+    ArenaAllocator arena(1024);
+    std::byte* base = static_cast<std::byte*>(arena.allocate(16, 16));
+
+    std::byte* outer_tmp = nullptr;
+    {
+        ArenaScope outer(arena);
+        outer_tmp = static_cast<std::byte*>(arena.allocate(64, 16));
+        REQUIRE(outer_tmp == base + 16);
+        {
+            ArenaScope inner(arena);
+            void* inner_tmp = arena.allocate(512, 16);
+            REQUIRE(inner_tmp != nullptr);
+            REQUIRE(arena.used() == 16 + 64 + 512);
+        }
+        REQUIRE(arena.used() == 16 + 64);
+        // the inner scope's bytes are reused straight away
+        REQUIRE(arena.allocate(8, 16) == outer_tmp + 64);
+    }
+    REQUIRE(arena.used() == 16);
+}
+
+TEST_CASE("ArenaAllocator: Scope reuses warm memory on a hot loop", "[arena_allocator][scope]") {
+    ArenaAllocator arena(4096);
+    void* first = nullptr;
+    for (int i = 0; i < 10'000; ++i) {
+        ArenaScope scratch(arena);
+        void* p = arena.allocate(1024, 64);
+        REQUIRE(p != nullptr);
+        if (first == nullptr) first = p;
+        REQUIRE(p == first);
+    }
+    REQUIRE(arena.used() == 0);
+}
+
+TEST_CASE("ArenaAllocator: Scope rewinds across chained blocks", "[arena_allocator][scope][chained]") {
+    ArenaAllocator arena(256, ArenaGrowth{});
+    std::byte* base = static_cast<std::byte*>(arena.allocate(32, 8));
+
+    {
+        ArenaScope scratch(arena);
+        for (int i = 0; i < 100; ++i) REQUIRE(arena.allocate(32, 8) != nullptr);
+        REQUIRE(arena.block_count() == 4);
+        // a dedicated block for a big request is released by the scope too
+        REQUIRE(arena.allocate(64 * 1024, 8) != nullptr);
+    }
+
+    REQUIRE(arena.used() == 32);
+    REQUIRE(arena.allocate(32, 8) == base + 32);
+
+    // blocks linked inside the scope are kept and reused - no further growth
+    for (int i = 0; i < 100; ++i) REQUIRE(arena.allocate(32, 8) != nullptr);
+    REQUIRE(arena.block_count() == 4);
+}
+
+TEST_CASE("ArenaAllocator: Page backed arenas", "[arena_allocator][page_alloc]") {
+    size_t const page = PageAlloc::os_page_size();
+
+    SECTION("fixed arena on mmap'd pages") {
+        ArenaAllocator arena(1 << 20, PageOptions{ PageBacking::pages });
+        void* first = arena.allocate(16, 16);
+        REQUIRE(reinterpret_cast<uintptr_t>(first) % page == 0);
+        REQUIRE(arena.allocate((1 << 20) - 16, 1) != nullptr);
+        REQUIRE(arena.allocate(1, 1) == nullptr);
+    }
+
+    SECTION("chained arena on huge pages, falling back when none are reserved") {
+        ArenaAllocator arena(64 * 1024, ArenaGrowth{}, PageOptions{ PageBacking::huge_pages });
+        for (int i = 0; i < 1000; ++i) {
+            void* p = arena.allocate(256, 16);
+            REQUIRE(p != nullptr);
+            std::memset(p, i & 0xff, 256);
+        }
+        REQUIRE(arena.block_count() > 1);
+        REQUIRE(arena.allocate(4 << 20, 64) != nullptr); // dedicated block, same backing
+
+        arena.reset();
+        REQUIRE(arena.used() == 0);
+        REQUIRE(arena.page_options().backing == PageBacking::huge_pages);
+    }
+
+    SECTION("pre-faulted arena") {
+        ArenaAllocator arena(256 * 1024, PageOptions{ PageBacking::transparent_huge_pages, true });
+        auto* bytes = static_cast<std::byte*>(arena.allocate(256 * 1024, 1));
+        REQUIRE(bytes != nullptr);
+        REQUIRE(bytes[128 * 1024] == std::byte{0});
+    }
+}
+
+TEST_CASE("ArenaAllocator: Stats are free when disabled", "[arena_allocator][stats]") {
+    static_assert(std::is_empty_v<NoArenaStats>);
+    static_assert(!NoArenaStats::enabled);
+
+    // the default arena is the same object it was before the policy existed
+    struct Reference {
+        bool chained;
+        ArenaGrowth growth;
+        PageOptions pages;
+        UniqueBuffer<std::byte, PageAlloc> blocks[64];
+        size_t block_count;
+        std::vector<UniqueBuffer<std::byte, PageAlloc>> large_blocks;
+        std::atomic<size_t> large_block_count;
+        std::mutex grow_mutex;
+        std::atomic<uint64_t> generation;
+        alignas(cache_line_size) std::atomic<uint64_t> state;
+    };
+    STATIC_REQUIRE(sizeof(ArenaAllocator) == sizeof(Reference));
+}
+
+TEST_CASE("ArenaAllocator: Stats track usage, padding and failures", "[arena_allocator][stats]") {
+    BasicArenaAllocator<ArenaStats> arena(1024);
+
+    REQUIRE(arena.allocate(1, 1) != nullptr);
+    REQUIRE(arena.allocate(8, 8) != nullptr);   // 7 bytes of padding
+    REQUIRE(arena.allocate(100, 4) != nullptr);
+    REQUIRE(arena.allocate(2000, 8) == nullptr);
+    REQUIRE(arena.allocate(8, 3) == nullptr);   // bad alignment
+
+    ArenaStats::Snapshot s = arena.stats().snapshot();
+    REQUIRE(s.allocations == 3);
+    REQUIRE(s.failures == 2);
+    REQUIRE(s.bytes_requested == 109);
+    REQUIRE(s.padding_bytes == 7);
+    REQUIRE(s.used_bytes == arena.used());
+    REQUIRE(s.peak_bytes == 116);
+    REQUIRE(s.cas_retries == 0);
+
+    REQUIRE(s.histogram[ArenaStats::bucket_of(1)] == 1);
+    REQUIRE(s.histogram[ArenaStats::bucket_of(8)] == 1);
+    REQUIRE(s.histogram[ArenaStats::bucket_of(100)] == 1);
+    REQUIRE(ArenaStats::bucket_of(0) == 0);
+    REQUIRE(ArenaStats::bucket_of(64) == 7);
+    REQUIRE(ArenaStats::bucket_of(SIZE_MAX) == ArenaStats::histogram_buckets - 1);
+
+    arena.reset();
+    s = arena.stats().snapshot();
+    REQUIRE(s.used_bytes == 0);
+    REQUIRE(s.peak_bytes == 116); // high-water mark outlives the reset
+    REQUIRE(s.allocations == 3);
+}
+
+TEST_CASE("ArenaAllocator: Stats follow scopes and dedicated blocks", "[arena_allocator][stats][chained]") {
+    BasicArenaAllocator<ArenaStats> arena(256, ArenaGrowth{});
+    REQUIRE(arena.allocate(64, 8) != nullptr);
+
+    {
+        ArenaScope scratch(arena);
+        for (int i = 0; i < 20; ++i) REQUIRE(arena.allocate(32, 8) != nullptr);
+        REQUIRE(arena.allocate(64 * 1024, 16) != nullptr);
+        REQUIRE(arena.stats().snapshot().used_bytes >= 64 + 20 * 32 + 64 * 1024);
+    }
+
+    ArenaStats::Snapshot const s = arena.stats().snapshot();
+    REQUIRE(s.used_bytes == 64);
+    REQUIRE(s.peak_bytes >= 64 + 20 * 32 + 64 * 1024);
+    REQUIRE(s.failures == 0);
+}
+
+TEST_CASE("ArenaAllocator: Stats count contention", "[arena_allocator][stats]") {
+    BasicArenaAllocator<ArenaStats> arena(64, ArenaGrowth{ 2, 1 });
+    constexpr int threads = 4;
+    constexpr int per_thread = 20000;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&arena] {
+            for (int i = 0; i < per_thread; ++i) arena.allocate(16, 8);
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    ArenaStats::Snapshot const s = arena.stats().snapshot();
+    REQUIRE(s.allocations == threads * per_thread);
+    REQUIRE(s.failures == 0);
+    REQUIRE(s.bytes_requested == uint64_t(threads) * per_thread * 16);
+    // retries and lock waits depend on scheduling - on a single core there may be none at all,
+    // so there is nothing to assert about them beyond the totals adding up
+}
+
 // TODO, if time allows
 // Consider adding tests for:
 // - What if total_size for ArenaAllocator is 0?
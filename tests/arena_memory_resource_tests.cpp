@@ -0,0 +1,113 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <arena_memory_resource.h>
+
+TEST_CASE("ArenaResource: pmr containers allocate from the arena", "[arena_resource]") {
+    ArenaAllocator arena(64 * 1024);
+    ArenaResource resource(arena);
+
+    SECTION("vector") {
+        std::pmr::vector<int> v(&resource);
+        for (int i = 0; i < 1000; ++i) v.push_back(i);
+        REQUIRE(v.size() == 1000);
+        REQUIRE(v[999] == 999);
+        // growth is monotonic, so the arena holds at least the final buffer
+        REQUIRE(arena.used() >= 1000 * sizeof(int));
+    }
+
+    SECTION("string") {
+        std::pmr::string s(&resource);
+        s.assign(500, 'x');
+        REQUIRE(s.size() == 500);
+        REQUIRE(arena.used() >= 500);
+    }
+
+    SECTION("unordered_map") {
+        std::pmr::unordered_map<int, std::pmr::string> m(&resource);
+        for (int i = 0; i < 100; ++i) {
+            m.emplace(i, std::pmr::string(64, char('a' + i % 26)));
+        }
+        REQUIRE(m.size() == 100);
+        REQUIRE(m.at(27) == std::pmr::string(64, 'b'));
+        // the nested strings picked up the map's resource
+        REQUIRE(m.at(27).get_allocator().resource() == &resource);
+    }
+}
+
+TEST_CASE("ArenaResource: exhausting a fixed arena throws bad_alloc", "[arena_resource]") {
+    ArenaAllocator arena(256);
+    ArenaResource resource(arena);
+
+    std::pmr::vector<std::byte> v(&resource);
+    REQUIRE_THROWS_AS(v.resize(1024), std::bad_alloc);
+}
+
+TEST_CASE("ArenaResource: chained arena never runs out", "[arena_resource][chained]") {
+    ArenaAllocator arena(256, ArenaGrowth{});
+    ArenaResource resource(arena);
+
+    std::pmr::vector<int> v(&resource);
+    for (int i = 0; i < 100'000; ++i) v.push_back(i);
+    REQUIRE(v.size() == 100'000);
+}
+
+TEST_CASE("ArenaResource: equality follows the arena", "[arena_resource]") {
+    ArenaAllocator a(1024), b(1024);
+    ArenaResource ra1(a), ra2(a), rb(b);
+
+    REQUIRE(ra1 == ra1);
+    REQUIRE(ra1 == ra2);
+    REQUIRE_FALSE(ra1 == rb);
+    REQUIRE_FALSE(ra1 == *std::pmr::new_delete_resource());
+}
+
+TEST_CASE("ArenaStlAllocator: std containers allocate from the arena", "[arena_resource]") {
+    ArenaAllocator arena(64 * 1024);
+
+    SECTION("vector") {
+        std::vector<double, ArenaStlAllocator<double>> v{ ArenaStlAllocator<double>(arena) };
+        for (int i = 0; i < 1000; ++i) v.push_back(i * 0.5);
+        REQUIRE(v[10] == 5.0);
+        REQUIRE(arena.used() >= 1000 * sizeof(double));
+    }
+
+    SECTION("node based containers rebind") {
+        using Alloc = ArenaStlAllocator<std::pair<const int, int>>;
+        std::map<int, int, std::less<int>, Alloc> m{ Alloc(arena) };
+        for (int i = 0; i < 100; ++i) m[i] = i * i;
+        REQUIRE(m[9] == 81);
+
+        std::list<int, ArenaStlAllocator<int>> l{ ArenaStlAllocator<int>(arena) };
+        size_t const before = arena.used();
+        l.push_back(1);
+        REQUIRE(arena.used() > before);
+    }
+
+    SECTION("over-aligned types get their alignment") {
+        struct alignas(64) Wide { float lanes[16]; };
+        std::vector<Wide, ArenaStlAllocator<Wide>> v{ ArenaStlAllocator<Wide>(arena) };
+        arena.allocate(1, 1); // misalign the bump pointer first
+        v.resize(3);
+        REQUIRE(reinterpret_cast<uintptr_t>(v.data()) % 64 == 0);
+    }
+}
+
+TEST_CASE("ArenaStlAllocator: failures and equality", "[arena_resource]") {
+    ArenaAllocator a(64), b(64);
+    ArenaStlAllocator<int> ia(a);
+    ArenaStlAllocator<long> la(a);
+    ArenaStlAllocator<int> ib(b);
+
+    REQUIRE(ia == la);
+    REQUIRE_FALSE(ia == ib);
+
+    REQUIRE_THROWS_AS(ia.allocate(1000), std::bad_alloc);
+    REQUIRE_THROWS_AS(ia.allocate(SIZE_MAX / 2), std::bad_array_new_length);
+}
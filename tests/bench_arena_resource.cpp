@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <arena_memory_resource.h>
+
+// a request handler's worth of scratch containers, built and thrown away per iteration
+TEST_CASE("ArenaResource: per-request containers vs std::pmr and the heap", "[bench]") {
+    constexpr int N = 1'000;
+    constexpr size_t ARENA_SIZE = 1024 * 1024;
+
+    ArenaAllocator arena(ARENA_SIZE);
+    ArenaResource arena_resource(arena);
+    std::vector<std::byte> monotonic_storage(ARENA_SIZE);
+
+    BENCHMARK("std::allocator vector<int> + unordered_map") {
+        std::vector<int> v;
+        std::unordered_map<int, int> m;
+        for (int i = 0; i < N; ++i) { v.push_back(i); m.emplace(i, i); }
+        return v.size() + m.size();
+    };
+
+    BENCHMARK("pmr::monotonic_buffer_resource vector<int> + unordered_map") {
+        std::pmr::monotonic_buffer_resource mono(monotonic_storage.data(), monotonic_storage.size(),
+                                                 std::pmr::null_memory_resource());
+        std::pmr::vector<int> v(&mono);
+        std::pmr::unordered_map<int, int> m(&mono);
+        for (int i = 0; i < N; ++i) { v.push_back(i); m.emplace(i, i); }
+        return v.size() + m.size();
+    };
+
+    BENCHMARK("ArenaResource vector<int> + unordered_map") {
+        ArenaScope scratch(arena);
+        std::pmr::vector<int> v(&arena_resource);
+        std::pmr::unordered_map<int, int> m(&arena_resource);
+        for (int i = 0; i < N; ++i) { v.push_back(i); m.emplace(i, i); }
+        return v.size() + m.size();
+    };
+
+    BENCHMARK("ArenaStlAllocator vector<int>") {
+        ArenaScope scratch(arena);
+        std::vector<int, ArenaStlAllocator<int>> v{ ArenaStlAllocator<int>(arena) };
+        for (int i = 0; i < N; ++i) v.push_back(i);
+        return v.size();
+    };
+
+    BENCHMARK("pmr::monotonic_buffer_resource pmr::string x N") {
+        std::pmr::monotonic_buffer_resource mono(monotonic_storage.data(), monotonic_storage.size(),
+                                                 std::pmr::null_memory_resource());
+        std::pmr::vector<std::pmr::string> v(&mono);
+        for (int i = 0; i < N; ++i) v.emplace_back(48, 'x');
+        return v.size();
+    };
+
+    BENCHMARK("ArenaResource pmr::string x N") {
+        ArenaScope scratch(arena);
+        std::pmr::vector<std::pmr::string> v(&arena_resource);
+        for (int i = 0; i < N; ++i) v.emplace_back(48, 'x');
+        return v.size();
+    };
+}
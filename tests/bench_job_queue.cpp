@@ -0,0 +1,100 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <job_queue.h>
+
+// the global submission ring against the obvious locked alternative. each run moves `ops` items
+// through the queue with two producers and two consumers.
+
+namespace {
+constexpr size_t ops = 200'000;
+
+struct LockedQueue {
+    std::mutex lock;
+    std::deque<size_t> items;
+
+    bool push(size_t v) {
+        std::scoped_lock guard(lock);
+        items.push_back(v);
+        return true;
+    }
+    bool pop(size_t& out) {
+        std::scoped_lock guard(lock);
+        if (items.empty()) return false;
+        out = items.front();
+        items.pop_front();
+        return true;
+    }
+};
+
+template <typename Queue>
+size_t pump(Queue& q) {
+    std::atomic<size_t> consumed{0};
+    std::atomic<size_t> checksum{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < 2; ++p) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < ops / 2; ++i) {
+                while (!q.push(i)) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&] {
+            size_t v, local = 0;
+            while (consumed.load(std::memory_order_relaxed) < ops) {
+                if (q.pop(v)) {
+                    local += v;
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            checksum.fetch_add(local);
+        });
+    }
+    for (auto& t : threads) t.join();
+    return checksum.load();
+}
+}
+
+TEST_CASE("JobQueue: MPMC ring vs mutex + deque", "[bench][job_queue]") {
+    BENCHMARK("single thread push/pop pairs") {
+        JobQueue<size_t> q(1024);
+        size_t v = 0, total = 0;
+        for (size_t i = 0; i < ops; ++i) {
+            q.push(i);
+            q.pop(v);
+            total += v;
+        }
+        return total;
+    };
+
+    BENCHMARK("single thread, batches of 64") {
+        JobQueue<size_t> q(1024);
+        size_t batch[64], out[64], total = 0;
+        for (size_t i = 0; i < ops; i += 64) {
+            for (size_t k = 0; k < 64; ++k) batch[k] = i + k;
+            q.push_bulk(batch);
+            size_t const got = q.pop_bulk(out, 64);
+            for (size_t k = 0; k < got; ++k) total += out[k];
+        }
+        return total;
+    };
+
+    BENCHMARK("2P/2C JobQueue") {
+        JobQueue<size_t> q(4096);
+        return pump(q);
+    };
+
+    BENCHMARK("2P/2C mutex + std::deque") {
+        LockedQueue q;
+        return pump(q);
+    };
+}
@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <arena_allocator.h>
+#include <parallel_sort.h>
+#include <unique_buffer.h>
+
+namespace {
+struct ChunkInfo {
+    std::byte* begin;
+    std::byte* end;
+};
+}
+
+TEST_CASE("parallel_sort: arena overlap audit", "[bench][thread]") {
+
+    // allocation records of a 64 MB arena, in the order the threads would have logged them
+    constexpr std::size_t N = 2'000'000;
+    static UniqueBuffer<std::byte, UninitializedAlloc> memory(N * 32);
+    std::vector<ChunkInfo> logged(N);
+    for (std::size_t i = 0; i < N; ++i) {
+        logged[i] = {memory.data() + i * 32, memory.data() + i * 32 + 24};
+    }
+    std::shuffle(logged.begin(), logged.end(), std::mt19937(1));
+
+    ThreadPool pool;
+    ArenaAllocator scratch(64 * 1024 * 1024);
+    auto overlaps = [](const ChunkInfo& a, const ChunkInfo& b) { return a.end > b.begin; };
+    auto by_begin = [](const ChunkInfo& a, const ChunkInfo& b) { return a.begin < b.begin; };
+
+    std::vector<ChunkInfo> chunks(N);
+    BENCHMARK_ADVANCED("std::sort + linear scan, 2M chunks")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&] {
+            chunks = logged;
+            std::sort(chunks.begin(), chunks.end(), by_begin);
+            bool overlap = false;
+            for (std::size_t i = 1; i < chunks.size(); ++i) overlap |= overlaps(chunks[i - 1], chunks[i]);
+            return overlap;
+        });
+    };
+
+    BENCHMARK_ADVANCED("parallel_sort (merge) + parallel_any_adjacent, 2M chunks")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&] {
+            chunks = logged;
+            parallel_sort(pool, chunks, by_begin, &scratch);
+            return parallel_any_adjacent(pool, chunks, overlaps);
+        });
+    };
+
+    BENCHMARK_ADVANCED("parallel_radix_sort + parallel_any_adjacent, 2M chunks")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&] {
+            chunks = logged;
+            parallel_radix_sort(pool, chunks, [](const ChunkInfo& c) { return c.begin; }, &scratch);
+            return parallel_any_adjacent(pool, chunks, overlaps);
+        });
+    };
+}
@@ -1,42 +1,49 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/benchmark/catch_benchmark.hpp>
+#include <parallel.h>
+#include <simd.h>
 #include <small_vector.h>
-#include <thread>
+#include <thread_pool.h>
+#include <functional>
 #include <numeric>
-#include <atomic>
-#include <vector>
-
-float parallel_sum(SmallVector<float, 8>& vec) {
-    unsigned p = std::thread::hardware_concurrency();
-    size_t chunk = vec.size() / p;
-    std::atomic<float> total{0};
-
-    std::vector<std::thread> workers;
-    for (unsigned t = 0; t < p; ++t) {
-        size_t begin = t * chunk;
-        size_t end   = (t == p - 1) ? vec.size() : begin + chunk;
-        workers.emplace_back([&, begin, end]{
-            float local = 0;
-            for (size_t i = begin; i < end; ++i) local += vec[i];
-            float cur_total = total.load(std::memory_order_relaxed);
-            cur_total += local;
-            total.store(cur_total);
-        });
-    }
-    for (auto& th : workers) th.join();
-    return total.load();
+#include <span>
+
+// the parallel sum used to spawn a thread per core per call and add the partials with a racy
+// load/add/store on an atomic float. parallel_reduce runs on the persistent pool and combines
+// padded per-chunk partials in a fixed order, so it is both faster and the same every time.
+float parallel_sum(ThreadPool& pool, SmallVector<float, 8>& vec) {
+    return parallel_reduce(pool, vec, 0.0f, std::plus<>{});
 }
 
 TEST_CASE("SmallVector: Parallel sum vs scalar", "[bench][thread]") {
     const size_t N = 1'000'000;
     SmallVector<float, 8> v;
     for (size_t i = 0; i < N; ++i) v.push_back(static_cast<float>(i));
+    ThreadPool pool;
 
     BENCHMARK("scalar sum") {
         return std::accumulate(v.begin(), v.end(), 0.0f);
     };
 
     BENCHMARK("parallel sum") {
-        return parallel_sum(v);
+        return parallel_sum(pool, v);
+    };
+
+    BENCHMARK("simd sum") {
+        return simd::sum(v);
+    };
+
+    BENCHMARK("simd sum, sse2 only") {
+        static simd::Kernels const sse2 = simd::kernels(simd::Isa::sse2);
+        return simd::sum(std::span<const float>(v.begin(), v.size()), sse2);
+    };
+
+    BENCHMARK("parallel simd sum") {
+        return parallel_reduce_chunks(pool, v, 0.0f, [](std::span<const float> chunk) { return simd::sum(chunk); }, std::plus<>{});
+    };
+
+    BENCHMARK("parallel inclusive scan") {
+        parallel_inclusive_scan(pool, v, v, [](float, float b) { return b; });   // copy-through, keeps v intact
+        return v[N - 1];
     };
 }
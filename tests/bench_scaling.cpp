@@ -0,0 +1,393 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arena_allocator.h>
+#include <job_queue.h>
+#include <thread_pool.h>
+
+/*
+Contention scaling sweep - run with
+
+    cpp_refresh_bench "[scaling]"                       # JSON on stdout
+    BENCH_JSON=scaling.json cpp_refresh_bench "[scaling]"
+
+Every workload runs at 1, 2, 4, ... threads up to hardware_concurrency() and reports, per thread
+count, total ops/sec, per-op latency percentiles and scaling efficiency (ops/sec over threads
+times the single-thread ops/sec - 1.0 is perfect scaling). Baselines (malloc, std::pmr, a mutex
++ std::deque queue and pool) are flagged so a dashboard can plot them against what they stand in
+for.
+
+Throughput and latency come from separate passes: bench ops are a few nanoseconds, about what a
+steady_clock read costs, so timing every op would mostly measure the clock. The latency pass does
+time every op and includes that overhead - compare percentiles between runs, not against zero.
+*/
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t ops_per_thread = 100'000;
+constexpr size_t alloc_size = 64;
+constexpr size_t live_allocations = 64;   // malloc/pmr keep this many blocks alive per thread
+
+struct Point {
+    size_t threads = 0;
+    double ops_per_sec = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+    double efficiency = 0;
+};
+
+struct Series {
+    std::string name;
+    bool baseline = false;
+    std::vector<Point> points;
+};
+
+std::vector<size_t> thread_counts() {
+    size_t const hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t t = 1; t < hardware; t *= 2) counts.push_back(t);
+    counts.push_back(hardware);
+    return counts;
+}
+
+// the nearest-rank percentile of a sorted set of samples
+uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t const rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[rank];
+}
+
+// body(thread, timed) on `threads` threads released together. body runs ops_per_thread ops and,
+// when timed, writes each op's latency into its own slice of the samples.
+struct Workload {
+    std::function<void(size_t threads)> setup = [](size_t) {};
+    std::function<void(size_t thread, uint64_t* latencies)> body;   // latencies is null when untimed
+    std::function<void()> teardown = [] {};
+    std::function<void()> finish = [] {};   // still timed - work the body queued up but didn't do
+};
+
+double run_pass(size_t threads, const Workload& work, std::vector<uint64_t>* samples) {
+    work.setup(threads);
+    if (samples != nullptr) samples->assign(threads * ops_per_thread, 0);
+
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            work.body(t, samples != nullptr ? samples->data() + t * ops_per_thread : nullptr);
+        });
+    }
+    while (ready.load() != threads) std::this_thread::yield();
+    auto const start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : pool) t.join();
+    work.finish();
+    double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    work.teardown();
+    return static_cast<double>(threads * ops_per_thread) / seconds;
+}
+
+Series sweep(std::string name, bool baseline, const Workload& work) {
+    Series series{std::move(name), baseline, {}};
+    std::vector<uint64_t> samples;
+    for (size_t threads : thread_counts()) {
+        Point point;
+        point.threads = threads;
+        point.ops_per_sec = run_pass(threads, work, nullptr);
+        run_pass(threads, work, &samples);
+        std::sort(samples.begin(), samples.end());
+        point.p50_ns = percentile(samples, 0.50);
+        point.p99_ns = percentile(samples, 0.99);
+        point.p999_ns = percentile(samples, 0.999);
+        double const single = series.points.empty() ? point.ops_per_sec : series.points.front().ops_per_sec;
+        point.efficiency = point.ops_per_sec / (static_cast<double>(threads) * single);
+        series.points.push_back(point);
+    }
+    return series;
+}
+
+// op() ops_per_thread times, each one timed when latencies is set
+template <typename Op>
+void repeat(uint64_t* latencies, Op&& op) {
+    if (latencies == nullptr) {
+        for (size_t i = 0; i < ops_per_thread; ++i) op(i);
+        return;
+    }
+    for (size_t i = 0; i < ops_per_thread; ++i) {
+        auto const before = Clock::now();
+        op(i);
+        latencies[i] = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+    }
+}
+
+// ---- allocators: one 64-byte allocation per op ----
+
+Workload arena_allocate() {
+    auto arena = std::make_shared<std::unique_ptr<ArenaAllocator>>();
+    return Workload{
+        [arena](size_t threads) {
+            // pages are only touched as they are used, so sizing for the whole pass is cheap
+            *arena = std::make_unique<ArenaAllocator>(threads * ops_per_thread * alloc_size + 4096);
+        },
+        [arena](size_t, uint64_t* latencies) {
+            ArenaAllocator& a = **arena;
+            repeat(latencies, [&](size_t) {
+                void* volatile p = a.allocate(alloc_size, alignof(std::max_align_t));
+                (void)p;
+            });
+        },
+        [arena] { arena->reset(); },
+    };
+}
+
+// frees the block allocated live_allocations ops ago, so both sides of the allocator are exercised
+template <typename Allocate, typename Free>
+void churn(uint64_t* latencies, Allocate allocate, Free release) {
+    void* live[live_allocations] = {};
+    repeat(latencies, [&](size_t i) {
+        void*& slot = live[i % live_allocations];
+        if (slot != nullptr) release(slot);
+        slot = allocate();
+    });
+    for (void* p : live) {
+        if (p != nullptr) release(p);
+    }
+}
+
+Workload malloc_free() {
+    return Workload{
+        [](size_t) {},
+        [](size_t, uint64_t* latencies) {
+            churn(latencies, [] { return std::malloc(alloc_size); }, [](void* p) { std::free(p); });
+        },
+    };
+}
+
+Workload pmr_pool() {
+    auto resource = std::make_shared<std::unique_ptr<std::pmr::synchronized_pool_resource>>();
+    return Workload{
+        [resource](size_t) { *resource = std::make_unique<std::pmr::synchronized_pool_resource>(); },
+        [resource](size_t, uint64_t* latencies) {
+            auto& r = **resource;
+            churn(latencies, [&] { return r.allocate(alloc_size); }, [&](void* p) { r.deallocate(p, alloc_size); });
+        },
+        [resource] { resource->reset(); },
+    };
+}
+
+// ---- queues: one push + one pop per op on a shared queue ----
+
+struct LockedQueue {
+    std::mutex lock;
+    std::deque<size_t> items;
+
+    bool push(size_t v) {
+        std::scoped_lock guard(lock);
+        items.push_back(v);
+        return true;
+    }
+    bool pop(size_t& out) {
+        std::scoped_lock guard(lock);
+        if (items.empty()) return false;
+        out = items.front();
+        items.pop_front();
+        return true;
+    }
+};
+
+template <typename Queue, typename... Args>
+Workload push_pop(Args... args) {
+    auto queue = std::make_shared<std::unique_ptr<Queue>>();
+    return Workload{
+        [queue, args...](size_t) { *queue = std::make_unique<Queue>(args...); },
+        [queue](size_t, uint64_t* latencies) {
+            Queue& q = **queue;
+            size_t out = 0;
+            repeat(latencies, [&](size_t i) {
+                while (!q.push(i)) std::this_thread::yield();
+                // someone else may have just taken ours - there is always one to come
+                while (!q.pop(out)) std::this_thread::yield();
+            });
+        },
+        [queue] { queue->reset(); },
+    };
+}
+
+// every thread pushes onto its own deque and steals from its neighbour's - the top CASes are
+// what contends. a failed steal pops our own instead, so every deque stays bounded.
+Workload push_steal() {
+    auto deques = std::make_shared<std::vector<std::unique_ptr<WorkStealingDeque<size_t>>>>();
+    return Workload{
+        [deques](size_t threads) {
+            deques->clear();
+            for (size_t t = 0; t < threads; ++t) {
+                deques->push_back(std::make_unique<WorkStealingDeque<size_t>>(1024));
+            }
+        },
+        [deques](size_t thread, uint64_t* latencies) {
+            auto& mine = *(*deques)[thread];
+            auto& victim = *(*deques)[(thread + 1) % deques->size()];
+            size_t out = 0;
+            repeat(latencies, [&](size_t i) {
+                if (!mine.push(i)) mine.pop(out);   // full because every steal on us failed
+                if (!victim.steal(out)) mine.pop(out);
+            });
+        },
+        [deques] { deques->clear(); },
+    };
+}
+
+// ---- executors: one tiny job per op, submitted from every sweep thread ----
+
+// the textbook pool - a mutex, a condition variable and a std::deque of std::function
+class LockedPool {
+public:
+    explicit LockedPool(size_t workers) {
+        for (size_t i = 0; i < workers; ++i) {
+            m_workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ~LockedPool() {
+        {
+            std::scoped_lock guard(m_lock);
+            m_stopping = true;
+        }
+        m_ready.notify_all();
+        for (auto& w : m_workers) w.join();
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::scoped_lock guard(m_lock);
+            m_jobs.push_back(std::move(job));
+            ++m_pending;
+        }
+        m_ready.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock guard(m_lock);
+        m_idle.wait(guard, [this] { return m_pending == 0; });
+    }
+
+private:
+    void run() {
+        std::unique_lock guard(m_lock);
+        while (true) {
+            m_ready.wait(guard, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty()) return;
+            auto job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            guard.unlock();
+            job();
+            guard.lock();
+            if (--m_pending == 0) m_idle.notify_all();
+        }
+    }
+
+    std::mutex m_lock;
+    std::condition_variable m_ready;
+    std::condition_variable m_idle;
+    std::deque<std::function<void()>> m_jobs;
+    size_t m_pending = 0;
+    bool m_stopping = false;
+    std::vector<std::thread> m_workers;
+};
+
+// the pool has as many workers as the sweep has threads, and the sweep threads submit; latency
+// is the submit call itself, throughput counts until the last job has run
+template <typename Pool>
+Workload submit_jobs() {
+    auto pool = std::make_shared<std::unique_ptr<Pool>>();
+    auto ran = std::make_shared<std::atomic<size_t>>(0);
+    return Workload{
+        [pool, ran](size_t threads) {
+            *pool = std::make_unique<Pool>(threads);
+            ran->store(0);
+        },
+        [pool, ran](size_t, uint64_t* latencies) {
+            Pool& p = **pool;
+            std::atomic<size_t>* counter = ran.get();
+            repeat(latencies, [&](size_t) { p.submit([counter] { counter->fetch_add(1, std::memory_order_relaxed); }); });
+        },
+        [pool, ran] {
+            REQUIRE(ran->load() > 0);
+            pool->reset();
+        },
+        [pool] { (*pool)->wait(); },
+    };
+}
+
+void write_json(std::FILE* out, const std::vector<Series>& all) {
+    std::fprintf(out, "{\n  \"hardware_concurrency\": %u,\n  \"ops_per_thread\": %zu,\n  \"benchmarks\": [\n",
+                 std::max(1u, std::thread::hardware_concurrency()), ops_per_thread);
+    for (size_t s = 0; s < all.size(); ++s) {
+        Series const& series = all[s];
+        std::fprintf(out, "    {\"name\": \"%s\", \"baseline\": %s, \"results\": [\n",
+                     series.name.c_str(), series.baseline ? "true" : "false");
+        for (size_t i = 0; i < series.points.size(); ++i) {
+            Point const& p = series.points[i];
+            std::fprintf(out,
+                         "      {\"threads\": %zu, \"ops_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+                         "\"p999_ns\": %llu, \"efficiency\": %.3f}%s\n",
+                         p.threads, p.ops_per_sec, static_cast<unsigned long long>(p.p50_ns),
+                         static_cast<unsigned long long>(p.p99_ns), static_cast<unsigned long long>(p.p999_ns),
+                         p.efficiency, i + 1 < series.points.size() ? "," : "");
+        }
+        std::fprintf(out, "    ]}%s\n", s + 1 < all.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+}
+
+TEST_CASE("Contention scaling: allocators, queues and executors", "[bench][scaling]") {
+    std::vector<Series> all;
+    all.push_back(sweep("ArenaAllocator::allocate", false, arena_allocate()));
+    all.push_back(sweep("malloc/free", true, malloc_free()));
+    all.push_back(sweep("std::pmr::synchronized_pool_resource", true, pmr_pool()));
+
+    all.push_back(sweep("JobQueue push/pop", false, push_pop<JobQueue<size_t>>(size_t(4096))));
+    all.push_back(sweep("WorkStealingDeque push/steal", false, push_steal()));
+    all.push_back(sweep("mutex + std::deque push/pop", true, push_pop<LockedQueue>()));
+
+    all.push_back(sweep("ThreadPool submit", false, submit_jobs<ThreadPool>()));
+    all.push_back(sweep("mutex + std::deque pool submit", true, submit_jobs<LockedPool>()));
+
+    for (Series const& series : all) {
+        for (Point const& p : series.points) {
+            REQUIRE(p.ops_per_sec > 0);
+            REQUIRE(p.p50_ns <= p.p99_ns);
+            REQUIRE(p.p99_ns <= p.p999_ns);
+        }
+    }
+
+    if (char const* path = std::getenv("BENCH_JSON")) {
+        std::FILE* out = std::fopen(path, "w");
+        REQUIRE(out != nullptr);
+        write_json(out, all);
+        std::fclose(out);
+    } else {
+        write_json(stdout, all);
+    }
+}
@@ -1,6 +1,11 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/benchmark/catch_benchmark.hpp>
+#include <arena_allocator.h>
 #include <small_vector.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 TEST_CASE("SmallVector: push_back vs std::vector", "[bench]") {
 
@@ -24,4 +29,86 @@ TEST_CASE("SmallVector: push_back vs std::vector", "[bench]") {
         for (std::size_t i = 0; i < N; ++i) v.push_back(static_cast<int>(i));
         return v.size();
     };
+
+    BENCHMARK("SmallVector<N=8> reserve(N) + emplace_back N ints") {
+        SmallVector<int, 8> sv;
+        sv.reserve(N);
+        for (std::size_t i = 0; i < N; ++i) sv.emplace_back(static_cast<int>(i));
+        return sv.size();
+    };
+
+    BENCHMARK("std::vector reserve(N) + emplace_back N ints") {
+        std::vector<int> v;
+        v.reserve(N);
+        for (std::size_t i = 0; i < N; ++i) v.emplace_back(static_cast<int>(i));
+        return v.size();
+    };
+
+    // the spill is a bump in the arena; resetting it is the only free
+    ArenaAllocator arena(64 * 1024);
+    BENCHMARK("SmallVector<N=8, ArenaAlloc> push_back N ints") {
+        arena.reset();
+        SmallVector<int, 8, ArenaAlloc> sv{ArenaAlloc(arena)};
+        for (std::size_t i = 0; i < N; ++i) sv.push_back(static_cast<int>(i));
+        return sv.size();
+    };
+}
+
+TEST_CASE("SmallVector: growth with non-trivial elements", "[bench]") {
+
+    constexpr std::size_t N = 1'000;
+
+    BENCHMARK("SmallVector<std::string, 8> emplace_back N") {
+        SmallVector<std::string, 8> sv;
+        for (std::size_t i = 0; i < N; ++i) sv.emplace_back("short");
+        return sv.size();
+    };
+
+    BENCHMARK("std::vector<std::string> emplace_back N") {
+        std::vector<std::string> v;
+        v.reserve(8);
+        for (std::size_t i = 0; i < N; ++i) v.emplace_back("short");
+        return v.size();
+    };
+}
+
+namespace {
+struct Span {          // the shape of ChunkInfo in concurrency_stress_tests.cpp
+    std::byte* begin;
+    std::byte* end;
+};
+
+template <typename Vector>
+std::size_t total_bytes(const std::vector<Vector>& all) {
+    std::size_t total = 0;
+    for (const auto& v : all) {
+        for (const Span& s : v) total += static_cast<std::size_t>(s.end - s.begin);
+    }
+    return total;
+}
+}
+
+TEST_CASE("SmallVector: scanning many small vectors", "[bench]") {
+
+    // a working set of small vectors well past L2: the header bytes per object decide how many
+    // fit in each cache line
+    constexpr std::size_t count = 200'000;
+    static std::byte base[64];
+
+    std::vector<SmallVector<Span, 4>> wide(count);
+    std::vector<CompactSmallVector<Span, 4>> compact(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t j = 0; j < 1 + i % 3; ++j) {
+            wide[i].push_back(Span{base, base + j + 1});
+            compact[i].push_back(Span{base, base + j + 1});
+        }
+    }
+
+    BENCHMARK("SmallVector<Span, 4> x 200k scan") {
+        return total_bytes(wide);
+    };
+
+    BENCHMARK("CompactSmallVector<Span, 4> x 200k scan") {
+        return total_bytes(compact);
+    };
 }
@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <simd.h>
+#include <soa_vector.h>
+
+namespace {
+// a typical hot-loop record: the loop below only wants `mass`
+struct Particle {
+    float x, y, z;
+    float mass;
+    uint32_t id;
+    uint32_t flags;
+    double age;
+};
+}
+
+TEST_CASE("SoAVector: one field out of a wide record", "[bench]") {
+
+    constexpr std::size_t N = 1'000'000;
+
+    std::vector<Particle> aos(N);
+    SoAVector<float, float, float, float, uint32_t, uint32_t, double> soa;
+    soa.reserve(N);
+    for (std::size_t i = 0; i < N; ++i) {
+        float const mass = static_cast<float>(i % 7);
+        aos[i] = Particle{0, 0, 0, mass, static_cast<uint32_t>(i), 0, 0.0};
+        soa.push_back(0.0f, 0.0f, 0.0f, mass, static_cast<uint32_t>(i), 0u, 0.0);
+    }
+
+    BENCHMARK("std::vector<Particle> sum of mass") {
+        float total = 0.0f;
+        for (const Particle& p : aos) total += p.mass;
+        return total;
+    };
+
+    BENCHMARK("SoAVector mass column, scalar loop") {
+        float total = 0.0f;
+        for (float m : soa.column<3>()) total += m;
+        return total;
+    };
+
+    BENCHMARK("SoAVector mass column, simd::sum") {
+        return simd::sum(soa.column<3>());
+    };
+}
+
+TEST_CASE("SoAVector: sort and scan for overlaps", "[bench]") {
+
+    constexpr std::size_t N = 100'000;
+
+    struct ChunkInfo {
+        std::byte* begin;
+        std::byte* end;
+    };
+
+    static std::byte memory[2 * N];
+    std::vector<std::size_t> offsets(N);
+    for (std::size_t i = 0; i < N; ++i) offsets[i] = (i * 7919) % N;   // shuffled, no overlaps
+
+    BENCHMARK_ADVANCED("std::vector<ChunkInfo> sort + scan")(Catch::Benchmark::Chronometer meter) {
+        std::vector<ChunkInfo> chunks(N);
+        for (std::size_t i = 0; i < N; ++i) chunks[i] = {memory + offsets[i] * 2, memory + offsets[i] * 2 + 1};
+        meter.measure([&] {
+            std::sort(chunks.begin(), chunks.end(), [](auto& a, auto& b) { return a.begin < b.begin; });
+            bool overlap = false;
+            for (std::size_t i = 1; i < chunks.size(); ++i) overlap |= chunks[i].begin < chunks[i - 1].end;
+            return overlap;
+        });
+    };
+
+    BENCHMARK_ADVANCED("SoAVector sort_by + column scan")(Catch::Benchmark::Chronometer meter) {
+        SoAVector<std::byte*, std::byte*> chunks;
+        for (std::size_t i = 0; i < N; ++i) chunks.push_back(memory + offsets[i] * 2, memory + offsets[i] * 2 + 1);
+        meter.measure([&] {
+            chunks.sort_by<0>();
+            auto begins = chunks.column<0>();
+            auto ends = chunks.column<1>();
+            bool overlap = false;
+            for (std::size_t i = 1; i < chunks.size(); ++i) overlap |= begins[i] < ends[i - 1];
+            return overlap;
+        });
+    };
+}
@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+#include <unique_buffer.h>
+
+// the same saxpy three ways. at() throws, so the compiler has to keep every iteration's check
+// in order and can't vectorize; operator[] is a plain load in release builds; the aligned
+// variant also tells the compiler data() starts on a 64 byte boundary.
+
+static void saxpy_checked(float a, const UniqueBuffer<float>& x, UniqueBuffer<float>& y) {
+    for (size_t i = 0; i < y.size(); ++i) y.at(i) += a * x.at(i);
+}
+
+static void saxpy_unchecked(float a, const UniqueBuffer<float>& x, UniqueBuffer<float>& y) {
+    for (size_t i = 0; i < y.size(); ++i) y[i] += a * x[i];
+}
+
+template <typename Buffer>
+static void saxpy_aligned(float a, const Buffer& x, Buffer& y) {
+    const float* __restrict xs = std::assume_aligned<Buffer::alignment>(x.data());
+    float* __restrict ys = std::assume_aligned<Buffer::alignment>(y.data());
+    size_t const n = y.size();
+    for (size_t i = 0; i < n; ++i) ys[i] += a * xs[i];
+}
+
+TEST_CASE("UniqueBuffer: checked vs unchecked access", "[bench][unique_buffer]") {
+    constexpr size_t N = 1 << 16;
+    UniqueBuffer<float> x(N), y(N);
+    AlignedBuffer<float, 64> ax(N), ay(N);
+    for (size_t i = 0; i < N; ++i) {
+        x[i] = ax[i] = static_cast<float>(i);
+        y[i] = ay[i] = 1.0f;
+    }
+
+    BENCHMARK("saxpy at()") {
+        saxpy_checked(0.5f, x, y);
+        return y[N - 1];
+    };
+
+    BENCHMARK("saxpy operator[]") {
+        saxpy_unchecked(0.5f, x, y);
+        return y[N - 1];
+    };
+
+    BENCHMARK("saxpy 64-byte aligned data()") {
+        saxpy_aligned(0.5f, ax, ay);
+        return ay[N - 1];
+    };
+}
+
+// a staging buffer that is filled straight after allocation - the zeroing pass is pure overhead
+TEST_CASE("UniqueBuffer: zeroed vs uninitialized staging buffer", "[bench][unique_buffer]") {
+    constexpr size_t N = 16 << 20;
+    UniqueBuffer<std::byte> staging; // outlives each run so the fill can't be optimized away
+
+    BENCHMARK("value-initialized 16 MiB, then filled") {
+        staging = UniqueBuffer<std::byte>();
+        staging = UniqueBuffer<std::byte>(N);
+        std::memset(staging.data(), 0x5a, N);
+        return staging.data();
+    };
+
+    BENCHMARK("uninitialized 16 MiB, then filled") {
+        staging = UniqueBuffer<std::byte>();
+        staging = UniqueBuffer<std::byte>::uninitialized(N);
+        std::memset(staging.data(), 0x5a, N);
+        return staging.data();
+    };
+}
@@ -0,0 +1,256 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <arena_allocator.h>
+#include <ebr.h>
+#include <pool_allocator.h>
+
+namespace {
+struct Node {
+    uint64_t value;
+    std::atomic<Node*> next{nullptr};
+    inline static std::atomic<int> destroyed{0};
+
+    explicit Node(uint64_t v) : value(v) {}
+    ~Node() { destroyed.fetch_add(1, std::memory_order_relaxed); }
+};
+
+// Treiber stack over an EpochDomain, nodes from a thread-safe PoolAllocator
+class Stack {
+public:
+    Stack(EpochDomain& domain, PoolAllocator<Node>& pool) : m_domain(domain), m_pool(pool) {}
+
+    void push(uint64_t value) {
+        Node* node = m_pool.create(value);
+        Node* head = m_head.load(std::memory_order_relaxed);
+        do {
+            node->next.store(head, std::memory_order_relaxed);
+        } while (!m_head.compare_exchange_weak(head, node, std::memory_order_seq_cst, std::memory_order_relaxed));
+    }
+
+    bool pop(uint64_t& out) {
+        EpochDomain::Guard guard(m_domain);
+        Node* head = m_head.load(std::memory_order_seq_cst);
+        while (head != nullptr) {
+            // head may already be popped by someone else - the guard keeps it readable
+            Node* const next = head->next.load(std::memory_order_relaxed);
+            if (m_head.compare_exchange_weak(head, next, std::memory_order_seq_cst)) {
+                out = head->value;
+                m_domain.retire(head, m_pool);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    EpochDomain& m_domain;
+    PoolAllocator<Node>& m_pool;
+    std::atomic<Node*> m_head{nullptr};
+};
+}
+
+TEST_CASE("EpochDomain: Nothing is reclaimed while a guard from its epoch is alive", "[ebr]") {
+    EpochDomain domain(1);
+    Node::destroyed = 0;
+
+    {
+        EpochDomain::Guard outer(domain);
+        EpochDomain::Guard inner(domain);   // nests, same pin
+        uint64_t const retired_at = domain.epoch();
+        domain.retire(new Node(1));
+
+        // we are pinned at the current epoch, so it can step once - but not twice
+        for (int i = 0; i < 4; ++i) domain.collect();
+        REQUIRE(domain.epoch() == retired_at + 1);
+        REQUIRE(domain.pending() == 1);
+        REQUIRE(Node::destroyed == 0);
+    }
+
+    // unpinned: two more steps and it is gone
+    domain.collect();
+    domain.collect();
+    REQUIRE(domain.pending() == 0);
+    REQUIRE(Node::destroyed == 1);
+}
+
+TEST_CASE("EpochDomain: Retire lists flush once per batch", "[ebr]") {
+    EpochDomain domain(8);
+    Node::destroyed = 0;
+
+    for (int i = 0; i < 7; ++i) domain.retire(new Node(i));
+    REQUIRE(domain.epoch() == 0);          // no flush yet - not even an epoch scan
+    REQUIRE(domain.pending() == 7);
+
+    domain.retire(new Node(7));            // the 8th flushes
+    REQUIRE(domain.epoch() == 1);
+
+    // every flush moves the epoch on, so within two more batches the first one is gone
+    for (int i = 0; i < 16; ++i) domain.retire(new Node(i));
+    REQUIRE(Node::destroyed >= 8);
+    REQUIRE(domain.pending() + Node::destroyed == 24);
+
+    // and whatever is left goes with the domain
+}
+
+TEST_CASE("EpochDomain: Threads without a slot can retire from inside a reclaim", "[ebr][thread]") {
+    // take every thread slot with parked threads until one comes up empty
+    std::atomic<bool> release{false};
+    std::vector<std::thread> holders;
+    size_t pending = 1;
+    int destroyed = 0;
+
+    void (*again)(void*, void*) noexcept = [](void* q, void* context) noexcept {
+        delete static_cast<Node*>(q);
+        static_cast<EpochDomain*>(context)->retire(new Node(1));
+    };
+
+    while (holders.size() <= max_thread_slots) {
+        std::atomic<int> got{-1};
+        holders.emplace_back([&] {
+            if (this_thread_slot() != no_thread_slot) {
+                got = 1;
+                release.wait(false);
+                return;
+            }
+            got = 0;
+            Node::destroyed = 0;
+            EpochDomain domain(1);
+            domain.retire(new Node(0), again, &domain);
+            // the first reclaim retires a second node through the overflow list's lock
+            for (int i = 0; i < 8 && domain.pending() != 0; ++i) domain.collect();
+            pending = domain.pending();
+            destroyed = Node::destroyed;
+        });
+        while (got == -1) std::this_thread::yield();
+        if (got == 0) break;
+    }
+    holders.back().join();
+    holders.pop_back();
+    release = true;
+    release.notify_all();
+    for (auto& t : holders) t.join();
+
+    REQUIRE(pending == 0);
+    REQUIRE(destroyed == 2);
+}
+
+TEST_CASE("EpochDomain: Retired nodes go back to their pool", "[ebr]") {
+    EpochDomain domain(4);
+    PoolAllocator<Node> pool(PoolOptions{ 32 });
+    Node::destroyed = 0;
+
+    // steady churn through the domain reuses blocks instead of growing the pool
+    for (int i = 0; i < 1000; ++i) {
+        EpochDomain::Guard guard(domain);
+        domain.retire(pool.create(i), pool);
+    }
+    domain.collect();
+    domain.collect();
+    REQUIRE(domain.pending() == 0);
+    REQUIRE(Node::destroyed == 1000);
+    REQUIRE(pool.pool().capacity() == 32);   // one slab
+
+    // arena nodes are only destroyed - the arena takes the memory back on reset
+    ArenaAllocator arena(4096);
+    {
+        ArenaScope scope(arena);
+        void* p = arena.allocate(sizeof(Node), alignof(Node));
+        domain.retire(::new (p) Node(7), EpochDomain::destroy_only);
+        domain.collect();
+        domain.collect();
+        domain.collect();
+    }
+    REQUIRE(Node::destroyed == 1001);
+}
+
+TEST_CASE("EpochDomain: A hazard pointer keeps its node without pinning the epoch", "[ebr]") {
+    EpochDomain domain(1);
+    Node::destroyed = 0;
+
+    std::atomic<Node*> slot{new Node(42)};
+    EpochDomain::HazardPointer hazard(domain);
+    Node* held = hazard.protect(slot);
+    REQUIRE(held->value == 42);
+
+    // unlinked and retired; the epoch runs on, but the node survives every flush
+    Node* const old = slot.exchange(new Node(43));
+    domain.retire(old);
+    uint64_t const before = domain.epoch();
+    for (int i = 0; i < 4; ++i) domain.collect();
+    REQUIRE(domain.epoch() > before + 2);
+    REQUIRE(Node::destroyed == 0);
+    REQUIRE(held->value == 42);
+
+    // protecting something else lets it go
+    held = hazard.protect(slot);
+    REQUIRE(held->value == 43);
+    domain.collect();
+    REQUIRE(Node::destroyed == 1);
+
+    hazard.reset();
+    delete slot.load();
+}
+
+TEST_CASE("EpochDomain: Hazard pointers are a bounded resource", "[ebr]") {
+    EpochDomain domain;
+    std::vector<std::unique_ptr<EpochDomain::HazardPointer>> held;
+    for (size_t i = 0; i < EpochDomain::hazard_slots; ++i) {
+        held.push_back(std::make_unique<EpochDomain::HazardPointer>(domain));
+    }
+    REQUIRE_THROWS_AS(EpochDomain::HazardPointer(domain), std::runtime_error);
+
+    held.pop_back();   // frees one up
+    EpochDomain::HazardPointer again(domain);
+}
+
+TEST_CASE("EpochDomain: Concurrent Treiber stack pops never touch freed nodes", "[ebr][thread]") {
+    constexpr size_t threads = 4;
+    constexpr uint64_t per_thread = 20'000;
+    Node::destroyed = 0;
+
+    std::atomic<int> errors{0};
+    std::atomic<uint64_t> sum{0};
+    {
+        PoolAllocator<Node> pool(PoolOptions{ 256, true });
+        {
+            EpochDomain domain(32);
+            Stack stack(domain, pool);
+
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    uint64_t popped = 0;
+                    uint64_t local = 0;
+                    for (uint64_t i = 0; i < per_thread; ++i) {
+                        stack.push(t * per_thread + i + 1);
+                        // pop about as often as we push so nodes are recycled through the pool
+                        uint64_t value = 0;
+                        if (stack.pop(value)) {
+                            if (value == 0 || value > threads * per_thread) errors.fetch_add(1);
+                            local += value;
+                            ++popped;
+                        }
+                    }
+                    sum.fetch_add(local);
+                });
+            }
+            for (auto& w : workers) w.join();
+
+            uint64_t value = 0;
+            while (stack.pop(value)) sum.fetch_add(value);
+        }
+        // the domain is gone, so every popped node has been handed back
+        REQUIRE(Node::destroyed == static_cast<int>(threads * per_thread));
+    }
+
+    REQUIRE(errors == 0);
+    uint64_t const n = threads * per_thread;
+    REQUIRE(sum == n * (n + 1) / 2);
+}
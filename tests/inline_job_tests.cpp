@@ -0,0 +1,155 @@
+#include <catch2/catch_test_macros.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <arena_allocator.h>
+#include <inline_job.h>
+#include <job_queue.h>
+#include <pool_allocator.h>
+#include <thread_pool.h>
+
+namespace {
+struct Tracked {
+    static inline int alive = 0;
+    static inline int calls = 0;
+    Tracked() { ++alive; }
+    Tracked(const Tracked&) { ++alive; }
+    Tracked(Tracked&&) noexcept { ++alive; }
+    ~Tracked() { --alive; }
+    void operator()() { ++calls; }
+};
+
+// a capture that counts its copies - a job that boxed or copied it on the way would show up here
+struct CountCopies {
+    static inline std::atomic<int> copies{0};
+    CountCopies() = default;
+    CountCopies(const CountCopies&) { copies.fetch_add(1, std::memory_order_relaxed); }
+    CountCopies(CountCopies&&) noexcept = default;
+};
+}
+
+TEST_CASE("InlineJob: one cache line, stores and runs the capture", "[inline_job]") {
+    STATIC_REQUIRE(sizeof(InlineJob<>) == 64);
+    STATIC_REQUIRE(InlineJob<>::capacity == 48);
+    STATIC_REQUIRE(InlineJob<>::fits<std::array<char, 48>>);
+    STATIC_REQUIRE_FALSE(InlineJob<>::fits<std::array<char, 49>>);
+    STATIC_REQUIRE_FALSE(std::is_copy_constructible_v<InlineJob<>>);
+
+    InlineJob<> empty;
+    REQUIRE_FALSE(empty);
+
+    int hits = 0;
+    std::array<int, 8> data{ 1, 2, 3, 4, 5, 6, 7, 8 };
+    InlineJob<> job([&hits, data] {
+        for (int v : data) hits += v;
+    });
+    REQUIRE(job);
+    job();
+    job();
+    REQUIRE(hits == 72);
+}
+
+TEST_CASE("InlineJob: moves relocate the callable, nothing is leaked or doubled", "[inline_job]") {
+    Tracked::alive = 0;
+    Tracked::calls = 0;
+    {
+        InlineJob<> a{ Tracked{} };
+        REQUIRE(Tracked::alive == 1);
+
+        InlineJob<> b(std::move(a));
+        REQUIRE_FALSE(a);
+        REQUIRE(b);
+        REQUIRE(Tracked::alive == 1);
+
+        InlineJob<> c;
+        c = std::move(b);
+        c();
+        REQUIRE(Tracked::calls == 1);
+
+        c = InlineJob<>{ Tracked{} };   // the old callable is destroyed first
+        REQUIRE(Tracked::alive == 1);
+
+        c.reset();
+        REQUIRE(Tracked::alive == 0);
+        REQUIRE_FALSE(c);
+        c = InlineJob<>{ Tracked{} };
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("InlineJob: move-only and non-trivial captures", "[inline_job]") {
+    auto value = std::make_unique<int>(5);
+    std::string text(100, 'x');   // heap-allocated string, moved not copied into the job
+    size_t seen = 0;
+
+    // 8 + 32 + 8 bytes of capture - right at the limit
+    InlineJob<> job([v = std::move(value), s = std::move(text), &seen] {
+        seen = static_cast<size_t>(*v) + s.size();
+    });
+    InlineJob<> moved(std::move(job));
+    moved();
+    REQUIRE(seen == 105);
+
+    // a queue of them - cells are moved in and out
+    JobQueue<InlineJob<>> q{4};
+    int total = 0;
+    for (int i = 1; i <= 4; ++i) {
+        REQUIRE(q.push(InlineJob<>([&total, i] { total += i; })));
+    }
+    InlineJob<> out;
+    while (q.pop(out)) out();
+    REQUIRE(total == 10);
+}
+
+TEST_CASE("InlineJob: warmed-up job blocks and queues are recycled, not grown", "[inline_job]") {
+    // the pool's job storage, with its slabs carved from an arena we can watch
+    ArenaAllocator arena(64 * 1024, ArenaGrowth{});
+    PoolAllocator<InlineJob<>> jobs(arena, PoolOptions{ .thread_safe = true });
+    GrowableJobQueue<InlineJob<>*> queue(64);
+    int count = 0;
+    std::array<void*, 4> captured{};   // a capture std::function would heap-allocate
+
+    auto round = [&](int n) {
+        for (int i = 0; i < n; ++i) {
+            REQUIRE(queue.push(jobs.create([&count, captured] { count += captured[0] == nullptr ? 1 : 0; })));
+        }
+        InlineJob<>* job = nullptr;
+        while (queue.pop(job)) {
+            (*job)();
+            jobs.destroy(job);
+        }
+    };
+
+    // the first round carves slabs and grows the queue as needed
+    round(2000);
+    size_t const arena_used = arena.used();
+    size_t const blocks = jobs.pool().capacity();
+    size_t const slots = queue.capacity();
+
+    round(1000);
+    REQUIRE(count == 3000);
+    REQUIRE(arena.used() == arena_used);
+    REQUIRE(jobs.pool().capacity() == blocks);
+    REQUIRE(queue.capacity() == slots);
+}
+
+TEST_CASE("InlineJob: ThreadPool moves captures into its jobs, never copies them", "[inline_job][thread_pool]") {
+    ThreadPool pool(2);
+    std::atomic<int> count{0};
+    CountCopies::copies = 0;
+
+    for (int i = 0; i < 1000; ++i) {
+        pool.submit([&count, c = CountCopies{}] {
+            (void)c;
+            count.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+    pool.wait();
+
+    REQUIRE(count.load() == 1000);
+    REQUIRE(CountCopies::copies.load() == 0);
+}
@@ -0,0 +1,206 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <arena_allocator.h>
+#include <io_buffer.h>
+#include <unique_buffer.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace {
+IoSlice text(std::string_view s) {
+    IoSlice slice = IoSlice::allocate(s.size());
+    std::memcpy(slice.mutable_bytes().data(), s.data(), s.size());
+    return slice;
+}
+
+std::string flatten(const IoChain& chain) {
+    std::string out(chain.size(), '\0');
+    chain.copy_to(std::as_writable_bytes(std::span(out)));
+    return out;
+}
+
+std::filesystem::path temp_file(const char* name, std::string_view contents) {
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream(path, std::ios::binary).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    return path;
+}
+}
+
+TEST_CASE("IoSlice: Copies and subslices share one block", "[io_buffer]") {
+    IoSlice whole = text("hello, world");
+    REQUIRE(whole.size() == 12);
+    REQUIRE(whole.use_count() == 1);
+    REQUIRE(whole.writable());
+
+    IoSlice world = whole.subslice(7);
+    REQUIRE(world.view() == "world");
+    REQUIRE(world.data() == whole.data() + 7);
+    REQUIRE(whole.use_count() == 2);
+
+    {
+        IoSlice copy = world;
+        REQUIRE(whole.use_count() == 3);
+        copy.remove_prefix(1);
+        copy.truncate(2);
+        REQUIRE(copy.view() == "or");
+    }
+    REQUIRE(whole.use_count() == 2);
+
+    // the block outlives the slice it was allocated through
+    whole.reset();
+    REQUIRE(whole.empty());
+    REQUIRE(world.use_count() == 1);
+    REQUIRE(world.view() == "world");
+
+    IoSlice moved = std::move(world);
+    REQUIRE(world.empty());
+    REQUIRE(moved.view() == "world");
+    REQUIRE(IoSlice().use_count() == 0);
+}
+
+TEST_CASE("IoSlice: adopt takes a UniqueBuffer over without copying", "[io_buffer]") {
+    auto buffer = UniqueBuffer<std::byte, UninitializedAlloc>::uninitialized(4096);
+    buffer[0] = std::byte{42};
+    const std::byte* const bytes = buffer.data();
+
+    IoSlice slice = IoSlice::adopt(std::move(buffer));
+    REQUIRE(buffer.data() == nullptr);
+    REQUIRE(slice.data() == bytes);
+    REQUIRE(slice.size() == 4096);
+    REQUIRE(slice.bytes()[0] == std::byte{42});
+}
+
+TEST_CASE("IoSlice: Arena slices live in the arena", "[io_buffer][arena]") {
+    ArenaAllocator arena(4096);
+    size_t const before = arena.used();
+    {
+        IoSlice slice = IoSlice::in_arena(arena, 256, 64);
+        REQUIRE(arena.used() >= before + 256);
+        REQUIRE(reinterpret_cast<uintptr_t>(slice.data()) % 64 == 0);
+        slice.mutable_bytes()[255] = std::byte{7};
+
+        IoSlice tail = slice.subslice(128);
+        REQUIRE(tail.use_count() == 2);
+        REQUIRE(tail.bytes()[127] == std::byte{7});
+    }
+    arena.reset();
+    REQUIRE(arena.used() == 0);
+}
+
+TEST_CASE("IoChain: split_front cuts without copying", "[io_buffer]") {
+    IoChain chain;
+    IoSlice a = text("GET /index");
+    IoSlice b = text(".html HTTP/1.1\r\n");
+    IoSlice c = text("Host: x\r\n\r\n");
+    chain.append(a);
+    chain.append(b);
+    chain.append(IoSlice());          // empty slices are dropped
+    chain.append(c);
+    REQUIRE(chain.slice_count() == 3);
+    REQUIRE(chain.size() == 10 + 16 + 11);
+    REQUIRE(flatten(chain) == "GET /index.html HTTP/1.1\r\nHost: x\r\n\r\n");
+
+    IoChain method = chain.split_front(4);
+    REQUIRE(flatten(method) == "GET ");
+    REQUIRE(method.slice(0).data() == a.data());
+
+    // straddles a and b: two views, both into the original blocks
+    IoChain path = chain.split_front(11);
+    REQUIRE(flatten(path) == "/index.html");
+    REQUIRE(path.slice_count() == 2);
+    REQUIRE(path.slice(0).data() == a.data() + 4);
+    REQUIRE(path.slice(1).data() == b.data());
+    REQUIRE(chain.slice(0).data() == b.data() + 5);
+
+    chain.drop_front(11);
+    REQUIRE(flatten(chain) == "Host: x\r\n\r\n");
+    REQUIRE(chain.slice_count() == 1);
+    REQUIRE(chain.slice(0).data() == c.data());
+
+    // a single slice coalesces for free, several get copied into one
+    REQUIRE(chain.coalesce().data() == c.data());
+    IoSlice joined = path.coalesce();
+    REQUIRE(joined.view() == "/index.html");
+    REQUIRE(joined.use_count() == 1);
+
+    std::byte partial[3];
+    REQUIRE(path.copy_to(partial, 5) == 3);
+    REQUIRE(std::string_view(reinterpret_cast<const char*>(partial), 3) == "x.h");
+
+    chain.drop_front(chain.size());
+    REQUIRE(chain.empty());
+    REQUIRE(chain.slice_count() == 0);
+}
+
+TEST_CASE("map_file: The file as a read-only slice", "[io_buffer]") {
+    std::string contents(100'000, '\0');
+    for (size_t i = 0; i < contents.size(); ++i) contents[i] = static_cast<char>('a' + i % 26);
+    auto const path = temp_file("cpp_refresh_map_file.bin", contents);
+
+    IoSlice middle;
+    {
+        IoSlice file = map_file(path, MapOptions{ .sequential = true });
+        REQUIRE(file.size() == contents.size());
+        REQUIRE_FALSE(file.writable());
+        REQUIRE(file.view() == contents);
+        middle = file.subslice(50'000, 26);
+    }
+    // still mapped - the subslice holds the view
+    REQUIRE(middle.view() == contents.substr(50'000, 26));
+    middle.reset();
+
+    auto const empty = temp_file("cpp_refresh_map_empty.bin", "");
+    REQUIRE(map_file(empty).empty());
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(empty);
+    REQUIRE_THROWS_AS(map_file(path), std::system_error);
+}
+
+#if !defined(_WIN32)
+TEST_CASE("IoChain: readv / writev scatter and gather through a pipe", "[io_buffer]") {
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+
+    IoChain out;
+    out.append(text("zero "));
+    out.append(text("copy "));
+    out.append(text("all the way"));
+    write_all(fds[1], out);
+    REQUIRE(out.size() == 21);          // write_all took its own copy of the chain
+
+    // read into two small blocks of our own
+    IoChain space;
+    space.append(IoSlice::allocate(8));
+    space.append(IoSlice::allocate(8));
+    const std::byte* const second = space.slice(1).data();
+    ssize_t const n = read_into(fds[0], space);
+    REQUIRE(n == 16);
+    IoChain got = space.split_front(static_cast<size_t>(n));
+    REQUIRE(flatten(got) == "zero copy all th");
+    REQUIRE(got.slice(1).data() == second);
+
+    IoChain rest;
+    REQUIRE(read_chain(fds[0], rest, 1024, 4) == 5);
+    REQUIRE(flatten(rest) == "e way");
+    REQUIRE(rest.slice_count() == 2);   // 4 + 1, the unread blocks are gone
+
+    ::close(fds[1]);
+    REQUIRE(read_chain(fds[0], rest, 1024) == 0);   // end of file
+    ::close(fds[0]);
+
+    REQUIRE(write_from(-1, out) == -1);
+    REQUIRE_THROWS_AS(write_all(-1, out), std::system_error);
+}
+#endif
@@ -0,0 +1,181 @@
+#include <catch2/catch_test_macros.hpp>
+#include <io_uring.h>
+
+#if defined(IO_URING_LINUX)
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <io_buffer.h>
+#include <thread_pool.h>
+
+namespace {
+// a temp file of n bytes, byte i == i * 7 mod 251
+int make_file(size_t n) {
+    char name[] = "/tmp/cpp_refresh_uring_XXXXXX";
+    int const fd = mkstemp(name);
+    unlink(name);
+    std::vector<unsigned char> bytes(n);
+    for (size_t i = 0; i < n; ++i) bytes[i] = static_cast<unsigned char>(i * 7 % 251);
+    REQUIRE(::write(fd, bytes.data(), n) == static_cast<ssize_t>(n));
+    return fd;
+}
+
+bool matches(const IoSlice& slice, size_t offset) {
+    for (size_t i = 0; i < slice.size(); ++i) {
+        if (slice.bytes()[i] != static_cast<std::byte>((offset + i) * 7 % 251)) return false;
+    }
+    return true;
+}
+}
+
+TEST_CASE("IoUring: Reads complete on pool workers", "[io_uring][thread_pool]") {
+    if (!IoUring::supported()) {
+        WARN("io_uring is not available here");
+        return;
+    }
+    constexpr size_t chunk = 64 * 1024;
+    constexpr size_t chunks = 32;
+    int const fd = make_file(chunk * chunks);
+
+    ThreadPool pool(2);
+    std::atomic<size_t> good{0};
+    std::atomic<size_t> bytes{0};
+    {
+        IoUring ring(pool, 8);   // fewer entries than reads - queueing has to flush on the way
+        for (size_t i = 0; i < chunks; ++i) {
+            ring.read(fd, i * chunk, chunk, [&, i](IoSlice data, int error) {
+                if (error == 0 && data.size() == chunk && matches(data, i * chunk)) good.fetch_add(1);
+                bytes.fetch_add(data.size());
+            });
+        }
+        while (ring.in_flight() > 0) ring.wait(4);
+        ring.drain();
+    }
+    ::close(fd);
+
+    REQUIRE(good == chunks);
+    REQUIRE(bytes == chunk * chunks);
+}
+
+TEST_CASE("IoUring: Gathered writes, reads into caller space, errors", "[io_uring][thread_pool]") {
+    if (!IoUring::supported()) {
+        WARN("io_uring is not available here");
+        return;
+    }
+    char name[] = "/tmp/cpp_refresh_uring_XXXXXX";
+    int const fd = mkstemp(name);
+    unlink(name);
+
+    ThreadPool pool(2);
+    IoUring ring(pool);
+
+    IoChain out;
+    for (const char* part : {"scatter ", "and ", "gather"}) {
+        IoSlice s = IoSlice::allocate(std::strlen(part));
+        std::memcpy(s.mutable_bytes().data(), part, s.size());
+        out.append(std::move(s));
+    }
+    std::atomic<size_t> written{0};
+    ring.write(fd, 0, out, [&](size_t n, int error) { if (error == 0) written = n; });
+    ring.drain();
+    REQUIRE(written == 18);
+
+    IoChain space;
+    space.append(IoSlice::allocate(10));
+    space.append(IoSlice::allocate(100));
+    std::string got;
+    std::mutex m;
+    ring.read_into(fd, 0, std::move(space), [&](IoChain filled, int error) {
+        std::scoped_lock lock(m);
+        if (error == 0) got = std::string(filled.coalesce().view());
+    });
+    ring.drain();
+    REQUIRE(got == "scatter and gather");
+
+    std::atomic<int> failure{0};
+    ring.read(-1, 0, 16, [&](IoSlice data, int error) { if (data.empty()) failure = error; });
+    ring.drain();
+    REQUIRE(failure == EBADF);
+    ::close(fd);
+}
+
+TEST_CASE("IoUring: wait() isn't starved by a concurrent poll()", "[io_uring][thread_pool][thread]") {
+    if (!IoUring::supported()) {
+        WARN("io_uring is not available here");
+        return;
+    }
+    constexpr size_t chunk = 4096;
+    constexpr size_t chunks = 256;
+    int const fd = make_file(chunk * chunks);
+
+    ThreadPool pool(2);
+    std::atomic<size_t> good{0};
+    {
+        IoUring ring(pool, 8);
+        std::atomic<bool> stop{false};
+        // reaps whatever shows up, racing the waiting thread for every completion
+        std::thread poller([&] {
+            while (!stop.load()) ring.poll();
+        });
+        for (size_t i = 0; i < chunks; ++i) {
+            ring.read(fd, i * chunk, chunk, [&, i](IoSlice data, int error) {
+                if (error == 0 && matches(data, i * chunk)) good.fetch_add(1);
+            });
+            ring.wait(1);   // would sleep forever if the poller reaped this read first
+        }
+        stop = true;
+        poller.join();
+        ring.drain();
+    }
+    ::close(fd);
+    REQUIRE(good == chunks);
+}
+
+TEST_CASE("IoUring: Callbacks can queue more I/O and drain() waits for all of it", "[io_uring][thread_pool][thread]") {
+    if (!IoUring::supported()) {
+        WARN("io_uring is not available here");
+        return;
+    }
+    constexpr size_t chunk = 4096;
+    constexpr size_t chunks = 64;
+    int const fd = make_file(chunk * chunks);
+
+    ThreadPool pool(2);
+    std::atomic<size_t> good{0};
+    {
+        IoUring ring(pool, 4);
+
+        // a sequential reader: each completion asks for the next chunk
+        struct Reader {
+            IoUring& ring;
+            int fd;
+            std::atomic<size_t>& good;
+
+            void next(size_t i) {
+                if (i == chunks) return;
+                ring.read(fd, i * chunk, chunk, [this, i](IoSlice data, int error) {
+                    if (error == 0 && matches(data, i * chunk)) good.fetch_add(1);
+                    next(i + 1);
+                });
+                ring.submit();
+            }
+        };
+        Reader reader{ring, fd, good};
+        reader.next(0);
+        ring.drain();
+        REQUIRE(ring.in_flight() == 0);
+    }
+    ::close(fd);
+    REQUIRE(good == chunks);
+}
+#endif
@@ -1,17 +1,16 @@
 // job_queue_tests.cpp
 // A rigorous test suite for a lock-free MPMC queue with work-stealing.
 //
-// To compile and run:
-// g++ -std=c++20 -O2 -pthread -I./include job_queue_tests.cpp -o tests && ./tests
-// (Assumes catch2/catch_test_macros.hpp is in ./include)
+// Built into the main test binary (see CMakeLists.txt), which provides main().
 
-#define CATCH_CONFIG_MAIN
 #include <catch2/catch_test_macros.hpp>
 #include <thread>
 #include <vector>
 #include <atomic>
 #include <numeric>
 #include <mutex>
+#include <memory>
+#include <string>
 #include <unordered_set>
 
 // The API being tested. Assumes job_queue.h is in ./include
@@ -132,7 +131,9 @@ TEST_CASE("JobQueue: Work-stealing simulation with multiple queues", "[work-stea
 {
     const std::size_t TASKS_PER_WORKER = STRESS_TEST_TASKS;
     const std::size_t TOTAL_TASKS = NUM_WORKERS * TASKS_PER_WORKER;
-    const std::size_t QUEUE_CAP = 2048;
+    // phase 1 pre-fills every queue before anyone consumes, so each one has to hold all of its
+    // worker's tasks - with less, the extra pushes fail and the workers wait forever
+    const std::size_t QUEUE_CAP = TASKS_PER_WORKER;
 
     // One queue per worker
     std::vector<JobQueue<Task>> queues;
@@ -263,4 +264,345 @@ TEST_CASE("JobQueue: Pop vs Steal race does not lose or duplicate tasks", "[conc
     stealer.join();
 
     REQUIRE(collected_tasks.size() == CAP);
-}
\ No newline at end of file
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Test 5: Capacity rounding, wrap-around and non-trivial payloads
+// ─────────────────────────────────────────────────────────────────────────────
+TEST_CASE("JobQueue: Capacity is a power of two", "[correctness]")
+{
+    REQUIRE(JobQueue<Task>{4}.capacity() == 4);
+    REQUIRE(JobQueue<Task>{5}.capacity() == 8);
+    REQUIRE(JobQueue<Task>{}.capacity() == 0);
+    REQUIRE(JobQueue<Task>{1}.capacity() == 2);
+
+    JobQueue<Task> empty;
+    Task out;
+    REQUIRE_FALSE(empty.push(1));
+    REQUIRE_FALSE(empty.pop(out));
+
+    JobQueue<Task> q{3};
+    for (Task t = 0; t < 4; ++t) REQUIRE(q.push(t));
+    REQUIRE_FALSE(q.push(4));
+    REQUIRE(q.size() == 4);
+
+    // many laps around the ring keep FIFO order
+    for (Task t = 4; t < 1000; ++t) {
+        REQUIRE(q.pop(out));
+        REQUIRE(out == t - 4);
+        REQUIRE(q.push(t));
+    }
+}
+
+TEST_CASE("JobQueue: Move-only and non-trivial payloads", "[correctness]")
+{
+    JobQueue<std::string> q{4};
+    REQUIRE(q.push(std::string(100, 'x')));
+    REQUIRE(q.push("short"));
+
+    std::string out;
+    REQUIRE(q.pop(out));
+    REQUIRE(out == std::string(100, 'x'));
+    REQUIRE(q.pop(out));
+    REQUIRE(out == "short");
+
+    JobQueue<std::unique_ptr<int>> owning{2};
+    REQUIRE(owning.push(std::make_unique<int>(7)));
+    std::unique_ptr<int> p;
+    REQUIRE(owning.pop(p));
+    REQUIRE(*p == 7);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Test 6: Producers racing on a tiny ring - every slot is contended every lap
+// ─────────────────────────────────────────────────────────────────────────────
+TEST_CASE("JobQueue: Tiny ring under producer and consumer contention", "[concurrency]")
+{
+    constexpr std::size_t PER_PRODUCER = 20'000;
+    const std::size_t TOTAL = NUM_PRODUCERS * PER_PRODUCER;
+    JobQueue<Task> q{2};
+
+    std::vector<std::atomic<int>> seen(TOTAL);
+    std::atomic<size_t> consumed{0};
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+
+    for (std::size_t p_id = 0; p_id < NUM_PRODUCERS; ++p_id) {
+        threads.emplace_back([&, p_id] {
+            for (Task i = 0; i < PER_PRODUCER; ++i) {
+                while (!q.push(p_id * PER_PRODUCER + i)) std::this_thread::yield();
+            }
+        });
+    }
+    for (std::size_t c_id = 0; c_id < NUM_WORKERS; ++c_id) {
+        threads.emplace_back([&] {
+            Task task;
+            while (consumed.load(std::memory_order_relaxed) < TOTAL) {
+                if (!q.pop(task)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (task >= TOTAL || seen[task].fetch_add(1) != 0) errors.fetch_add(1);
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    REQUIRE(errors.load() == 0);
+    REQUIRE(consumed.load() == TOTAL);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Test 7: Bulk push/pop
+// ─────────────────────────────────────────────────────────────────────────────
+TEST_CASE("JobQueue: Bulk push and pop keep order and respect capacity", "[correctness]")
+{
+    JobQueue<Task> q{8};
+    std::vector<Task> in{ 1, 2, 3, 4, 5 };
+    REQUIRE(q.push_bulk(in) == 5);
+    REQUIRE(q.push(6));
+
+    std::vector<Task> more{ 7, 8, 9, 10 };
+    REQUIRE(q.push_bulk(more) == 2);     // only two cells left
+    REQUIRE(q.push_bulk(more) == 0);
+    REQUIRE(q.size() == 8);
+
+    Task out[16] = {};
+    REQUIRE(q.pop_bulk(out, 3) == 3);
+    REQUIRE(out[0] == 1);
+    REQUIRE(out[2] == 3);
+
+    Task one;
+    REQUIRE(q.pop(one));
+    REQUIRE(one == 4);
+    REQUIRE(q.pop_bulk(out, 16) == 4);   // takes what there is
+    REQUIRE(out[0] == 5);
+    REQUIRE(out[3] == 8);
+    REQUIRE(q.pop_bulk(out, 16) == 0);
+
+    // wrap-around in the middle of a batch
+    std::vector<Task> lap{ 11, 12, 13, 14, 15, 16 };
+    REQUIRE(q.push_bulk(lap) == 6);
+    REQUIRE(q.pop_bulk(out, 6) == 6);
+    REQUIRE(out[5] == 16);
+
+    std::vector<std::string> strings{ "a", std::string(64, 'b') };
+    JobQueue<std::string> sq{4};
+    REQUIRE(sq.push_bulk(strings) == 2);
+    std::string sout[2];
+    REQUIRE(sq.pop_bulk(sout, 2) == 2);
+    REQUIRE(sout[1] == std::string(64, 'b'));
+}
+
+TEST_CASE("JobQueue: Bulk producers and consumers mixed with single ops", "[concurrency]")
+{
+    constexpr std::size_t PER_PRODUCER = 40'000;
+    constexpr std::size_t BATCH = 37;     // not a divisor of the ring, so batches wrap
+    const std::size_t TOTAL = NUM_PRODUCERS * PER_PRODUCER;
+    JobQueue<Task> q{256};
+
+    std::vector<std::atomic<int>> seen(TOTAL);
+    std::atomic<size_t> consumed{0};
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+
+    for (std::size_t p_id = 0; p_id < NUM_PRODUCERS; ++p_id) {
+        threads.emplace_back([&, p_id] {
+            std::vector<Task> batch;
+            Task next = p_id * PER_PRODUCER;
+            Task const end = next + PER_PRODUCER;
+            while (next < end) {
+                if (p_id % 2 == 0) {
+                    // bulk producer
+                    batch.clear();
+                    for (Task t = next; t < end && batch.size() < BATCH; ++t) batch.push_back(t);
+                    size_t const pushed = q.push_bulk(batch);
+                    next += pushed;
+                    if (pushed == 0) std::this_thread::yield();
+                } else if (q.push(next)) {
+                    ++next;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::size_t c_id = 0; c_id < NUM_WORKERS; ++c_id) {
+        threads.emplace_back([&, c_id] {
+            Task buffer[BATCH];
+            auto record = [&](Task task) {
+                if (task >= TOTAL || seen[task].fetch_add(1) != 0) errors.fetch_add(1);
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            };
+            while (consumed.load(std::memory_order_relaxed) < TOTAL) {
+                size_t got = 0;
+                if (c_id % 2 == 0) {
+                    got = q.pop_bulk(buffer, BATCH);
+                    for (size_t i = 0; i < got; ++i) record(buffer[i]);
+                } else if (q.pop(buffer[0])) {
+                    got = 1;
+                    record(buffer[0]);
+                }
+                if (got == 0) std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    REQUIRE(errors.load() == 0);
+    REQUIRE(consumed.load() == TOTAL);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Test 8: Closing and growable queues
+// ─────────────────────────────────────────────────────────────────────────────
+TEST_CASE("JobQueue: Close refuses pushes but still drains", "[correctness]")
+{
+    JobQueue<Task> q{4};
+    REQUIRE(q.push(1));
+    REQUIRE(q.push(2));
+    REQUIRE_FALSE(q.drained());
+
+    q.close();
+    REQUIRE(q.closed());
+    REQUIRE_FALSE(q.push(3));
+    std::vector<Task> more{ 4, 5 };
+    REQUIRE(q.push_bulk(more) == 0);
+    REQUIRE(q.size() == 2);
+
+    // a failed try_push leaves the item alone
+    auto s = std::make_unique<int>(7);
+    JobQueue<std::unique_ptr<int>> sq{2};
+    sq.close();
+    REQUIRE_FALSE(sq.try_push(s));
+    REQUIRE(s != nullptr);
+
+    Task out;
+    REQUIRE(q.pop(out));
+    REQUIRE(out == 1);
+    REQUIRE_FALSE(q.drained());
+    REQUIRE(q.pop(out));
+    REQUIRE(out == 2);
+    REQUIRE(q.drained());
+    REQUIRE_FALSE(q.pop(out));
+}
+
+TEST_CASE("GrowableJobQueue: Doubles when full and keeps FIFO order", "[correctness]")
+{
+    GrowableJobQueue<Task> q{2};
+    REQUIRE(q.capacity() == 2);
+
+    for (Task t = 0; t < 100; ++t) {
+        REQUIRE(q.push(t));
+    }
+    REQUIRE(q.size() == 100);
+    REQUIRE(q.capacity() >= 64);   // 2, 4, ... 128 - a fixed ring would have needed that up front
+
+    std::vector<Task> batch(50);
+    std::iota(batch.begin(), batch.end(), Task{100});
+    q.push_bulk(batch);
+    REQUIRE(q.size() == 150);
+
+    Task out[16];
+    Task expected = 0;
+    while (expected < 150) {
+        if (expected % 3 == 0) {
+            size_t const n = q.pop_bulk(out, 16);
+            REQUIRE(n > 0);
+            for (size_t i = 0; i < n; ++i) REQUIRE(out[i] == expected++);
+        } else {
+            REQUIRE(q.pop(out[0]));
+            REQUIRE(out[0] == expected++);
+        }
+    }
+    REQUIRE_FALSE(q.pop(out[0]));
+    REQUIRE(q.pop_bulk(out, 16) == 0);
+
+    // outgrown segments were retired as the head moved past them; with no other threads
+    // around, the epoch keeps moving and only the last retirements can still be pending
+    REQUIRE(q.pending_reclaim() <= 2);
+
+    // and it still works once settled on the big segment
+    REQUIRE(q.push(7));
+    REQUIRE(q.pop(out[0]));
+    REQUIRE(out[0] == 7);
+}
+
+TEST_CASE("GrowableJobQueue: Move-only payloads survive growth", "[correctness]")
+{
+    GrowableJobQueue<std::unique_ptr<int>> q{1};
+    for (int i = 0; i < 20; ++i) {
+        q.push(std::make_unique<int>(i));
+    }
+    std::unique_ptr<int> out;
+    for (int i = 0; i < 20; ++i) {
+        REQUIRE(q.pop(out));
+        REQUIRE(*out == i);
+    }
+    // leftovers in a queue that is destroyed mid-growth are released with it
+    for (int i = 0; i < 5; ++i) q.push(std::make_unique<int>(i));
+}
+
+TEST_CASE("GrowableJobQueue: Concurrent producers and consumers across growth", "[concurrency]")
+{
+    constexpr std::size_t PER_PRODUCER = 20'000;
+    const std::size_t TOTAL = NUM_PRODUCERS * PER_PRODUCER;
+    GrowableJobQueue<Task> q{2};   // grows several times while everyone is inside it
+
+    std::vector<std::atomic<int>> seen(TOTAL);
+    std::atomic<size_t> consumed{0};
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+
+    for (std::size_t p_id = 0; p_id < NUM_PRODUCERS; ++p_id) {
+        threads.emplace_back([&, p_id] {
+            std::vector<Task> batch;
+            for (Task i = 0; i < PER_PRODUCER; ++i) {
+                Task const task = p_id * PER_PRODUCER + i;
+                if (p_id % 2 == 0) {
+                    q.push(task);    // never fails, so no retry loop
+                    continue;
+                }
+                batch.push_back(task);
+                if (batch.size() == 16 || i + 1 == PER_PRODUCER) {
+                    q.push_bulk(batch);
+                    batch.clear();
+                }
+            }
+        });
+    }
+    for (std::size_t c_id = 0; c_id < NUM_WORKERS; ++c_id) {
+        threads.emplace_back([&, c_id] {
+            // per producer, one consumer must see that producer's items in increasing order
+            std::vector<Task> last(NUM_PRODUCERS, 0);
+            std::vector<bool> any(NUM_PRODUCERS, false);
+            Task buffer[8];
+            while (consumed.load(std::memory_order_relaxed) < TOTAL) {
+                size_t const got = c_id % 2 == 0 ? q.pop_bulk(buffer, 8) : (q.pop(buffer[0]) ? 1 : 0);
+                if (got == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t i = 0; i < got; ++i) {
+                    Task const task = buffer[i];
+                    if (task >= TOTAL || seen[task].fetch_add(1) != 0) {
+                        errors.fetch_add(1);
+                        continue;
+                    }
+                    size_t const producer = task / PER_PRODUCER;
+                    if (any[producer] && task <= last[producer]) errors.fetch_add(1);
+                    any[producer] = true;
+                    last[producer] = task;
+                }
+                consumed.fetch_add(got, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    REQUIRE(errors.load() == 0);
+    REQUIRE(consumed.load() == TOTAL);
+    REQUIRE(q.size() == 0);
+    REQUIRE(q.capacity() > 2);
+}
@@ -0,0 +1,155 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <job_trace.h>
+#include <thread_pool.h>
+
+namespace {
+size_t count(const std::string& text, const std::string& needle) {
+    size_t n = 0;
+    for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) ++n;
+    return n;
+}
+}
+
+TEST_CASE("TraceRing: Keeps the newest events, oldest first", "[job_trace]") {
+    TraceRing ring(5);                 // rounds up to 8
+    REQUIRE(ring.capacity() == 8);
+
+    for (uint32_t i = 0; i < 20; ++i) {
+        ring.record(TraceEvent{i, TraceEventKind::steal, 7, i, i * 2});
+    }
+    REQUIRE(ring.recorded() == 20);
+    REQUIRE(ring.overwritten() == 12);
+
+    std::vector<TraceEvent> events;
+    ring.snapshot(events);
+    REQUIRE(events.size() == 8);
+    for (size_t i = 0; i < events.size(); ++i) {
+        uint32_t const seq = static_cast<uint32_t>(12 + i);
+        REQUIRE(events[i].ticks == seq);
+        REQUIRE(events[i].kind == TraceEventKind::steal);
+        REQUIRE(events[i].arg0 == 7);
+        REQUIRE(events[i].arg1 == seq);
+        REQUIRE(events[i].arg2 == seq * 2);
+    }
+
+    // args saturate instead of spilling into their neighbours
+    ring.record(TraceEvent{0, TraceEventKind::steal, 0xffff, 5'000'000, 1});
+    events.clear();
+    ring.snapshot(events);
+    REQUIRE(events.back().arg0 == 0xffff);
+    REQUIRE(events.back().arg1 == 0xfffff);
+    REQUIRE(events.back().arg2 == 1);
+}
+
+TEST_CASE("TraceRing: A snapshot taken while the writer laps it stays in order", "[job_trace][thread]") {
+    TraceRing ring(64);
+    std::atomic<bool> done{false};
+    std::atomic<int> errors{0};
+
+    std::thread writer([&] {
+        for (uint32_t i = 0; i < 200'000; ++i) {
+            ring.record(TraceEvent{i, TraceEventKind::job_begin, 0, i & 0xfffff, 0});
+        }
+        done.store(true);
+    });
+
+    std::vector<TraceEvent> events;
+    while (!done.load()) {
+        events.clear();
+        ring.snapshot(events);
+        for (size_t i = 1; i < events.size(); ++i) {
+            // consecutive sequence numbers - nothing from a later lap slipped in
+            if (events[i].ticks != events[i - 1].ticks + 1) errors.fetch_add(1);
+            if (events[i].arg1 != (static_cast<uint32_t>(events[i].ticks) & 0xfffff)) errors.fetch_add(1);
+        }
+    }
+    writer.join();
+    REQUIRE(errors == 0);
+}
+
+TEST_CASE("JobTrace: Counters add up and the dump is a Chrome trace", "[job_trace]") {
+    JobTrace trace(2, 64);
+
+    trace.on_job_begin(0, 3);
+    trace.on_job_end(0);
+    trace.on_steal_failed(1, 1);
+    trace.on_steal(1, 0, 2, 4);
+    trace.on_job_begin(1, 0);
+    trace.on_job_end(1);
+    trace.on_park(1);
+    trace.on_unpark(1);
+    trace.on_job_begin(2, 0);          // a helping thread
+    trace.on_job_end(2);
+
+    JobTrace::Counters const one = trace.counters(1);
+    REQUIRE(one.jobs == 1);
+    REQUIRE(one.steal_attempts == 3);
+    REQUIRE(one.steals == 1);
+    REQUIRE(one.jobs_stolen == 4);
+    REQUIRE(one.parks == 1);
+    REQUIRE(trace.totals().jobs == 3);
+
+    std::ostringstream out;
+    trace.write_chrome_json(out);
+    std::string const json = out.str();
+
+    REQUIRE(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+    REQUIRE(json.ends_with("]}\n"));
+    REQUIRE(count(json, "\"name\":\"thread_name\"") == 3);
+    REQUIRE(json.find("\"name\":\"helping threads\"") != std::string::npos);
+    REQUIRE(count(json, "{\"ph\":\"B\",\"name\":\"job\"") == 3);
+    REQUIRE(count(json, "{\"ph\":\"E\",\"name\":\"job\"") == 3);
+    REQUIRE(json.find("\"args\":{\"victim\":0,\"attempts\":2,\"taken\":4}") != std::string::npos);
+    REQUIRE(json.find("\"name\":\"queue depth 0\"") != std::string::npos);
+    REQUIRE(json.find("\"args\":{\"depth\":3}") != std::string::npos);
+    REQUIRE(count(json, "\"name\":\"parked\"") == 2);
+    REQUIRE(count(json, "{") == count(json, "}"));
+}
+
+TEST_CASE("JobTrace: Slices cut off by the ring are not closed", "[job_trace]") {
+    JobTrace trace(1, 4);
+    trace.on_job_begin(0, 0);          // these two get overwritten...
+    trace.on_park(0);
+    trace.on_unpark(0);                // ...so this end and the next have no begin left
+    trace.on_job_end(0);
+    trace.on_job_begin(0, 0);
+    trace.on_job_end(0);
+
+    std::ostringstream out;
+    trace.write_chrome_json(out);
+    std::string const json = out.str();
+    REQUIRE(count(json, "\"name\":\"parked\"") == 0);
+    REQUIRE(count(json, "{\"ph\":\"B\",\"name\":\"job\"") == 1);
+    REQUIRE(count(json, "{\"ph\":\"E\",\"name\":\"job\"") == 1);
+}
+
+TEST_CASE("ThreadPool: trace() reflects CPP_REFRESH_JOB_TRACE", "[job_trace][thread_pool]") {
+    constexpr size_t jobs = 2000;
+    std::atomic<size_t> ran{0};
+    {
+        ThreadPool pool(2);
+        for (size_t i = 0; i < jobs; ++i) {
+            pool.submit([&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+        }
+        pool.wait();
+
+        std::ostringstream out;
+        pool.trace().write_chrome_json(out);
+        if constexpr (job_trace_enabled) {
+            // every job ran on a worker or on us in wait(), and left a slice behind
+            REQUIRE(pool.trace().totals().jobs == jobs);
+            REQUIRE(out.str().find("{\"ph\":\"B\",\"name\":\"job\"") != std::string::npos);
+        } else {
+            REQUIRE(out.str() == "{\"traceEvents\":[]}\n");
+        }
+    }
+    REQUIRE(ran == jobs);
+}
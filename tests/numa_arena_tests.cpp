@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <numa_arena.h>
+
+TEST_CASE("NumaArenaSet: topology is sane", "[numa]") {
+    REQUIRE(numa::node_count() >= 1);
+    REQUIRE(numa::current_node() < numa::node_count());
+    REQUIRE(numa::cached_current_node() < numa::node_count());
+}
+
+TEST_CASE("NumaArenaSet: allocations come from the caller's node", "[numa]") {
+    NumaArenaSet set(64 * 1024);
+    REQUIRE(set.node_count() == numa::node_count());
+
+    size_t const node = numa::cached_current_node();
+    void* p = set.allocate(128, 16);
+    REQUIRE(p != nullptr);
+    std::memset(p, 0x5a, 128);
+
+    REQUIRE(set.node_arena(node).used() >= 128);
+    REQUIRE(set.local_hits(node) == 1);
+    REQUIRE(set.total_remote_hits() == 0);
+
+    set.reset();
+    REQUIRE(set.node_arena(node).used() == 0);
+    REQUIRE(set.total_local_hits() == 1); // stats survive a reset
+    set.reset_stats();
+    REQUIRE(set.total_local_hits() == 0);
+}
+
+TEST_CASE("NumaArenaSet: explicit placement and spilling count as remote", "[numa]") {
+    NumaArenaSet set(4096, PageOptions{ PageBacking::pages });
+    size_t const local = numa::cached_current_node();
+
+    REQUIRE(set.allocate_on(set.node_count(), 8, 8) == nullptr);
+    REQUIRE(set.allocate_on(local, 8, 8) != nullptr);
+    REQUIRE(set.local_hits(local) == 1);
+
+    // fill the local arena; further requests go to the other nodes if there are any
+    REQUIRE(set.allocate(4096 - 8, 1) != nullptr);
+    void* spilled = set.allocate(64, 8);
+    if (set.node_count() == 1) {
+        REQUIRE(spilled == nullptr);
+        REQUIRE(set.total_remote_hits() == 0);
+    } else {
+        REQUIRE(spilled != nullptr);
+        REQUIRE(set.total_remote_hits() == 1);
+    }
+}
+
+TEST_CASE("NumaArenaSet: chained nodes grow locally under contention", "[numa][chained]") {
+    NumaArenaSet set(4096, ArenaGrowth{});
+    constexpr int threads = 4;
+    constexpr int per_thread = 5000;
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&set, &failures, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                auto* p = static_cast<uint32_t*>(set.allocate(sizeof(uint32_t) * 4, alignof(uint32_t)));
+                if (p == nullptr) {
+                    failures.fetch_add(1);
+                    continue;
+                }
+                p[0] = static_cast<uint32_t>(t);
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    REQUIRE(failures.load() == 0);
+    REQUIRE(set.total_local_hits() == threads * per_thread);
+    REQUIRE(set.total_remote_hits() == 0);
+}
@@ -0,0 +1,181 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <arena_allocator.h>
+#include <parallel_sort.h>
+#include <small_vector.h>
+#include <unique_buffer.h>
+
+namespace {
+template <typename T>
+std::vector<T> random_values(size_t n, uint32_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<T> v(n);
+    for (auto& x : v) x = static_cast<T>(rng());
+    return v;
+}
+}
+
+TEST_CASE("parallel_sort: integers sort like std::sort", "[parallel_sort]") {
+    ThreadPool pool(4);
+
+    for (size_t n : { size_t(0), size_t(1), size_t(2), size_t(1000), size_t(4097), size_t(200'000) }) {
+        auto v = random_values<uint32_t>(n, static_cast<uint32_t>(n));
+        auto expected = v;
+        std::sort(expected.begin(), expected.end());
+
+        parallel_sort(pool, v);
+        REQUIRE(v == expected);
+    }
+
+    SECTION("signed keys, negatives first") {
+        auto v = random_values<int64_t>(100'000, 7);
+        v.push_back(INT64_MIN);
+        v.push_back(INT64_MAX);
+        v.push_back(0);
+        v.push_back(-1);
+        auto expected = v;
+        std::sort(expected.begin(), expected.end());
+
+        parallel_sort(pool, v, std::less<>{}, nullptr, 1000);   // 100 chunks, an odd count
+        REQUIRE(v == expected);
+    }
+
+    SECTION("narrow keys and a pass count that ends in the scratch buffer") {
+        auto v = random_values<int8_t>(50'000, 3);
+        auto expected = v;
+        std::sort(expected.begin(), expected.end());
+        parallel_sort(pool, v);   // one pass: the result has to be moved back
+        REQUIRE(v == expected);
+    }
+
+    SECTION("all keys equal") {
+        std::vector<uint64_t> v(10'000, 42);
+        parallel_sort(pool, v);
+        REQUIRE(std::all_of(v.begin(), v.end(), [](uint64_t x) { return x == 42; }));
+    }
+}
+
+TEST_CASE("parallel_sort: merge sort for everything else", "[parallel_sort]") {
+    ThreadPool pool(4);
+
+    SECTION("descending doubles") {
+        auto v = random_values<uint64_t>(123'457, 11);
+        std::vector<double> d(v.begin(), v.end());
+        auto expected = d;
+        std::sort(expected.begin(), expected.end(), std::greater<>{});
+
+        parallel_sort(pool, d, std::greater<>{}, nullptr, 1000);
+        REQUIRE(d == expected);
+    }
+
+    SECTION("strings - non-trivial elements move through the scratch buffer") {
+        std::vector<std::string> s;
+        std::mt19937 rng(5);
+        for (int i = 0; i < 20'000; ++i) s.push_back("item " + std::to_string(rng() % 5000) + " of a list too long for SSO");
+        auto expected = s;
+        std::sort(expected.begin(), expected.end());
+
+        parallel_sort(pool, s, std::less<std::string>{}, nullptr, 512);
+        REQUIRE(s == expected);
+    }
+
+    SECTION("chunk count that isn't a power of two, with many duplicates") {
+        std::vector<int> v(30'001);
+        for (size_t i = 0; i < v.size(); ++i) v[i] = static_cast<int>((i * 7919) % 13);
+        auto expected = v;
+        std::sort(expected.begin(), expected.end(), std::greater<>{});
+        parallel_sort(pool, v, std::greater<>{}, nullptr, 1000);
+        REQUIRE(v == expected);
+    }
+}
+
+TEST_CASE("parallel_radix_sort: stable by key", "[parallel_sort]") {
+    ThreadPool pool(4);
+
+    struct Record {
+        uint16_t key;
+        uint32_t sequence;
+    };
+    std::vector<Record> records(60'000);
+    std::mt19937 rng(9);
+    for (uint32_t i = 0; i < records.size(); ++i) records[i] = {static_cast<uint16_t>(rng() % 300), i};
+
+    parallel_radix_sort(pool, records, [](const Record& r) { return r.key; }, nullptr, 2000);
+
+    bool ordered = true;
+    for (size_t i = 1; i < records.size(); ++i) {
+        auto const& a = records[i - 1];
+        auto const& b = records[i];
+        ordered &= a.key < b.key || (a.key == b.key && a.sequence < b.sequence);
+    }
+    REQUIRE(ordered);
+}
+
+namespace {
+struct ChunkInfo {
+    std::byte* begin;
+    std::byte* end;
+};
+}
+
+TEST_CASE("parallel sort + adjacent scan: the arena overlap audit", "[parallel_sort]") {
+    ThreadPool pool(4);
+    ArenaAllocator audited(4 * 1024 * 1024);
+    ArenaAllocator scratch(4 * 1024 * 1024);
+
+    SmallVector<ChunkInfo, 64> chunks;
+    std::mt19937 rng(1);
+    for (int i = 0; i < 50'000; ++i) {
+        size_t const size = 8 + rng() % 56;
+        auto* p = static_cast<std::byte*>(audited.allocate(size, 8));
+        REQUIRE(p != nullptr);
+        chunks.push_back({p, p + size});
+    }
+    std::shuffle(chunks.begin(), chunks.end(), rng);
+
+    auto overlaps = [](const ChunkInfo& a, const ChunkInfo& b) { return a.end > b.begin; };
+
+    size_t const scratch_before = scratch.used();
+    parallel_radix_sort(pool, chunks, [](const ChunkInfo& c) { return c.begin; }, &scratch);
+    REQUIRE(scratch.used() == scratch_before);   // the scope gave the scratch back
+
+    REQUIRE_FALSE(parallel_any_adjacent(pool, chunks, overlaps));
+    REQUIRE(parallel_is_sorted(pool, chunks, [](const auto& a, const auto& b) { return a.begin < b.begin; }));
+
+    // grow one record into its neighbour
+    chunks[30'000].end = chunks[30'001].begin + 1;
+    REQUIRE(parallel_any_adjacent(pool, chunks, overlaps));
+    REQUIRE(parallel_any_adjacent(pool, chunks, overlaps, 100));
+
+    SECTION("scratch really comes from the arena") {
+        ArenaAllocator tiny(1024);
+        std::shuffle(chunks.begin(), chunks.end(), rng);
+        REQUIRE_THROWS_AS(parallel_radix_sort(pool, chunks, [](const ChunkInfo& c) { return c.begin; }, &tiny),
+                          std::bad_alloc);
+    }
+}
+
+TEST_CASE("parallel_sort: UniqueBuffer ranges, arena scratch", "[parallel_sort]") {
+    ThreadPool pool(2);
+    ArenaAllocator scratch(1024 * 1024);
+
+    UniqueBuffer<float> values(50'000);
+    std::mt19937 rng(2);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<float>(rng() % 100'000) * 0.5f;
+
+    parallel_sort(pool, values, std::less<>{}, &scratch);
+    REQUIRE(parallel_is_sorted(pool, values));
+    REQUIRE(scratch.used() == 0);
+
+    REQUIRE_FALSE(parallel_is_sorted(pool, values, std::greater<>{}));
+    REQUIRE_FALSE(parallel_any_adjacent(pool, SmallVector<int, 1>{5}, std::less<>{}));
+}
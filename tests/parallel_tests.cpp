@@ -0,0 +1,166 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <parallel.h>
+#include <simd.h>
+#include <small_vector.h>
+#include <unique_buffer.h>
+
+TEST_CASE("parallel_for: covers every index exactly once", "[parallel]") {
+    ThreadPool pool(4);
+
+    for (size_t n : { size_t(0), size_t(1), size_t(4095), size_t(4096), size_t(4097), size_t(100'000) }) {
+        std::vector<std::atomic<int>> hits(n);
+        std::atomic<int> bad_ranges{0};
+        parallel_for(pool, n, [&](size_t first, size_t last) {
+            if (first >= last || last > n) bad_ranges.fetch_add(1);
+            for (size_t i = first; i < last; ++i) hits[i].fetch_add(1, std::memory_order_relaxed);
+        });
+
+        size_t wrong = 0;
+        for (auto& h : hits) wrong += h.load() != 1;
+        REQUIRE(wrong == 0);
+        REQUIRE(bad_ranges.load() == 0);
+    }
+
+    // an explicit grain is honoured
+    std::atomic<int> chunks{0};
+    parallel_for(pool, 1000, [&](size_t first, size_t last) {
+        if (last - first > 10) chunks.fetch_add(1000);
+        chunks.fetch_add(1);
+    }, 10);
+    REQUIRE(chunks.load() == 100);
+}
+
+TEST_CASE("parallel_for: nests inside pool jobs", "[parallel]") {
+    ThreadPool pool(3);
+    std::atomic<size_t> total{0};
+
+    parallel_for(pool, 8, [&](size_t first, size_t last) {
+        for (size_t outer = first; outer < last; ++outer) {
+            // runs on a worker (or the caller) and joins without parking it
+            parallel_for(pool, 10'000, [&](size_t a, size_t b) {
+                total.fetch_add(b - a, std::memory_order_relaxed);
+            }, 1000);
+        }
+    }, 1);
+    REQUIRE(total.load() == 8 * 10'000);
+}
+
+TEST_CASE("parallel_for: a throwing body waits for the running chunks, then rethrows", "[parallel]") {
+    ThreadPool pool(4);
+    std::atomic<size_t> ran{0};
+
+    // chunk 0 runs on the caller: its frame must not unwind while pool chunks still use it
+    auto throws_at_zero = [&](size_t first, size_t) {
+        if (first == 0) throw std::runtime_error("chunk 0");
+        ran.fetch_add(1);
+    };
+    REQUIRE_THROWS_AS(parallel_for(pool, size_t(1) << 16, throws_at_zero, 1024), std::runtime_error);
+
+    // and from a worker's chunk
+    auto throws_late = [&](size_t first, size_t) {
+        if (first == 40 * 1024) throw std::logic_error("chunk 40");
+        ran.fetch_add(1);
+    };
+    REQUIRE_THROWS_AS(parallel_for(pool, size_t(1) << 16, throws_late, 1024), std::logic_error);
+    REQUIRE(ran <= 2 * 63);
+
+    // the pool is still fine afterwards
+    std::atomic<size_t> covered{0};
+    parallel_for(pool, 10'000, [&](size_t first, size_t last) { covered.fetch_add(last - first); }, 100);
+    REQUIRE(covered == 10'000);
+}
+
+TEST_CASE("parallel_reduce: matches a serial fold", "[parallel]") {
+    ThreadPool pool(4);
+
+    UniqueBuffer<uint64_t> values(250'000);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = i * 7 + 3;
+    uint64_t const expected = std::accumulate(values.data(), values.data() + values.size(), uint64_t{0});
+
+    REQUIRE(parallel_reduce(pool, values, uint64_t{0}) == expected);
+    REQUIRE(parallel_reduce(pool, values, uint64_t{5}, std::plus<>{}, 1) == expected + 5);
+
+    std::vector<int> none;
+    REQUIRE(parallel_reduce(pool, none, 42) == 42);
+
+    // max isn't a sum - and with an empty chunk there'd be nothing to seed it with
+    REQUIRE(parallel_reduce(pool, values, uint64_t{0}, [](uint64_t a, uint64_t b) { return std::max(a, b); }) ==
+            values[values.size() - 1]);
+}
+
+TEST_CASE("parallel_reduce: order is fixed, so non-commutative ops and floats reproduce", "[parallel]") {
+    ThreadPool pool(4);
+
+    // string concatenation is associative but not commutative
+    std::vector<std::string> letters;
+    std::string expected;
+    for (int i = 0; i < 20'000; ++i) {
+        letters.push_back(std::string(1, static_cast<char>('a' + i % 26)));
+        expected += letters.back();
+    }
+    REQUIRE(parallel_reduce(pool, letters, std::string(">"), std::plus<>{}, 500) == ">" + expected);
+
+    // float rounding depends on the order of the additions - same grain, same bits, every run and
+    // on any pool size
+    SmallVector<float, 8> v;
+    for (size_t i = 0; i < 1'000'000; ++i) v.push_back(1.0f / static_cast<float>(i % 1000 + 1));
+    float const first = parallel_reduce(pool, v, 0.0f, std::plus<>{}, 10'000);
+    bool identical = true;
+    for (int run = 0; run < 20; ++run) {
+        identical = identical && parallel_reduce(pool, v, 0.0f, std::plus<>{}, 10'000) == first;
+    }
+    ThreadPool single(1);
+    identical = identical && parallel_reduce(single, v, 0.0f, std::plus<>{}, 10'000) == first;
+    REQUIRE(identical);
+}
+
+TEST_CASE("parallel_inclusive_scan: matches std::inclusive_scan", "[parallel]") {
+    ThreadPool pool(4);
+
+    for (size_t n : { size_t(1), size_t(5000), size_t(123'457) }) {
+        std::vector<int64_t> in(n);
+        for (size_t i = 0; i < n; ++i) in[i] = static_cast<int64_t>(i % 17) - 8;
+        std::vector<int64_t> expected(n);
+        std::inclusive_scan(in.begin(), in.end(), expected.begin());
+
+        std::vector<int64_t> out(n);
+        parallel_inclusive_scan(pool, in, out);
+        REQUIRE(out == expected);
+
+        // in place, with a small explicit grain so there are many chunks
+        parallel_inclusive_scan(pool, in, in, std::plus<>{}, 100);
+        REQUIRE(in == expected);
+    }
+
+    std::vector<std::string> words{ "a", "b", "c", "d", "e" };
+    std::vector<std::string> prefixes(words.size());
+    parallel_inclusive_scan(pool, words, prefixes, std::plus<>{}, 2);
+    REQUIRE(prefixes.back() == "abcde");
+    REQUIRE(prefixes[2] == "abc");
+}
+
+TEST_CASE("parallel_reduce_chunks: hands whole chunks to a kernel", "[parallel]") {
+    ThreadPool pool(4);
+    std::vector<float> v(100'000, 0.5f);
+
+    std::atomic<int> chunks{0};
+    float const total = parallel_reduce_chunks(pool, v, 0.0f, [&](std::span<const float> chunk) {
+        chunks.fetch_add(1);
+        return simd::sum(chunk);
+    }, std::plus<>{}, 10'000);
+
+    REQUIRE(chunks.load() == 10);
+    REQUIRE(total == 50'000.0f);
+    // same chunks, same order, same kernel - same bits
+    REQUIRE(parallel_reduce_chunks(pool, v, 0.0f, [](std::span<const float> c) { return simd::sum(c); }, std::plus<>{}, 10'000) == total);
+}
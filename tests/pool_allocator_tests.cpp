@@ -0,0 +1,199 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pool_allocator.h>
+
+namespace {
+struct JobRecord {
+    uint64_t id;
+    std::string name;
+    JobRecord* next = nullptr;
+
+    JobRecord(uint64_t i, std::string n) : id(i), name(std::move(n)) {}
+};
+}
+
+TEST_CASE("FixedPool: Blocks are distinct, aligned and reused LIFO", "[pool_allocator]") {
+    FixedPool pool(24, 8, PoolOptions{ 16 });
+    REQUIRE(pool.block_size() == 24);
+
+    std::set<void*> seen;
+    for (int i = 0; i < 40; ++i) {
+        void* p = pool.allocate();
+        REQUIRE(p != nullptr);
+        REQUIRE(reinterpret_cast<uintptr_t>(p) % 8 == 0);
+        REQUIRE(seen.insert(p).second);
+    }
+
+    void* last = *seen.begin();
+    pool.deallocate(last);
+    REQUIRE(pool.allocate() == last);
+}
+
+TEST_CASE("FixedPool: Tiny blocks are rounded up to hold a free-list node", "[pool_allocator]") {
+    FixedPool pool(1, 1);
+    REQUIRE(pool.block_size() >= sizeof(void*));
+    void* a = pool.allocate();
+    void* b = pool.allocate();
+    REQUIRE(static_cast<std::byte*>(b) - static_cast<std::byte*>(a) == static_cast<ptrdiff_t>(pool.block_size()));
+}
+
+TEST_CASE("FixedPool: Steady churn never grows the pool", "[pool_allocator]") {
+    FixedPool pool(64, 16, PoolOptions{ 32 });
+    std::vector<void*> live;
+    for (int i = 0; i < 32; ++i) live.push_back(pool.allocate());
+    size_t const capacity = pool.capacity();
+
+    for (int round = 0; round < 1000; ++round) {
+        pool.deallocate(live[round % live.size()]);
+        live[round % live.size()] = pool.allocate();
+        REQUIRE(live[round % live.size()] != nullptr);
+    }
+    REQUIRE(pool.capacity() == capacity);
+}
+
+TEST_CASE("FixedPool: Arena-backed slabs stop when the arena runs out", "[pool_allocator]") {
+    // room for one 32 block slab plus alignment padding, but never a second slab
+    ArenaAllocator arena(64 * 32 + 63);
+    FixedPool pool(arena, 64, 64, PoolOptions{ 32 });
+
+    std::vector<void*> blocks;
+    while (void* p = pool.allocate()) blocks.push_back(p);
+    REQUIRE(blocks.size() == 32);
+    REQUIRE(pool.capacity() == 32);
+
+    // frees make blocks available again without going back to the arena
+    pool.deallocate(blocks.back());
+    REQUIRE(pool.allocate() == blocks.back());
+}
+
+TEST_CASE("PoolAllocator: create/destroy run constructors and destructors", "[pool_allocator]") {
+    PoolAllocator<JobRecord> pool;
+    JobRecord* a = pool.create(1, "first");
+    JobRecord* b = pool.create(2, "second");
+    REQUIRE(a->id == 1);
+    REQUIRE(b->name == "second");
+    pool.destroy(a);
+    JobRecord* c = pool.create(3, "third");
+    REQUIRE(c == a);
+    REQUIRE(c->name == "third");
+    pool.destroy(b);
+    pool.destroy(c);
+}
+
+TEST_CASE("SizeClassAllocator: Requests map to power of two classes", "[pool_allocator]") {
+    REQUIRE(SizeClassAllocator::class_of(1) == 0);
+    REQUIRE(SizeClassAllocator::class_of(16) == 0);
+    REQUIRE(SizeClassAllocator::class_of(17) == 1);
+    REQUIRE(SizeClassAllocator::class_of(1024) == 6);
+
+    SizeClassAllocator classes;
+    void* small = classes.allocate(10);
+    void* mid = classes.allocate(200);
+    REQUIRE(small != nullptr);
+    REQUIRE(mid != nullptr);
+    REQUIRE(classes.allocate(4096) == nullptr);
+
+    classes.deallocate(mid, 200);
+    REQUIRE(classes.allocate(256) == mid); // same class, same block
+    classes.deallocate(small, 10);
+}
+
+TEST_CASE("FixedPool: Thread-safe pool survives cross-thread frees", "[pool_allocator][thread]") {
+    PoolOptions options;
+    options.thread_safe = true;
+    options.blocks_per_slab = 128;
+    options.magazine_size = 16;
+    FixedPool pool(32, 8, options);
+
+    const unsigned P = std::max(2u, std::thread::hardware_concurrency());
+    constexpr size_t PER_THREAD = 20'000;
+
+    // each producer allocates and stamps blocks; the consumer on the other side frees them, so
+    // every block is freed on a different thread than the one that allocated it
+    std::vector<std::vector<uint64_t*>> handoff(P);
+    std::vector<std::thread> producers;
+    for (unsigned t = 0; t < P; ++t) {
+        producers.emplace_back([&, t] {
+            for (size_t n = 0; n < PER_THREAD; ++n) {
+                auto* p = static_cast<uint64_t*>(pool.allocate());
+                REQUIRE(p != nullptr);
+                *p = (uint64_t(t) << 32) | n;
+                handoff[t].push_back(p);
+            }
+        });
+    }
+    for (auto& th : producers) th.join();
+
+    // no two live blocks may alias - every stamp is still intact
+    for (unsigned t = 0; t < P; ++t) {
+        for (size_t n = 0; n < PER_THREAD; ++n) {
+            REQUIRE(*handoff[t][n] == ((uint64_t(t) << 32) | n));
+        }
+    }
+
+    std::vector<std::thread> freers;
+    for (unsigned t = 0; t < P; ++t) {
+        freers.emplace_back([&, t] {
+            for (uint64_t* p : handoff[(t + 1) % P]) pool.deallocate(p);
+        });
+    }
+    for (auto& th : freers) th.join();
+
+    size_t const capacity = pool.capacity();
+
+    // everything freed is reachable again through the magazines and the shared stack
+    std::atomic<size_t> total{0};
+    std::vector<std::thread> again;
+    for (unsigned t = 0; t < P; ++t) {
+        again.emplace_back([&] {
+            std::vector<void*> mine;
+            for (size_t n = 0; n < PER_THREAD; ++n) mine.push_back(pool.allocate());
+            total.fetch_add(mine.size());
+            for (void* p : mine) pool.deallocate(p);
+        });
+    }
+    for (auto& th : again) th.join();
+
+    REQUIRE(total.load() == P * PER_THREAD);
+    // magazines can strand at most a magazine's worth per thread, so growth stays bounded
+    REQUIRE(pool.capacity() <= capacity + P * options.magazine_size + options.blocks_per_slab);
+}
+
+TEST_CASE("FixedPool: Concurrent churn never hands a block out twice", "[pool_allocator][thread]") {
+    PoolOptions options;
+    options.thread_safe = true;
+    options.magazine_size = 8;
+    FixedPool pool(sizeof(std::atomic<uint32_t>), alignof(std::atomic<uint32_t>), options);
+
+    const unsigned P = std::max(2u, std::thread::hardware_concurrency());
+    std::atomic<bool> duplicate{false};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < P; ++t) {
+        threads.emplace_back([&, t] {
+            std::vector<uint32_t*> held;
+            for (uint32_t n = 0; n < 50'000; ++n) {
+                auto* p = static_cast<uint32_t*>(pool.allocate());
+                *p = t;
+                held.push_back(p);
+                if (held.size() == 12) {
+                    for (uint32_t* h : held) {
+                        if (*h != t) duplicate = true;
+                        pool.deallocate(h);
+                    }
+                    held.clear();
+                }
+            }
+            for (uint32_t* h : held) pool.deallocate(h);
+        });
+    }
+    for (auto& th : threads) th.join();
+    REQUIRE_FALSE(duplicate.load());
+}
@@ -0,0 +1,113 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include <simd.h>
+#include <small_vector.h>
+#include <unique_buffer.h>
+
+namespace {
+std::vector<float> sample(size_t n) {
+    std::vector<float> v(n);
+    for (size_t i = 0; i < n; ++i) v[i] = static_cast<float>((i * 7919) % 1000) / 997.0f - 0.4f;
+    return v;
+}
+
+// double precision, so it is a yardstick rather than another rounding
+double reference_sum(const std::vector<float>& v) {
+    double total = 0;
+    for (float f : v) total += f;
+    return total;
+}
+
+constexpr simd::Isa all_isas[] = { simd::Isa::scalar, simd::Isa::sse2, simd::Isa::avx2, simd::Isa::avx512, simd::Isa::neon };
+}
+
+TEST_CASE("simd: sum, dot, min and max are correct for every size", "[simd]") {
+    for (size_t n : { size_t(0), size_t(1), size_t(31), size_t(32), size_t(33), size_t(1000), size_t(100'003) }) {
+        auto const v = sample(n);
+        auto const w = sample(n + 5);   // different values at each index
+
+        double dot_ref = 0;
+        for (size_t i = 0; i < n; ++i) dot_ref += double(v[i]) * double(w[i]);
+
+        REQUIRE(std::abs(simd::sum(v) - reference_sum(v)) <= 1e-3 * (1 + std::abs(reference_sum(v))));
+        REQUIRE(std::abs(simd::dot(std::span<const float>(v), std::span<const float>(w.data(), n)) - dot_ref) <= 1e-3 * (1 + std::abs(dot_ref)));
+
+        float const lo = n == 0 ? std::numeric_limits<float>::infinity() : *std::min_element(v.begin(), v.end());
+        float const hi = n == 0 ? -std::numeric_limits<float>::infinity() : *std::max_element(v.begin(), v.end());
+        REQUIRE(simd::min(v) == lo);
+        REQUIRE(simd::max(v) == hi);
+    }
+}
+
+TEST_CASE("simd: every code path gives bit-identical results", "[simd]") {
+    auto const v = sample(100'003);
+    auto const w = sample(100'010);
+    std::span<const float> a(v), b(w.data(), v.size());
+
+    simd::Kernels const scalar = simd::kernels(simd::Isa::scalar);
+    float const sum = simd::sum(a, scalar);
+    float const dot = simd::dot(a, b, scalar);
+    float const lo = simd::min(a, scalar);
+    float const hi = simd::max(a, scalar);
+
+    for (simd::Isa isa : all_isas) {
+        if (!simd::supported(isa)) continue;
+        simd::Kernels const k = simd::kernels(isa);
+        REQUIRE(k.isa == isa);
+        REQUIRE(simd::sum(a, k) == sum);
+        REQUIRE(simd::dot(a, b, k) == dot);
+        REQUIRE(simd::min(a, k) == lo);
+        REQUIRE(simd::max(a, k) == hi);
+    }
+
+    REQUIRE(simd::supported(simd::Isa::scalar));
+    REQUIRE(simd::supported(simd::active().isa));
+    // asking for something this machine can't run falls back instead of crashing
+    for (simd::Isa isa : all_isas) {
+        if (!simd::supported(isa)) REQUIRE(simd::kernels(isa).isa == simd::Isa::scalar);
+    }
+}
+
+TEST_CASE("simd: dot rounds every product on every path", "[simd]") {
+    // a fused multiply-add would keep the product's low bits and only lose them in the sum:
+    // (1 + 2^-12)^2 - 1 is 2^-11 + 2^-24 exact, 2^-11 with the product rounded first
+    std::vector<float> a(64, 0.0f), b(64, 0.0f);
+    a[0] = -1.0f;
+    b[0] = 1.0f;
+    a[32] = b[32] = 1.0f + 1.0f / 4096;
+
+    for (simd::Isa isa : all_isas) {
+        if (!simd::supported(isa)) continue;
+        REQUIRE(simd::dot(std::span<const float>(a), std::span<const float>(b), simd::kernels(isa)) == 1.0f / 2048);
+    }
+}
+
+TEST_CASE("simd: map_reduce fuses a transform into the sum", "[simd]") {
+    auto const v = sample(5000);
+    REQUIRE(simd::map_reduce(v, [](float x) { return x; }) == simd::sum(v));
+
+    double squares = 0;
+    for (float f : v) squares += double(f) * double(f);
+    float const fused = simd::map_reduce(std::span<const float>(v), [](float x) { return x * x; });
+    REQUIRE(std::abs(fused - squares) <= 1e-3 * squares);
+}
+
+TEST_CASE("simd: works over SmallVector and UniqueBuffer", "[simd]") {
+    SmallVector<float, 8> small;
+    for (int i = 1; i <= 100; ++i) small.push_back(static_cast<float>(i));
+    REQUIRE(simd::sum(small) == 5050.0f);
+    REQUIRE(simd::max(small) == 100.0f);
+
+    UniqueBuffer<float> buffer(64);
+    for (size_t i = 0; i < buffer.size(); ++i) buffer[i] = 2.0f;
+    REQUIRE(simd::dot(buffer, buffer) == 256.0f);
+    REQUIRE(simd::min(buffer) == 2.0f);
+    REQUIRE(simd::map_reduce(buffer, [](float x) { return x + 1; }) == 192.0f);
+}
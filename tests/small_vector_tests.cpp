@@ -1,8 +1,12 @@
 // tests/small_vector_tests.cpp
 #include <catch2/catch_test_macros.hpp>
 #include <small_vector.h> // You will create this
+#include <arena_allocator.h>
+#include <cstdint>
+#include <memory>
 #include <string>         // For testing with a type that has move/copy/dtor
 #include <stdexcept>      // For std::out_of_range
+#include <vector>
 
 // A simple struct to track constructions, destructions, copies, moves
 struct Tracker {
@@ -453,11 +457,282 @@ TEST_CASE("SmallVector: std::vector<Tracker> - push_back vs emplace_back", "[std
     }
 }
 
+TEST_CASE("SmallVector: emplace_back constructs in place (Tracker, N=1)", "[small_vector]") {
+    Tracker::reset_counts();
+    SmallVector<Tracker, 1> sv;
+
+    Tracker& first = sv.emplace_back(1);
+    REQUIRE(&first == &sv[0]);
+    REQUIRE(Tracker::constructions == 1);
+    REQUIRE(Tracker::moves == 0);
+    REQUIRE(Tracker::copies == 0);
+
+    // growing moves the old element, but the new one is still built right in the new block
+    Tracker& second = sv.emplace_back(2);
+    REQUIRE_FALSE(sv.on_stack());
+    REQUIRE(&second == &sv[1]);
+    REQUIRE(Tracker::constructions == 2);
+    REQUIRE(Tracker::moves == 1);
+    REQUIRE(Tracker::copies == 0);
+    REQUIRE(sv[0].id == 1);
+    REQUIRE(sv[1].id == 2);
+}
+
+TEST_CASE("SmallVector: push_back forwards on the heap path", "[small_vector]") {
+    Tracker::reset_counts();
+    SmallVector<Tracker, 1> sv = {Tracker(1), Tracker(2)};   // on heap, capacity 2
+    sv.reserve(4);
+    Tracker::reset_counts();
+
+    sv.push_back(Tracker(3));
+    REQUIRE(Tracker::copies == 0);
+    REQUIRE(Tracker::moves == 1);
+
+    Tracker lvalue(4);
+    sv.push_back(lvalue);
+    REQUIRE(Tracker::copies == 1);
+    REQUIRE(sv[3].id == 4);
+}
+
+TEST_CASE("SmallVector: pushing one of its own elements while growing", "[small_vector]") {
+    SECTION("from the inline storage") {
+        SmallVector<std::string, 2> sv = {"first, long enough not to fit in the SSO buffer", "second"};
+        sv.push_back(sv[0]);
+        REQUIRE(sv.size() == 3);
+        REQUIRE(sv[2] == sv[0]);
+    }
+
+    SECTION("trivially copyable, through realloc") {
+        SmallVector<int, 1> sv = {7, 8};
+        REQUIRE(sv.capacity() == 2);
+        sv.push_back(sv[0]);
+        sv.emplace_back(sv[1]);
+        REQUIRE_FALSE(sv.on_stack());
+        REQUIRE(sv[2] == 7);
+        REQUIRE(sv[3] == 8);
+    }
+}
+
+TEST_CASE("SmallVector: reserve", "[small_vector]") {
+    SmallVector<int, 4> sv = {1, 2, 3};
+
+    sv.reserve(2);  // never shrinks
+    REQUIRE(sv.capacity() == 4);
+    REQUIRE(sv.on_stack());
+
+    sv.reserve(100);
+    REQUIRE(sv.capacity() == 100);
+    REQUIRE_FALSE(sv.on_stack());
+    REQUIRE(sv.size() == 3);
+    REQUIRE(sv[0] == 1);
+    REQUIRE(sv[2] == 3);
+
+    int* block = sv.data();
+    for (int i = 3; i < 100; ++i) sv.push_back(i + 1);
+    REQUIRE(sv.data() == block);   // no regrowth up to the reserved capacity
+    REQUIRE(sv[99] == 100);
+}
+
+TEST_CASE("SmallVector: resize", "[small_vector]") {
+    SECTION("grow with value-initialized elements, onto the heap") {
+        SmallVector<int, 2> sv = {5};
+        sv.resize(4);
+        REQUIRE(sv.size() == 4);
+        REQUIRE_FALSE(sv.on_stack());
+        REQUIRE(sv[0] == 5);
+        REQUIRE(sv[1] == 0);
+        REQUIRE(sv[3] == 0);
+    }
+
+    SECTION("grow with a value") {
+        SmallVector<std::string, 2> sv(1, "x");
+        sv.resize(3, "y");
+        REQUIRE(sv.size() == 3);
+        REQUIRE(sv[0] == "x");
+        REQUIRE(sv[1] == "y");
+        REQUIRE(sv[2] == "y");
+
+        sv.resize(6, sv[0]);   // the value lives in the block being outgrown
+        REQUIRE(sv[5] == "x");
+    }
+
+    SECTION("shrink destroys the tail and keeps the storage") {
+        Tracker::reset_counts();
+        SmallVector<Tracker, 2> sv(4, Tracker(9));
+        size_t const capacity = sv.capacity();
+        Tracker::reset_counts();
+
+        sv.resize(1);
+        REQUIRE(sv.size() == 1);
+        REQUIRE(Tracker::destructions == 3);
+        REQUIRE(sv.capacity() == capacity);
+        REQUIRE(sv[0].id == 9);
+    }
+}
+
+TEST_CASE("SmallVector: insert and emplace", "[small_vector]") {
+    SECTION("ints - front, middle, back, growing") {
+        SmallVector<int, 3> sv = {2, 4};
+        sv.insert(sv.begin(), 1);
+        sv.insert(sv.begin() + 2, 3);   // grows
+        int* last = sv.insert(sv.end(), 5);
+        REQUIRE(*last == 5);
+        REQUIRE(sv.size() == 5);
+        for (int i = 0; i < 5; ++i) REQUIRE(sv[i] == i + 1);
+    }
+
+    SECTION("strings - non-trivial elements shift by moves") {
+        SmallVector<std::string, 2> sv = {"a", "c"};
+        std::string* b = sv.emplace(sv.begin() + 1, 1, 'b');
+        REQUIRE(*b == "b");
+        sv.insert(sv.begin(), sv[2]);   // a copy of one of our own elements
+        REQUIRE(sv.size() == 4);
+        REQUIRE(sv[0] == "c");
+        REQUIRE(sv[1] == "a");
+        REQUIRE(sv[2] == "b");
+        REQUIRE(sv[3] == "c");
+    }
+
+    SECTION("count copies") {
+        SmallVector<int, 4> sv = {1, 5};
+        int* first = sv.insert(sv.begin() + 1, 3, 0);
+        REQUIRE(first == sv.begin() + 1);
+        REQUIRE(sv.size() == 5);
+        int const expected[] = {1, 0, 0, 0, 5};
+        for (int i = 0; i < 5; ++i) REQUIRE(sv[i] == expected[i]);
+    }
+}
+
+TEST_CASE("SmallVector: move-only elements", "[small_vector]") {
+    SmallVector<std::unique_ptr<int>, 2> sv;
+    for (int i = 0; i < 5; ++i) sv.push_back(std::make_unique<int>(i));
+    sv.insert(sv.begin(), std::make_unique<int>(-1));
+    REQUIRE(sv.size() == 6);
+    REQUIRE(*sv[0] == -1);
+    REQUIRE(*sv[5] == 4);
+
+    SmallVector<std::unique_ptr<int>, 2> moved = std::move(sv);
+    REQUIRE(*moved[3] == 2);
+    REQUIRE(sv.empty());
+}
+
+// a type with a user-written (counting) move constructor that is nonetheless safe to relocate
+// with memcpy, so growth should never call it
+struct Relocatable {
+    static inline int moves = 0;
+    int value;
+    Relocatable(int v) : value(v) {}
+    Relocatable(Relocatable&& other) noexcept : value(other.value) { ++moves; }
+    Relocatable& operator=(Relocatable&& other) noexcept { value = other.value; ++moves; return *this; }
+};
+
+template <>
+struct is_trivially_relocatable<Relocatable> : std::true_type {};
+
+TEST_CASE("SmallVector: trivially relocatable elements grow without moves", "[small_vector]") {
+    static_assert(is_trivially_relocatable_v<int>);
+    static_assert(!is_trivially_relocatable_v<std::string>);
+
+    Relocatable::moves = 0;
+    SmallVector<Relocatable, 2> sv;
+    for (int i = 0; i < 64; ++i) sv.emplace_back(i);
+    sv.emplace(sv.begin(), -1);   // shifting is a memmove too
+    REQUIRE(sv.size() == 65);
+    REQUIRE(sv[0].value == -1);
+    REQUIRE(sv[64].value == 63);
+
+    REQUIRE(Relocatable::moves == 0);
+
+    SmallVector<Relocatable, 2> small;
+    small.emplace_back(1);
+    SmallVector<Relocatable, 2> moved = std::move(small);
+    REQUIRE(moved[0].value == 1);
+    REQUIRE(Relocatable::moves == 0);
+}
+
+TEST_CASE("SmallVector: spilling into an ArenaAllocator", "[small_vector]") {
+    ArenaAllocator arena(64 * 1024);
+    {
+        SmallVector<int, 4, ArenaAlloc> sv{ArenaAlloc(arena)};
+        for (int i = 0; i < 4; ++i) sv.push_back(i);
+        REQUIRE(sv.on_stack());
+        REQUIRE(arena.used() == 0);
+
+        for (int i = 4; i < 100; ++i) sv.push_back(i);
+        REQUIRE_FALSE(sv.on_stack());
+        REQUIRE(arena.used() >= 100 * sizeof(int));
+        REQUIRE(sv[99] == 99);
+
+        // copies spill into the same arena
+        SmallVector<int, 4, ArenaAlloc> copy = sv;
+        REQUIRE(&copy.allocator().arena() == &arena);
+        REQUIRE(copy[50] == 50);
+    }
+
+    // nothing was freed back - the arena takes it all back at once
+    REQUIRE(arena.used() > 0);
+    arena.reset();
+    REQUIRE(arena.used() == 0);
+
+    SmallVector<std::string, 1, ArenaAlloc> strings(3, "arena", ArenaAlloc(arena));
+    REQUIRE(strings.size() == 3);
+    REQUIRE(strings[2] == "arena");
+}
+
+TEST_CASE("SmallVector: compact layout", "[small_vector]") {
+    // one pointer plus size and capacity ahead of the inline elements
+    static_assert(sizeof(SmallVector<uint64_t, 2>) == 24 + 2 * sizeof(uint64_t));
+    static_assert(sizeof(CompactSmallVector<uint64_t, 2>) == 16 + 2 * sizeof(uint64_t));
+    static_assert(sizeof(CompactSmallVector<uint64_t, 2, ArenaAlloc>) == 24 + 2 * sizeof(uint64_t));
+
+    CompactSmallVector<int, 2> sv = {1, 2};
+    REQUIRE(sv.on_stack());
+    REQUIRE(sv.data() == &sv[0]);
+    auto const* self = reinterpret_cast<const std::byte*>(&sv);
+    auto const* elements = reinterpret_cast<const std::byte*>(sv.data());
+    REQUIRE((elements >= self && elements < self + sizeof(sv)));   // data() is our own storage
+
+    sv.push_back(3);
+    REQUIRE_FALSE(sv.on_stack());
+    REQUIRE(sv.capacity() == 4);
+    REQUIRE(sv[2] == 3);
+
+    SECTION("moving an inline vector re-points the destination at its own storage") {
+        CompactSmallVector<std::string, 2> a = {"x", "y"};
+        CompactSmallVector<std::string, 2> b = std::move(a);
+        REQUIRE(b.on_stack());
+        REQUIRE(a.on_stack());
+        REQUIRE(a.empty());
+        REQUIRE(b[1] == "y");
+
+        a = std::move(b);
+        REQUIRE(a.on_stack());
+        REQUIRE(a[0] == "x");
+        a.push_back("z");   // spills from the right storage
+        REQUIRE_FALSE(a.on_stack());
+        REQUIRE(a[2] == "z");
+    }
+
+    SECTION("moving a heap vector leaves the source inline and empty") {
+        CompactSmallVector<int, 2> moved = std::move(sv);
+        REQUIRE_FALSE(moved.on_stack());
+        REQUIRE(sv.on_stack());
+        REQUIRE(sv.capacity() == 2);
+        REQUIRE(moved[2] == 3);
+        sv.push_back(7);
+        REQUIRE(sv[0] == 7);
+    }
+
+    SECTION("32-bit size type caps the capacity") {
+        CompactSmallVector<char, 4> chars;
+        REQUIRE_THROWS_AS(chars.reserve(size_t(1) << 32), std::length_error);
+        REQUIRE(chars.on_stack());
+        REQUIRE(chars.capacity() == 4);
+    }
+}
+
 // TODO (Potentially, if time allows or for further depth):
-// - emplace_back tests
-// - insert tests
 // - erase tests
-// - resize tests
 // - shrink_to_fit (and whether it can go from heap back to stack)
 // - Exception safety guarantees (e.g. strong guarantee for push_back if T's move ctor doesn't throw)
 // - Allocator support (making SmallVector allocator-aware so it could use your ArenaAllocator for heap part)
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include <arena_allocator.h>
+#include <simd.h>
+#include <soa_vector.h>
+
+TEST_CASE("SoAVector: rows go in and come out field by field", "[soa_vector]") {
+    SoAVector<int, float, char> table;
+    REQUIRE(table.empty());
+    REQUIRE(table.capacity() == 0);
+
+    for (int i = 0; i < 100; ++i) {
+        table.push_back(i, i * 0.5f, static_cast<char>('a' + i % 26));
+    }
+    table.push_back({-1, -1.0f, 'z'});
+
+    REQUIRE(table.size() == 101);
+    REQUIRE(table.capacity() >= 101);
+
+    auto [id, weight, tag] = table[42];
+    REQUIRE(id == 42);
+    REQUIRE(weight == 21.0f);
+    REQUIRE(tag == 'a' + 42 % 26);
+    REQUIRE(std::get<0>(table[100]) == -1);
+
+    // rows are references into the columns
+    std::get<1>(table[42]) = 7.0f;
+    weight += 1.0f;
+    REQUIRE(table.column<1>()[42] == 8.0f);
+
+    REQUIRE_THROWS_AS(table.at(101), std::out_of_range);
+
+    table.pop_back();
+    REQUIRE(table.size() == 100);
+    table.clear();
+    REQUIRE(table.empty());
+    REQUIRE_THROWS_AS(table.pop_back(), std::out_of_range);
+}
+
+TEST_CASE("SoAVector: columns are contiguous and cache line aligned", "[soa_vector]") {
+    SoAVector<uint8_t, double, uint16_t> table;
+    for (int i = 0; i < 1000; ++i) {
+        table.push_back(static_cast<uint8_t>(i), i * 2.0, static_cast<uint16_t>(i));
+
+        if (i == 0 || i == 999) {
+            REQUIRE(reinterpret_cast<uintptr_t>(table.column<0>().data()) % table.column_alignment == 0);
+            REQUIRE(reinterpret_cast<uintptr_t>(table.column<1>().data()) % table.column_alignment == 0);
+            REQUIRE(reinterpret_cast<uintptr_t>(table.column<2>().data()) % table.column_alignment == 0);
+        }
+    }
+
+    std::span<double> doubles = table.column<1>();
+    REQUIRE(doubles.size() == 1000);
+    for (size_t i = 0; i < doubles.size(); ++i) {
+        REQUIRE(doubles[i] == i * 2.0);
+    }
+
+    std::span<const uint16_t> shorts = std::as_const(table).column<2>();
+    REQUIRE(std::accumulate(shorts.begin(), shorts.end(), size_t(0)) == 999 * 1000 / 2);
+}
+
+TEST_CASE("SoAVector: zip iteration", "[soa_vector]") {
+    SoAVector<int, int> table;
+    for (int i = 0; i < 10; ++i) table.push_back(i, 0);
+
+    for (auto [in, out] : table) {
+        out = in * in;
+    }
+
+    int sum = 0;
+    const auto& view = table;
+    for (auto [in, out] : view) {
+        sum += out - in;
+    }
+    REQUIRE(sum == 285 - 45);
+
+    auto it = table.begin();
+    it += 3;
+    REQUIRE(std::get<1>(*it) == 9);
+    REQUIRE(std::get<1>(it[2]) == 25);
+    REQUIRE(table.end() - it == 7);
+    REQUIRE(it < table.end());
+    REQUIRE(--it == table.begin() + 2);
+}
+
+TEST_CASE("SoAVector: resize zeroes new rows, reserve keeps them", "[soa_vector]") {
+    SoAVector<int, double> table;
+    table.reserve(50);
+    REQUIRE(table.capacity() == 50);
+    REQUIRE(table.empty());
+
+    table.push_back(1, 1.0);
+    table.resize(40);
+    REQUIRE(table.size() == 40);
+    REQUIRE(std::get<0>(table[0]) == 1);
+    REQUIRE(std::get<0>(table[39]) == 0);
+    REQUIRE(std::get<1>(table[39]) == 0.0);
+
+    table.resize(1);
+    REQUIRE(table.size() == 1);
+    REQUIRE(table.capacity() == 50);
+}
+
+// the flattened chunk table from concurrency_stress_tests.cpp, one column per field
+namespace {
+bool any_overlap_soa(SoAVector<std::byte*, std::byte*>& chunks) {
+    chunks.sort_by<0>();
+    auto begins = chunks.column<0>();
+    auto ends = chunks.column<1>();
+    for (size_t i = 1; i < chunks.size(); ++i) {
+        if (begins[i] < ends[i - 1]) return true;
+    }
+    return false;
+}
+}
+
+TEST_CASE("SoAVector: sort_by keeps rows together", "[soa_vector]") {
+    static std::byte memory[4096];
+
+    SoAVector<std::byte*, std::byte*> chunks;
+    std::vector<size_t> starts = {512, 0, 3072, 1024, 256, 2048};
+    for (size_t s : starts) {
+        chunks.push_back(memory + s, memory + s + 128);
+    }
+    REQUIRE_FALSE(any_overlap_soa(chunks));
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        auto [begin, end] = chunks[i];
+        REQUIRE(end - begin == 128);
+        if (i > 0) REQUIRE(std::get<0>(chunks[i - 1]) < begin);
+    }
+
+    chunks.push_back(memory + 2100, memory + 2200);   // inside [2048, 2176)
+    REQUIRE(any_overlap_soa(chunks));
+
+    SECTION("descending, with a custom comparator") {
+        SoAVector<int, char> table;
+        for (int i = 0; i < 5; ++i) table.push_back(i, static_cast<char>('a' + i));
+        table.sort_by<0>(std::greater<>{});
+        REQUIRE(std::get<0>(table[0]) == 4);
+        REQUIRE(std::get<1>(table[0]) == 'e');
+        REQUIRE(std::get<1>(table[4]) == 'a');
+    }
+}
+
+TEST_CASE("SoAVector: columns feed the SIMD kernels", "[soa_vector]") {
+    SoAVector<uint32_t, float> particles;
+    for (uint32_t i = 0; i < 1000; ++i) particles.push_back(i, 0.25f);
+
+    REQUIRE(simd::sum(particles.column<1>()) == 250.0f);
+}
+
+TEST_CASE("SoAVector: arena-backed columns and moves", "[soa_vector]") {
+    ArenaAllocator arena(256 * 1024);
+
+    BasicSoAVector<ArenaAlloc, int, double> table{ArenaAlloc(arena)};
+    for (int i = 0; i < 1000; ++i) table.push_back(i, i * 1.5);
+    REQUIRE(arena.used() >= 1000 * (sizeof(int) + sizeof(double)));
+    REQUIRE(reinterpret_cast<uintptr_t>(table.column<1>().data()) % table.column_alignment == 0);
+
+    table.sort_by<0>(std::greater<>{});
+    REQUIRE(std::get<1>(table[0]) == 999 * 1.5);
+
+    auto moved = std::move(table);
+    REQUIRE(moved.size() == 1000);
+    REQUIRE(table.empty());
+    REQUIRE(std::get<0>(moved[999]) == 0);
+
+    table = std::move(moved);
+    REQUIRE(table.size() == 1000);
+}
@@ -0,0 +1,165 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <task_graph.h>
+
+TEST_CASE("TaskGraph: diamond runs in dependency order", "[task_graph]") {
+    ThreadPool pool(4);
+    TaskGraph graph;
+
+    // each task records a ticket; a successor's ticket must be larger than its predecessors'
+    std::atomic<int> ticket{0};
+    int a_at = -1, b_at = -1, c_at = -1, d_at = -1;
+
+    auto a = graph.add([&] { a_at = ticket++; });
+    auto b = graph.add([&] { b_at = ticket++; });
+    auto c = graph.add([&] { c_at = ticket++; });
+    auto d = graph.add([&] { d_at = ticket++; });
+    graph.precede(a, b);
+    graph.precede(a, c);
+    graph.precede(b, d);
+    graph.precede(c, d);
+    REQUIRE(graph.task_count() == 4);
+    REQUIRE(graph.edge_count() == 4);
+
+    graph.run(pool);
+
+    REQUIRE(ticket.load() == 4);
+    REQUIRE(a_at == 0);
+    REQUIRE(b_at > a_at);
+    REQUIRE(c_at > a_at);
+    REQUIRE(d_at == 3);
+}
+
+TEST_CASE("TaskGraph: re-running reuses the graph without growing it", "[task_graph]") {
+    ThreadPool pool(3);
+    TaskGraph graph;
+
+    constexpr int width = 32;
+    std::atomic<int> stage1{0};
+    std::atomic<int> stage2{0};
+    std::atomic<int> errors{0};
+
+    // fan out from a root, fan back in to a sink
+    auto root = graph.add([&] {
+        if (stage1.load() != 0 || stage2.load() != 0) errors.fetch_add(1);
+    });
+    auto sink = graph.add([&] {
+        if (stage1.load() != width) errors.fetch_add(1);
+        stage2.fetch_add(1);
+    });
+    for (int i = 0; i < width; ++i) {
+        auto mid = graph.add([&] { stage1.fetch_add(1); });
+        graph.precede(root, mid);
+        graph.precede(mid, sink);
+    }
+
+    size_t const bytes = graph.arena_bytes();
+    for (int frame = 0; frame < 200; ++frame) {
+        stage1 = 0;
+        stage2 = 0;
+        graph.run(pool);
+        if (stage2.load() != 1) errors.fetch_add(1);
+    }
+
+    REQUIRE(errors.load() == 0);
+    REQUIRE(graph.arena_bytes() == bytes);
+}
+
+TEST_CASE("TaskGraph: dispatch and wait from outside, chains and empty graphs", "[task_graph]") {
+    ThreadPool pool(2);
+
+    TaskGraph empty;
+    empty.run(pool);
+    empty.wait();
+
+    // a long chain - every step is a continuation on the same worker, nothing gets submitted
+    TaskGraph chain;
+    std::vector<int> order;
+    TaskGraph::Task prev;
+    for (int i = 0; i < 100; ++i) {
+        auto t = chain.add([&order, i] { order.push_back(i); });
+        if (prev.valid()) chain.precede(prev, t);
+        prev = t;
+    }
+    chain.dispatch(pool);
+    chain.wait();
+
+    REQUIRE(order.size() == 100);
+    bool in_order = true;
+    for (int i = 0; i < 100; ++i) in_order = in_order && order[i] == i;
+    REQUIRE(in_order);
+}
+
+TEST_CASE("TaskGraph: back to back runs each wait for their own tasks", "[task_graph][thread]") {
+    ThreadPool pool(4);
+    std::atomic<int> ran{0};
+    TaskGraph graph;
+    auto a = graph.add([&] { ran.fetch_add(1); });
+    auto b = graph.add([&] { ran.fetch_add(1); });
+    auto c = graph.add([&] { ran.fetch_add(1); });
+    graph.precede(a, c);
+    graph.precede(b, c);
+
+    // re-dispatch the moment wait() returns, while the last worker is still on its way out
+    bool every_run = true;
+    for (int i = 1; i <= 2000; ++i) {
+        graph.dispatch(pool);
+        graph.wait();
+        every_run = every_run && ran.load() == 3 * i;
+    }
+    REQUIRE(every_run);
+}
+
+TEST_CASE("TaskGraph: callables are destroyed with the graph and on clear()", "[task_graph]") {
+    ThreadPool pool(2);
+    auto token = std::make_shared<int>(0);
+
+    {
+        TaskGraph graph;
+        for (int i = 0; i < 10; ++i) {
+            graph.add([token] { ++*token; });
+        }
+        REQUIRE(token.use_count() == 11);
+        graph.run(pool);
+        REQUIRE(*token == 10);
+
+        graph.clear();
+        REQUIRE(token.use_count() == 1);
+        REQUIRE(graph.task_count() == 0);
+
+        // and it can be built again from the same arena
+        auto a = graph.add([token] { *token += 100; });
+        auto b = graph.add([token] { *token *= 2; });
+        graph.precede(a, b);
+        graph.run(pool);
+        REQUIRE(*token == 220);
+    }
+    REQUIRE(token.use_count() == 1);
+}
+
+TEST_CASE("TaskGraph: many independent graphs on one pool", "[task_graph]") {
+    ThreadPool pool(4);
+    constexpr int graphs = 8;
+    std::atomic<int> count{0};
+
+    std::vector<std::unique_ptr<TaskGraph>> frames;
+    for (int g = 0; g < graphs; ++g) {
+        auto graph = std::make_unique<TaskGraph>();
+        auto first = graph->add([&] { count.fetch_add(1); });
+        for (int i = 0; i < 20; ++i) {
+            graph->precede(first, graph->add([&] { count.fetch_add(1); }));
+        }
+        frames.push_back(std::move(graph));
+    }
+
+    for (int round = 0; round < 10; ++round) {
+        for (auto& g : frames) g->dispatch(pool, { .priority = JobPriority::high });
+        for (auto& g : frames) g->wait();
+    }
+    REQUIRE(count.load() == graphs * 21 * 10);
+}
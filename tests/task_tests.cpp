@@ -0,0 +1,220 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+#include <arena_allocator.h>
+#include <task.h>
+#include <thread_pool.h>
+
+namespace {
+Task<int> value(int v) { co_return v; }
+
+Task<int> add(int a, int b) {
+    int const x = co_await value(a);
+    int const y = co_await value(b);
+    co_return x + y;
+}
+
+Task<> fail() {
+    throw std::runtime_error("boom");
+    co_return;
+}
+
+Task<size_t> worker_of(ThreadPool& pool) {
+    co_await schedule_on(pool);
+    co_return pool.current_worker();
+}
+
+Task<int> in_arena(std::allocator_arg_t, ArenaAllocator&, int v) { co_return v * 2; }
+}
+
+TEST_CASE("Task: Results and exceptions come back through co_await", "[task]") {
+    REQUIRE(sync_wait(add(2, 3)) == 5);
+    REQUIRE(sync_wait(Task<std::string>([]() -> Task<std::string> { co_return "hi"; }())) == "hi");
+    REQUIRE_THROWS_AS(sync_wait(fail()), std::runtime_error);
+
+    // an exception is rethrown at the co_await, where the caller can handle it
+    auto caught = []() -> Task<bool> {
+        try {
+            co_await fail();
+        } catch (const std::runtime_error&) {
+            co_return true;
+        }
+        co_return false;
+    };
+    REQUIRE(sync_wait(caught()));
+
+    // lazy: never awaited, never run
+    bool ran = false;
+    {
+        auto t = [](bool& flag) -> Task<> { flag = true; co_return; }(ran);
+        REQUIRE(t.valid());
+        REQUIRE_FALSE(t.done());
+    }
+    REQUIRE_FALSE(ran);
+}
+
+TEST_CASE("Task: Long chains of synchronous co_awaits don't grow the stack", "[task]") {
+    auto loop = []() -> Task<long> {
+        long sum = 0;
+        for (int i = 0; i < 1'000'000; ++i) sum += co_await value(1);
+        co_return sum;
+    };
+    REQUIRE(sync_wait(loop()) == 1'000'000);
+}
+
+TEST_CASE("Task: schedule_on resumes on a pool worker", "[task][thread_pool]") {
+    ThreadPool pool(2);
+    REQUIRE(sync_wait(worker_of(pool)) < pool.worker_count());
+
+    // a chain that hops on and then awaits more work stays on the pool
+    auto chain = [](ThreadPool& p) -> Task<bool> {
+        co_await schedule_on(p);
+        size_t const w = co_await worker_of(p);
+        co_return w < p.worker_count() && p.current_worker() < p.worker_count();
+    };
+    REQUIRE(sync_wait(chain(pool)));
+
+    JobOptions pinned;
+    pinned.worker = 1;
+    auto on_one = [](ThreadPool& p, JobOptions o) -> Task<size_t> {
+        co_await schedule_on(p, o);
+        co_return p.current_worker();
+    };
+    REQUIRE(sync_wait(on_one(pool, pinned)) == 1);
+}
+
+TEST_CASE("Task: when_all collects every result, void as monostate", "[task][thread_pool]") {
+    ThreadPool pool(3);
+
+    auto square = [](ThreadPool& p, int v) -> Task<int> {
+        co_await schedule_on(p);
+        co_return v * v;
+    };
+    auto touch = [](ThreadPool& p, std::atomic<int>& n) -> Task<> {
+        co_await schedule_on(p);
+        n.fetch_add(1);
+    };
+
+    std::atomic<int> touched{0};
+    auto [a, b, c] = sync_wait(when_all(square(pool, 3), touch(pool, touched), value(7)));
+    REQUIRE(a == 9);
+    REQUIRE(std::is_same_v<decltype(b), std::monostate>);
+    REQUIRE(c == 7);
+    REQUIRE(touched == 1);
+
+    std::vector<Task<int>> many;
+    for (int i = 1; i <= 200; ++i) many.push_back(square(pool, i));
+    std::vector<int> squares = sync_wait(when_all(std::move(many)));
+    REQUIRE(squares.size() == 200);
+    for (int i = 1; i <= 200; ++i) REQUIRE(squares[i - 1] == i * i);
+
+    std::vector<Task<>> chores;
+    for (int i = 0; i < 50; ++i) chores.push_back(touch(pool, touched));
+    sync_wait(when_all(std::move(chores)));
+    REQUIRE(touched == 51);
+
+    sync_wait(when_all(std::vector<Task<int>>{}));   // nothing to wait for
+
+    // a failing child doesn't cut the others short
+    std::vector<Task<>> mixed;
+    mixed.push_back(touch(pool, touched));
+    mixed.push_back(fail());
+    mixed.push_back(touch(pool, touched));
+    REQUIRE_THROWS_AS(sync_wait(when_all(std::move(mixed))), std::runtime_error);
+    REQUIRE(touched == 53);
+}
+
+TEST_CASE("Task: Nested when_all fans out across the pool", "[task][thread_pool][thread]") {
+    ThreadPool pool(4);
+
+    // a binary tree of tasks, each node splitting into two children on the pool
+    struct Tree {
+        static Task<long> sum(ThreadPool& p, long lo, long hi) {
+            co_await schedule_on(p);
+            if (hi - lo <= 64) {
+                long s = 0;
+                for (long i = lo; i < hi; ++i) s += i;
+                co_return s;
+            }
+            long const mid = lo + (hi - lo) / 2;
+            auto [l, r] = co_await when_all(sum(p, lo, mid), sum(p, mid, hi));
+            co_return l + r;
+        }
+    };
+    constexpr long n = 100'000;
+    REQUIRE(sync_wait(Tree::sum(pool, 0, n)) == n * (n - 1) / 2);
+}
+
+TEST_CASE("AsyncLatch: Waiters resume once the count reaches zero", "[task][thread_pool]") {
+    ThreadPool pool(2);
+    AsyncLatch latch(pool, 3);
+    std::atomic<int> arrived{0};
+
+    auto waiter = [](AsyncLatch& l, std::atomic<int>& a) -> Task<int> {
+        co_await l;
+        co_return a.load();
+    };
+    auto arriver = [](ThreadPool& p, AsyncLatch& l, std::atomic<int>& a) -> Task<> {
+        co_await schedule_on(p);
+        a.fetch_add(1);
+        l.count_down();
+    };
+
+    std::vector<Task<int>> waiters;
+    for (int i = 0; i < 4; ++i) waiters.push_back(waiter(latch, arrived));
+    auto [seen, a, b, c] = sync_wait(when_all(when_all(std::move(waiters)), arriver(pool, latch, arrived),
+                                              arriver(pool, latch, arrived), arriver(pool, latch, arrived)));
+    for (int s : seen) REQUIRE(s == 3);
+    REQUIRE(latch.try_wait());
+
+    // already released: co_await doesn't suspend
+    REQUIRE(sync_wait(waiter(latch, arrived)) == 3);
+    AsyncLatch open(0);
+    REQUIRE(open.try_wait());
+}
+
+TEST_CASE("AsyncBarrier: No one starts a phase before everyone finished the last", "[task][thread_pool][thread]") {
+    constexpr size_t parties = 4;
+    constexpr int phases = 50;
+
+    ThreadPool pool(3);
+    AsyncBarrier barrier(pool, parties);
+    std::atomic<int> progress[phases] = {};
+    std::atomic<int> errors{0};
+
+    auto party = [&](ThreadPool& p) -> Task<> {
+        co_await schedule_on(p);
+        for (int phase = 0; phase < phases; ++phase) {
+            progress[phase].fetch_add(1);
+            co_await barrier.arrive_and_wait();
+            if (progress[phase].load() != static_cast<int>(parties)) errors.fetch_add(1);
+        }
+    };
+
+    std::vector<Task<>> all;
+    for (size_t i = 0; i < parties; ++i) all.push_back(party(pool));
+    sync_wait(when_all(std::move(all)));
+
+    REQUIRE(errors == 0);
+    REQUIRE(barrier.phase() == static_cast<size_t>(phases));
+}
+
+TEST_CASE("Task: allocator_arg puts the frame in an arena", "[task][arena]") {
+    ArenaAllocator arena(4096);
+    size_t const before = arena.used();
+    REQUIRE(sync_wait(in_arena(std::allocator_arg, arena, 21)) == 42);
+    REQUIRE(arena.used() > before);
+
+    // and frames without one don't touch it
+    size_t const after = arena.used();
+    REQUIRE(sync_wait(add(1, 1)) == 2);
+    REQUIRE(arena.used() == after);
+}
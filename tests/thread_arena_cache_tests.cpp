@@ -0,0 +1,158 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <thread_arena_cache.h>
+
+namespace {
+bool aligned_to(void* ptr, size_t alignment) {
+    return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+}
+
+TEST_CASE("ThreadArenaCache: Small allocations come from one block", "[thread_arena_cache]") {
+    ArenaAllocator arena(1024 * 1024);
+    ThreadArenaCache cache(arena, 4096);
+
+    std::byte* first = static_cast<std::byte*>(cache.allocate(100, 8));
+    REQUIRE(first != nullptr);
+
+    // everything that fits in the first block is contiguous with it
+    std::byte* prev = first;
+    for (int i = 0; i < 30; ++i) {
+        std::byte* p = static_cast<std::byte*>(cache.allocate(100, 8));
+        REQUIRE(p != nullptr);
+        REQUIRE(aligned_to(p, 8));
+        REQUIRE(p >= prev + 100);
+        REQUIRE(p < first + 4096);
+        prev = p;
+    }
+}
+
+TEST_CASE("ThreadArenaCache: Block exhaustion takes a new block", "[thread_arena_cache]") {
+    ArenaAllocator arena(3 * 4096);
+    ThreadArenaCache cache(arena, 4096);
+
+    size_t count = 0;
+    while (cache.allocate(64, 64) != nullptr) ++count;
+
+    // three blocks worth of 64 byte objects. the arena base is only malloc aligned, so the
+    // first block may be padded to a cache line and the last block's worth then comes
+    // straight out of the arena tail, one object short.
+    REQUIRE(count <= 3 * 4096 / 64);
+    REQUIRE(count >= 3 * 4096 / 64 - 1);
+}
+
+TEST_CASE("ThreadArenaCache: Large requests bypass the cache", "[thread_arena_cache]") {
+    ArenaAllocator arena(64 * 1024);
+    ThreadArenaCache cache(arena, 4096);
+
+    std::byte* small = static_cast<std::byte*>(cache.allocate(16, 16));
+    // doesn't fit in what's left of the block, and is too big to be worth a fresh one
+    std::byte* big = static_cast<std::byte*>(cache.allocate(4090, 16));
+    std::byte* small2 = static_cast<std::byte*>(cache.allocate(16, 16));
+
+    REQUIRE(small != nullptr);
+    REQUIRE(big != nullptr);
+    // the big one landed outside the current block, which is kept and still serves small requests
+    REQUIRE((big < small || big >= small + 4096));
+    REQUIRE(small2 == small + 16);
+}
+
+TEST_CASE("ThreadArenaCache: Reset invalidates cached blocks", "[thread_arena_cache]") {
+    ArenaAllocator arena(2 * 4096);
+    ThreadArenaCache cache(arena, 4096);
+
+    void* before = cache.allocate(32, 8);
+    REQUIRE(before != nullptr);
+
+    SECTION("through the cache") {
+        cache.reset();
+    }
+    SECTION("through the shared arena") {
+        arena.reset();
+    }
+
+    // the old block is gone, so the first allocation after reset restarts at the arena base
+    void* after = cache.allocate(32, 8);
+    REQUIRE(after == before);
+
+    // and the cache no longer believes it owns the rest of the old block - the arena hands
+    // that same space to the next direct caller
+    void* direct = arena.allocate(32, 8);
+    REQUIRE(direct != nullptr);
+    REQUIRE(static_cast<std::byte*>(direct) >= static_cast<std::byte*>(after) + 4096);
+}
+
+TEST_CASE("ThreadArenaCache: Independent caches over one arena don't share blocks", "[thread_arena_cache]") {
+    ArenaAllocator arena(64 * 1024);
+    ThreadArenaCache a(arena, 4096);
+    ThreadArenaCache b(arena, 4096);
+
+    std::byte* pa = static_cast<std::byte*>(a.allocate(8, 8));
+    std::byte* pb = static_cast<std::byte*>(b.allocate(8, 8));
+    REQUIRE(pa != nullptr);
+    REQUIRE(pb != nullptr);
+    REQUIRE((pb >= pa + 4096 || pa >= pb + 4096));
+}
+
+TEST_CASE("ThreadArenaCache: Alternating between caches keeps both blocks", "[thread_arena_cache]") {
+    ArenaAllocator arena(1024 * 1024);
+    // ids four apart - they used to land on the same thread slot and evict each other
+    ThreadArenaCache a(arena, 4096);
+    ThreadArenaCache x(arena, 4096), y(arena, 4096), z(arena, 4096);
+    ThreadArenaCache b(arena, 4096);
+
+    for (int i = 0; i < 30; ++i) {
+        REQUIRE(a.allocate(100, 8) != nullptr);
+        REQUIRE(b.allocate(100, 8) != nullptr);
+    }
+    // one block each, not a fresh block per switch
+    REQUIRE(arena.used() <= 2 * 4096 + 2 * cache_line_size);
+
+    // more caches than slots: only the least recently used block is given up
+    std::byte* const pa = static_cast<std::byte*>(a.allocate(8, 8));
+    std::byte* const px = static_cast<std::byte*>(x.allocate(8, 8));
+    std::byte* const py = static_cast<std::byte*>(y.allocate(8, 8));
+    REQUIRE(z.allocate(8, 8) != nullptr);   // evicts b, not a
+    std::byte* const again = static_cast<std::byte*>(a.allocate(8, 8));
+    REQUIRE(again == pa + 8);
+    REQUIRE(static_cast<std::byte*>(x.allocate(8, 8)) == px + 8);
+    REQUIRE(static_cast<std::byte*>(y.allocate(8, 8)) == py + 8);
+}
+
+TEST_CASE("ThreadArenaCache: Many threads never overlap", "[thread_arena_cache][thread]") {
+    ArenaAllocator arena(4 * 1024 * 1024);
+    ThreadArenaCache cache(arena);
+
+    const unsigned P = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<std::vector<std::pair<std::byte*, size_t>>> per_thread(P);
+    std::vector<std::thread> threads;
+    std::atomic<bool> go{false};
+
+    for (unsigned t = 0; t < P; ++t) {
+        threads.emplace_back([&, t] {
+            while (!go.load(std::memory_order_acquire)) /* spin */;
+            for (size_t n = 0; n < 5'000; ++n) {
+                size_t size = 8 + (n * 13 + t) % 120;
+                void* p = cache.allocate(size, alignof(std::max_align_t));
+                if (p == nullptr) break;
+                per_thread[t].push_back({ static_cast<std::byte*>(p), size });
+            }
+        });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& th : threads) th.join();
+
+    std::vector<std::pair<std::byte*, size_t>> all;
+    for (auto& v : per_thread) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    for (size_t i = 1; i < all.size(); ++i) {
+        REQUIRE(all[i - 1].first + all[i - 1].second <= all[i].first);
+    }
+}
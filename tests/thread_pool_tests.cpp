@@ -0,0 +1,206 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <thread_pool.h>
+
+TEST_CASE("ThreadPool: runs every submitted job exactly once", "[thread_pool]") {
+    ThreadPool pool(4);
+    constexpr size_t jobs = 20'000;
+    std::vector<std::atomic<int>> runs(jobs);
+
+    for (size_t i = 0; i < jobs; ++i) {
+        pool.submit([&runs, i] { runs[i].fetch_add(1, std::memory_order_relaxed); });
+    }
+    pool.wait();
+
+    size_t wrong = 0;
+    for (auto& r : runs) wrong += r.load() != 1;
+    REQUIRE(wrong == 0);
+}
+
+TEST_CASE("ThreadPool: wait with nothing submitted returns", "[thread_pool]") {
+    ThreadPool pool(2);
+    pool.wait();
+    REQUIRE(pool.worker_count() == 2);
+    REQUIRE(pool.current_worker() == 2);
+}
+
+TEST_CASE("ThreadPool: jobs can submit more jobs", "[thread_pool]") {
+    ThreadPool pool(4);
+    std::atomic<int> leaves{0};
+
+    // outer jobs may run on a worker or on this thread while it helps in wait() - either way
+    // their children land somewhere and get run
+    for (int i = 0; i < 100; ++i) {
+        pool.submit([&] {
+            for (int j = 0; j < 100; ++j) {
+                pool.submit([&] { leaves.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+    }
+    pool.wait();
+
+    REQUIRE(leaves.load() == 100 * 100);
+}
+
+TEST_CASE("ThreadPool: a full worker deque runs the job inline", "[thread_pool]") {
+    ThreadPool pool(1, 2);
+    std::atomic<int> done{0};
+    std::atomic<int> inline_runs{-1};
+
+    // the only worker submits to its own two-slot deque; nobody else is taking from it until the
+    // outer job returns, so whatever didn't fit ran right there
+    pool.submit([&] {
+        for (int i = 0; i < 10; ++i) {
+            pool.submit([&] { done.fetch_add(1); });
+        }
+        inline_runs.store(done.load());
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    pool.wait();
+    REQUIRE(inline_runs.load() >= 8);
+    REQUIRE(done.load() == 10);
+}
+
+TEST_CASE("ThreadPool: a burst from outside queues instead of running inline", "[thread_pool]") {
+    ThreadPool pool(1, 2);
+    std::atomic<bool> release{false};
+    std::atomic<int> done{0};
+
+    // park the only worker inside a job, then submit far more than the initial queue capacity
+    pool.submit([&] {
+        while (!release.load()) std::this_thread::yield();
+        done.fetch_add(1);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    for (int i = 0; i < 100; ++i) {
+        pool.submit([&] { done.fetch_add(1); });
+    }
+    REQUIRE(done.load() == 0); // the injection queue grew, nothing ran on this thread
+
+    release.store(true);
+    pool.wait();
+    REQUIRE(done.load() == 101);
+}
+
+TEST_CASE("ThreadPool: parked workers wake up for new work", "[thread_pool]") {
+    ThreadPool pool(3);
+    std::atomic<int> count{0};
+
+    for (int round = 0; round < 5; ++round) {
+        // long enough for every worker to give up spinning and park
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        for (int i = 0; i < 50; ++i) pool.submit([&] { count.fetch_add(1); });
+        pool.wait();
+        REQUIRE(count.load() == (round + 1) * 50);
+    }
+}
+
+TEST_CASE("ThreadPool: destruction finishes outstanding work", "[thread_pool]") {
+    std::atomic<int> count{0};
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 1000; ++i) pool.submit([&] { count.fetch_add(1); });
+    }
+    REQUIRE(count.load() == 1000);
+}
+
+TEST_CASE("ThreadPool: a submit whose copy throws leaves nothing pending", "[thread_pool]") {
+    struct ThrowsOnCopy {
+        std::atomic<int>* count;
+        explicit ThrowsOnCopy(std::atomic<int>* c) : count(c) {}
+        ThrowsOnCopy(const ThrowsOnCopy&) { throw std::runtime_error("copy"); }
+        ThrowsOnCopy(ThrowsOnCopy&&) noexcept = default;
+        void operator()() { count->fetch_add(1); }
+    };
+
+    std::atomic<int> count{0};
+    {
+        ThreadPool pool(2);
+        ThrowsOnCopy job(&count);
+        REQUIRE_THROWS_AS(pool.submit(job), std::runtime_error);
+        pool.submit(std::move(job));
+        pool.wait();   // would wait forever for the job that was never made
+        REQUIRE(count.load() == 1);
+    }
+}
+
+TEST_CASE("ThreadPool: high priority jobs overtake a queued backlog", "[thread_pool]") {
+    ThreadPool pool(1);
+    std::atomic<bool> release{false};
+    std::atomic<int> ticket{0};
+    std::vector<int> high_order(20, -1), background_order(20, -1);
+
+    pool.submit([&] {
+        while (!release.load()) std::this_thread::yield();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    for (int i = 0; i < 20; ++i) {
+        pool.submit({ .priority = JobPriority::background }, [&, i] { background_order[i] = ticket++; });
+    }
+    for (int i = 0; i < 20; ++i) {
+        pool.submit({ .priority = JobPriority::high }, [&, i] { high_order[i] = ticket++; });
+    }
+
+    // let the single worker drain it alone - a thread helping in wait() would be a second runner
+    release.store(true);
+    while (ticket.load() < 40) std::this_thread::yield();
+    pool.wait();
+
+    REQUIRE(*std::max_element(high_order.begin(), high_order.end()) == 19);
+    REQUIRE(*std::min_element(background_order.begin(), background_order.end()) == 20);
+    REQUIRE(std::is_sorted(high_order.begin(), high_order.end()));
+}
+
+TEST_CASE("ThreadPool: worker affinity keeps jobs on that worker", "[thread_pool]") {
+    ThreadPool pool(4);
+    std::atomic<int> wrong{0};
+    std::atomic<int> ran{0};
+
+    auto pinned = [&] {
+        if (pool.current_worker() != 2) wrong.fetch_add(1);
+        ran.fetch_add(1);
+    };
+    for (int i = 0; i < 200; ++i) {
+        pool.submit({ .worker = 2 }, pinned);
+    }
+    // from inside the pool too, including from other workers
+    for (int i = 0; i < 20; ++i) {
+        pool.submit([&] {
+            for (int j = 0; j < 10; ++j) pool.submit({ .priority = JobPriority::high, .worker = 2 }, pinned);
+        });
+    }
+    pool.wait();
+
+    REQUIRE(ran.load() == 400);
+    REQUIRE(wrong.load() == 0);
+}
+
+TEST_CASE("ThreadPool: node affinity runs on a worker", "[thread_pool]") {
+    ThreadPool pool(2);
+    std::atomic<int> ran{0};
+    std::atomic<int> outside{0};
+
+    for (int i = 0; i < 100; ++i) {
+        pool.submit({ .numa_node = 0 }, [&] {
+            if (pool.current_worker() == pool.worker_count()) outside.fetch_add(1);
+            ran.fetch_add(1);
+        });
+    }
+    // a node that doesn't exist (and a worker that doesn't exist) just means no affinity
+    pool.submit({ .numa_node = 4096 }, [&] { ran.fetch_add(1); });
+    pool.submit({ .worker = 99 }, [&] { ran.fetch_add(1); });
+    pool.wait();
+
+    REQUIRE(ran.load() == 102);
+    REQUIRE(outside.load() == 0);   // node queues are never drained by helping threads
+}
@@ -1,5 +1,10 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <page_alloc.h>
 #include <unique_buffer.h>
 
 TEST_CASE("UniqueBuffer: Default ctor yields empty buffer") {
@@ -33,9 +38,230 @@ TEST_CASE("UniqueBuffer: Move assignment leaves source null") {
     REQUIRE_FALSE( m_dest.data() == nullptr );
 }
 
-TEST_CASE("UniqueBuffer: array accessor throws when out of range") {
+TEST_CASE("UniqueBuffer: at() throws when out of range") {
     UniqueBuffer<int> buf(3);
-    REQUIRE_THROWS_AS(buf[3], std::out_of_range);
+    REQUIRE_THROWS_AS(buf.at(3), std::out_of_range);
+
+    const UniqueBuffer<int>& cbuf = buf;
+    REQUIRE_THROWS_AS(cbuf.at(3), std::out_of_range);
+}
+
+TEST_CASE("UniqueBuffer: operator[] and at() reach the same elements") {
+    UniqueBuffer<int> buf(3);
+    buf[2] = 5;
+    REQUIRE(buf.at(2) == 5);
+    buf.at(0) = 7;
+    REQUIRE(buf[0] == 7);
+    STATIC_REQUIRE(noexcept(buf[0]));
+}
+
+TEST_CASE("UniqueBuffer: alignment parameter") {
+    STATIC_REQUIRE(UniqueBuffer<float>::alignment == alignof(float));
+    STATIC_REQUIRE(AlignedBuffer<float, 64>::alignment == 64);
+    STATIC_REQUIRE(AlignedBuffer<double, 1>::alignment == alignof(double)); // never below alignof(T)
+
+    AlignedBuffer<float, 64> buf(17);
+    REQUIRE(reinterpret_cast<uintptr_t>(buf.data()) % 64 == 0);
+    buf[16] = 1.5f;
+    buf.resize(10'000);
+    REQUIRE(reinterpret_cast<uintptr_t>(buf.data()) % 64 == 0);
+    REQUIRE(buf[16] == 1.5f);
+
+    auto wide = AlignedBuffer<std::byte, 4096, UninitializedAlloc>::uninitialized(100);
+    REQUIRE(reinterpret_cast<uintptr_t>(wide.data()) % 4096 == 0);
+}
+
+TEST_CASE("UniqueBuffer: default policy value-initializes elements") {
+    UniqueBuffer<int> buf(64);
+    for (size_t i = 0; i < buf.size(); ++i) REQUIRE(buf[i] == 0);
+}
+
+namespace {
+struct Counted {
+    static inline int alive = 0;
+    int value = 7;
+    Counted() { ++alive; }
+    Counted(const Counted& other) : value(other.value) { ++alive; }
+    ~Counted() { --alive; }
+};
+}
+
+TEST_CASE("UniqueBuffer: elements are constructed and destroyed once under any policy") {
+    Counted::alive = 0;
+    {
+        UniqueBuffer<Counted, UninitializedAlloc> buf(5);
+        REQUIRE(Counted::alive == 5);
+        REQUIRE(buf[4].value == 7); // non-trivial types still get their default ctor
+
+        UniqueBuffer<Counted, UninitializedAlloc> moved = std::move(buf);
+        REQUIRE(Counted::alive == 5);
+    }
+    REQUIRE(Counted::alive == 0);
+}
+
+TEST_CASE("UniqueBuffer: over-aligned element types are honoured") {
+    struct alignas(64) Line { float lanes[16]; };
+    UniqueBuffer<Line> buf(3);
+    REQUIRE(reinterpret_cast<uintptr_t>(buf.data()) % 64 == 0);
+}
+
+TEST_CASE("UniqueBuffer: page backed buffers", "[page_alloc]") {
+    size_t const page = PageAlloc::os_page_size();
+
+    SECTION("pages are page aligned and zeroed by the OS") {
+        UniqueBuffer<std::byte, PageAlloc> buf(3 * page + 1, PageAlloc(PageOptions{ PageBacking::pages }));
+        REQUIRE(reinterpret_cast<uintptr_t>(buf.data()) % page == 0);
+        REQUIRE(buf.allocator().mapped_bytes() == 4 * page);
+        REQUIRE(buf[3 * page] == std::byte{0});
+        std::memset(buf.data(), 0xab, buf.size());
+    }
+
+    SECTION("huge pages fall back when none are reserved") {
+        PageOptions const options{ PageBacking::huge_pages, true };
+        UniqueBuffer<std::byte, PageAlloc> buf(PageAlloc::huge_page_size + 1, PageAlloc(options));
+        REQUIRE(buf.data() != nullptr);
+        REQUIRE(buf.allocator().mapped_bytes() == 2 * PageAlloc::huge_page_size);
+        std::memset(buf.data(), 0xcd, buf.size());
+        REQUIRE(buf[PageAlloc::huge_page_size] == std::byte{0xcd});
+    }
+
+    SECTION("transparent huge pages") {
+        UniqueBuffer<uint64_t, PageAlloc> buf(1024, PageAlloc(PageOptions{ PageBacking::transparent_huge_pages }));
+        REQUIRE(reinterpret_cast<uintptr_t>(buf.data()) % page == 0);
+        buf[1023] = 42;
+        REQUIRE(buf[1023] == 42);
+    }
+
+    SECTION("heap backing is cache line aligned") {
+        UniqueBuffer<std::byte, PageAlloc> buf(100, PageAlloc(PageOptions{ PageBacking::heap, true }));
+        REQUIRE(reinterpret_cast<uintptr_t>(buf.data()) % cache_line_size == 0);
+    }
+
+    SECTION("node bound buffers are mapped even with heap backing") {
+        PageOptions const options{ PageBacking::heap, true, 0 };
+        UniqueBuffer<std::byte, PageAlloc> buf(page + 1, PageAlloc(options));
+        REQUIRE(reinterpret_cast<uintptr_t>(buf.data()) % page == 0);
+        REQUIRE(buf.allocator().mapped_bytes() == 2 * page);
+        REQUIRE(buf[page] == std::byte{0});
+    }
+
+    SECTION("moving hands the mapping over") {
+        UniqueBuffer<std::byte, PageAlloc> src(page, PageAlloc(PageOptions{ PageBacking::pages }));
+        std::byte* data = src.data();
+        UniqueBuffer<std::byte, PageAlloc> dest;
+        dest = std::move(src);
+        REQUIRE(src.data() == nullptr);
+        REQUIRE(dest.data() == data);
+        REQUIRE(dest.allocator().mapped_bytes() == page);
+    }
+}
+
+TEST_CASE("UniqueBuffer: uninitialized() skips value-initialization") {
+    UniqueBuffer<uint32_t> buf = UniqueBuffer<uint32_t>::uninitialized(1000);
+    REQUIRE(buf.size() == 1000);
+    REQUIRE(buf.capacity() == 1000);
+    for (size_t i = 0; i < buf.size(); ++i) buf[i] = static_cast<uint32_t>(i);
+    REQUIRE(buf[999] == 999);
+
+    // non-trivial types still get their default ctor
+    UniqueBuffer<std::string> strings = UniqueBuffer<std::string>::uninitialized(3);
+    REQUIRE(strings[2].empty());
+
+    REQUIRE(UniqueBuffer<int>::uninitialized(0).data() == nullptr);
+}
+
+TEST_CASE("UniqueBuffer: reserve and resize keep contents") {
+    UniqueBuffer<int> buf(4);
+    for (int i = 0; i < 4; ++i) buf[i] = i + 1;
+
+    buf.reserve(1000);
+    REQUIRE(buf.size() == 4);
+    REQUIRE(buf.capacity() == 1000);
+    REQUIRE(buf[3] == 4);
+    REQUIRE_THROWS_AS(buf.at(4), std::out_of_range);
+
+    buf.resize(100'000); // realloc path
+    REQUIRE(buf.size() == 100'000);
+    REQUIRE(buf[0] == 1);
+    REQUIRE(buf[3] == 4);
+    REQUIRE(buf[99'999] == 0); // grown elements follow the policy - value-initialized here
+
+    buf.resize(2);
+    REQUIRE(buf.size() == 2);
+    REQUIRE(buf.capacity() == 100'000);
+    REQUIRE(buf[1] == 2);
+
+    UniqueBuffer<int> empty;
+    empty.resize(3);
+    REQUIRE(empty.size() == 3);
+    REQUIRE(empty[2] == 0);
+}
+
+TEST_CASE("UniqueBuffer: growing relocates non-trivial elements") {
+    UniqueBuffer<std::string> buf(2);
+    buf[0] = std::string(100, 'a');
+    buf[1] = "short";
+
+    buf.resize(50);
+    REQUIRE(buf[0] == std::string(100, 'a'));
+    REQUIRE(buf[1] == "short");
+    REQUIRE(buf[49].empty());
+
+    Counted::alive = 0;
+    {
+        UniqueBuffer<Counted> counted(3);
+        counted.reserve(64);
+        counted.resize(10);
+        REQUIRE(Counted::alive == 10);
+        counted.resize(1);
+        REQUIRE(Counted::alive == 1);
+    }
+    REQUIRE(Counted::alive == 0);
+}
+
+TEST_CASE("UniqueBuffer: over-aligned buffers grow by copying") {
+    struct alignas(64) Line { float lanes[16]; };
+    UniqueBuffer<Line> buf(2);
+    buf[1].lanes[15] = 3.0f;
+    buf.resize(200);
+    REQUIRE(reinterpret_cast<uintptr_t>(buf.data()) % 64 == 0);
+    REQUIRE(buf[1].lanes[15] == 3.0f);
+}
+
+TEST_CASE("UniqueBuffer: page backed buffers grow in place", "[page_alloc]") {
+    size_t const page = PageAlloc::os_page_size();
+    auto buf = UniqueBuffer<std::byte, PageAlloc>::uninitialized(page, PageAlloc(PageOptions{ PageBacking::pages }));
+    std::memset(buf.data(), 0x11, page);
+
+    buf.resize(64 * page);
+    REQUIRE(buf.allocator().mapped_bytes() == 64 * page);
+    REQUIRE(buf[page - 1] == std::byte{0x11});
+    REQUIRE(buf[64 * page - 1] == std::byte{0}); // fresh pages come zeroed from the OS
+}
+
+TEST_CASE("UniqueBuffer: page backed buffers of non-trivial types grow by moving", "[page_alloc]") {
+    // strings can't be mremapped, so growing maps a new block and frees the old one after - which
+    // must be unmapped at its own length, not the new block's, or it takes its neighbours along
+    for (PageBacking backing : { PageBacking::pages, PageBacking::huge_pages }) {
+        UniqueBuffer<std::byte, PageAlloc> neighbour(PageAlloc::os_page_size(), PageAlloc(PageOptions{ PageBacking::pages }));
+        UniqueBuffer<std::string, PageAlloc> buf(1, PageAlloc(PageOptions{ backing }));
+        buf[0] = "a string long enough to live on the heap";
+        UniqueBuffer<std::byte, PageAlloc> after(PageAlloc::os_page_size(), PageAlloc(PageOptions{ PageBacking::pages }));
+
+        buf.resize(200'000);
+        buf[199'999] = "last";
+        REQUIRE(buf[0] == "a string long enough to live on the heap");
+        REQUIRE(buf[199'999] == "last");
+
+        // both still mapped
+        std::memset(neighbour.data(), 0x22, neighbour.size());
+        std::memset(after.data(), 0x33, after.size());
+        REQUIRE(neighbour[0] == std::byte{0x22});
+        REQUIRE(after[0] == std::byte{0x33});
+
+        buf.resize(3);
+        REQUIRE(buf[0] == "a string long enough to live on the heap");
+    }
 }
 
 /*
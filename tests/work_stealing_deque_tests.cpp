@@ -0,0 +1,173 @@
+#include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include <job_queue.h>
+
+using Task = std::size_t;
+
+TEST_CASE("WorkStealingDeque: owner is LIFO, thieves are FIFO", "[work-stealing]") {
+    WorkStealingDeque<Task> dq(8);
+    Task out = 0;
+
+    REQUIRE(dq.capacity() == 8);
+    REQUIRE_FALSE(dq.pop(out));
+    REQUIRE_FALSE(dq.steal(out));
+
+    for (Task t = 1; t <= 4; ++t) REQUIRE(dq.push(t));
+    REQUIRE(dq.size() == 4);
+
+    REQUIRE(dq.pop(out));
+    REQUIRE(out == 4);   // newest from the bottom
+    REQUIRE(dq.steal(out));
+    REQUIRE(out == 1);   // oldest from the top
+    REQUIRE(dq.pop(out));
+    REQUIRE(out == 3);
+    REQUIRE(dq.pop(out));
+    REQUIRE(out == 2);
+    REQUIRE_FALSE(dq.pop(out));
+    REQUIRE(dq.empty());
+}
+
+TEST_CASE("WorkStealingDeque: capacity rounds up and fills", "[work-stealing]") {
+    WorkStealingDeque<Task> dq(5);
+    REQUIRE(dq.capacity() == 8);
+    for (Task t = 0; t < 8; ++t) REQUIRE(dq.push(t));
+    REQUIRE_FALSE(dq.push(99));
+
+    // wrap around a few times
+    Task out = 0;
+    for (Task round = 0; round < 100; ++round) {
+        REQUIRE(dq.steal(out));
+        REQUIRE(dq.push(100 + round));
+    }
+    REQUIRE(dq.size() == 8);
+
+    WorkStealingDeque<Task> none;
+    REQUIRE_FALSE(none.push(1));
+}
+
+TEST_CASE("WorkStealingDeque: owner and thieves never lose or duplicate", "[work-stealing][concurrency]") {
+    constexpr size_t total = 200'000;
+    constexpr size_t thieves = 3;
+    WorkStealingDeque<Task> dq(256);
+
+    std::vector<std::atomic<int>> seen(total);
+    std::atomic<size_t> taken{0};
+    std::atomic<int> duplicates{0};
+    auto record = [&](Task t) {
+        if (seen[t].fetch_add(1, std::memory_order_relaxed) != 0) duplicates.fetch_add(1);
+        taken.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thieves; ++i) {
+        threads.emplace_back([&] {
+            Task t;
+            while (taken.load(std::memory_order_relaxed) < total) {
+                if (dq.steal(t)) record(t);
+            }
+        });
+    }
+
+    // owner: pushes everything, popping some of its own work as it goes (the race on the last
+    // element is the interesting case)
+    Task next = 0;
+    Task t;
+    while (next < total) {
+        if (dq.push(next)) {
+            ++next;
+            if (next % 3 == 0 && dq.pop(t)) record(t);
+        } else if (dq.pop(t)) {
+            record(t);
+        }
+    }
+    while (taken.load(std::memory_order_relaxed) < total) {
+        if (dq.pop(t)) record(t);
+    }
+    for (auto& th : threads) th.join();
+
+    REQUIRE(duplicates.load() == 0);
+    REQUIRE(taken.load() == total);
+    size_t missing = 0;
+    for (auto& s : seen) missing += s.load() != 1;
+    REQUIRE(missing == 0);
+}
+
+TEST_CASE("WorkStealingDeque: steal_half moves the oldest half", "[work-stealing]") {
+    WorkStealingDeque<Task> victim(16), thief(16);
+    for (Task t = 0; t < 9; ++t) REQUIRE(victim.push(t));
+
+    Task out = 99;
+    REQUIRE(victim.steal_half(thief, out) == 5);
+    REQUIRE(out == 0);                  // the oldest is handed back to run now
+    REQUIRE(victim.size() == 4);
+    REQUIRE(thief.size() == 4);
+
+    Task t;
+    REQUIRE(thief.pop(t));
+    REQUIRE(t == 4);                    // thief continues with the newest of what it took
+    REQUIRE(victim.pop(t));
+    REQUIRE(t == 8);
+
+    // max caps the batch, a full thief deque caps it too
+    REQUIRE(victim.steal_half(thief, out, 1) == 1);
+    REQUIRE(out == 5);
+
+    WorkStealingDeque<Task> tiny(1);
+    REQUIRE(tiny.push(42));
+    for (Task i = 0; i < 6; ++i) victim.push(100 + i);
+    REQUIRE(victim.steal_half(tiny, out) == 1);   // no room at home - only the run-now item
+    REQUIRE(tiny.size() == 1);
+
+    WorkStealingDeque<Task> empty(4);
+    REQUIRE(empty.steal_half(thief, out) == 0);
+}
+
+TEST_CASE("WorkStealingDeque: batch thieves racing the owner", "[work-stealing][concurrency]") {
+    constexpr size_t total = 200'000;
+    constexpr size_t thieves = 3;
+    WorkStealingDeque<Task> dq(1024);
+
+    std::vector<std::atomic<int>> seen(total);
+    std::atomic<size_t> taken{0};
+    std::atomic<int> duplicates{0};
+    auto record = [&](Task t) {
+        if (seen[t].fetch_add(1, std::memory_order_relaxed) != 0) duplicates.fetch_add(1);
+        taken.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thieves; ++i) {
+        threads.emplace_back([&] {
+            WorkStealingDeque<Task> own(64);
+            Task t;
+            while (taken.load(std::memory_order_relaxed) < total) {
+                if (dq.steal_half(own, t, 16) > 0) {
+                    record(t);
+                    while (own.pop(t)) record(t);
+                }
+            }
+        });
+    }
+
+    Task next = 0;
+    Task t;
+    while (next < total) {
+        if (dq.push(next)) {
+            ++next;
+            if (next % 2 == 0 && dq.pop(t)) record(t);
+        } else if (dq.pop(t)) {
+            record(t);
+        }
+    }
+    while (taken.load(std::memory_order_relaxed) < total) {
+        if (dq.pop(t)) record(t);
+    }
+    for (auto& th : threads) th.join();
+
+    REQUIRE(duplicates.load() == 0);
+    REQUIRE(taken.load() == total);
+}